@@ -0,0 +1,92 @@
+#ifndef LUA_WRAPPER_GENERATOR_BINDING_IR_HPP
+#define LUA_WRAPPER_GENERATOR_BINDING_IR_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <memory>
+
+#include <LuaWrapperGenerator/CodeGenerator.hpp>
+
+// Binary form of everything the parser extracts from a translation unit.
+// It allows the output of a parse to be stored and later loaded without involving libclang.
+//
+// Layout: magic, version, string table, records.
+// Every string that isn't a blob is stored once in the string table and referred to by index.
+// Types are stored as a tag followed by the data needed to reconstruct them.
+// Types added by a TypePatch are stored by the patch that created them.
+
+namespace RC::LuaWrapperGenerator
+{
+    // Must be bumped whenever the layout of anything that's written changes.
+    constexpr uint32_t binding_ir_version = 2;
+
+    class IRWriter
+    {
+    private:
+        const std::vector<TypePatch>* m_type_patches{};
+        std::string m_records{};
+        std::vector<std::string_view> m_strings{};
+        std::unordered_map<std::string, uint32_t> m_string_indexes{};
+
+    public:
+        IRWriter() = default;
+        explicit IRWriter(const std::vector<TypePatch>& type_patches) : m_type_patches(&type_patches) {}
+
+    public:
+        auto write_u8(uint8_t value) -> void;
+        auto write_bool(bool value) -> void { write_u8(value ? 1 : 0); }
+        auto write_u32(uint32_t value) -> void;
+        auto write_u64(uint64_t value) -> void;
+        auto write_string(std::string_view string) -> void;
+        // Unlike 'write_string', the bytes are written in-place instead of being added to the string table.
+        auto write_blob(std::string_view blob) -> void;
+        auto write_type(const Type::Base* type) -> void;
+        auto write_function(const Function& function) -> void;
+        auto write_container(const Container& container) -> void;
+
+        // Returns the final buffer, the writer must not be used after this.
+        auto finish() -> std::string;
+
+    private:
+        auto write_function_container(const FunctionContainer& functions) -> void;
+        auto write_class(const Class& the_class, const Container& container) -> void;
+    };
+
+    class IRReader
+    {
+    private:
+        CodeGenerator* m_code_generator{};
+        std::string_view m_data{};
+        size_t m_position{};
+        std::vector<std::string_view> m_strings{};
+
+    public:
+        // Throws if the data doesn't start with a valid header or was written by a different version.
+        // The reader refers directly to 'data' which must be kept alive for as long as the reader is used.
+        // Types and classes can only be read if a 'code_generator' was supplied.
+        explicit IRReader(std::string_view data, CodeGenerator* code_generator = nullptr);
+
+    public:
+        auto read_u8() -> uint8_t;
+        auto read_bool() -> bool { return read_u8() != 0; }
+        auto read_u32() -> uint32_t;
+        auto read_u64() -> uint64_t;
+        auto read_string() -> std::string;
+        auto read_blob() -> std::string_view;
+        auto read_type() -> std::unique_ptr<Type::Base>;
+        auto read_function(Class* containing_class) -> Function;
+        // Reads a container written by 'IRWriter::write_container' into the container of the code generator.
+        auto read_container() -> void;
+        auto is_at_end() const -> bool { return m_position == m_data.size(); }
+
+    private:
+        auto read_raw(size_t size) -> std::string_view;
+        auto read_function_container(FunctionContainer& functions, Class* containing_class) -> void;
+        auto get_code_generator() -> CodeGenerator&;
+    };
+}
+
+#endif //LUA_WRAPPER_GENERATOR_BINDING_IR_HPP
@@ -1,22 +1,31 @@
 #ifndef LUA_WRAPPER_GENERATOR_TESTING_PARSER_OUTPUT_HPP
 #define LUA_WRAPPER_GENERATOR_TESTING_PARSER_OUTPUT_HPP
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 #include <filesystem>
 #include <format>
 
 #include <clang-c/Index.h>
 
+#include <LuaWrapperGenerator/CodeWriter.hpp>
+#include <LuaWrapperGenerator/OutputManifest.hpp>
+#include <LuaWrapperGenerator/Hash.hpp>
+#include <LuaWrapperGenerator/Symbol.hpp>
+
 namespace RC::LuaWrapperGenerator
 {
     class Function;
     struct FunctionParam;
     struct Class;
     class Enum;
+    class IRWriter;
+    class IRReader;
 
     namespace Type
     {
@@ -30,10 +39,85 @@ namespace RC::LuaWrapperGenerator
     auto scope_as_function_name(std::string_view scope) -> std::string;
 
     using FunctionContainer = std::unordered_map<std::string, Function>;
-    using ClassContainer = std::unordered_map<std::string, Class>;
+    // Classes are keyed by "scope::name".
+    // The hash and equality are transparent so that a class can be looked up by its scope and name without building the key.
+    struct ClassKey
+    {
+        std::string_view fully_qualified_scope{};
+        std::string_view name{};
+    };
+
+    struct ClassKeyHash
+    {
+        using is_transparent = void;
+
+        auto operator()(std::string_view key) const -> size_t
+        {
+            return static_cast<size_t>(Hasher{}.update_bytes(key).get());
+        }
+
+        auto operator()(const std::string& key) const -> size_t
+        {
+            return (*this)(std::string_view{key});
+        }
+
+        // Must hash to the same value as the key that's built from the scope and name.
+        auto operator()(const ClassKey& key) const -> size_t
+        {
+            return static_cast<size_t>(Hasher{}.update_bytes(key.fully_qualified_scope).update_bytes("::").update_bytes(key.name).get());
+        }
+    };
+
+    struct ClassKeyEqual
+    {
+        using is_transparent = void;
+
+        auto operator()(std::string_view a, std::string_view b) const -> bool { return a == b; }
+        auto operator()(const ClassKey& a, std::string_view b) const -> bool { return (*this)(b, a); }
+        auto operator()(std::string_view a, const ClassKey& b) const -> bool
+        {
+            return a.size() == b.fully_qualified_scope.size() + 2 + b.name.size() &&
+                   a.starts_with(b.fully_qualified_scope) &&
+                   a.substr(b.fully_qualified_scope.size(), 2) == "::" &&
+                   a.ends_with(b.name);
+        }
+    };
+
+    using ClassContainer = std::unordered_map<std::string, Class, ClassKeyHash, ClassKeyEqual>;
     using EnumContainer = std::unordered_map<std::string, Enum>;
     using FunctionProtoContainer = std::unordered_map<std::string, Type::FunctionProto*>;
 
+    // The order of an unordered container depends on the standard library, so code generation iterates the containers through these instead.
+    // That way the same input always produces byte-identical files, which is what lets build caches skip recompiling the bindings.
+    // The keys of the containers above are fully qualified names, so that's what everything is sorted by.
+    template<typename Map>
+    auto sorted_by_key(const Map& map) -> std::vector<std::pair<const typename Map::key_type&, const typename Map::mapped_type&>>
+    {
+        std::vector<const typename Map::value_type*> entries{};
+        entries.reserve(map.size());
+        for (const auto& entry : map)
+        {
+            entries.emplace_back(&entry);
+        }
+        std::sort(entries.begin(), entries.end(), [](const auto* a, const auto* b) { return a->first < b->first; });
+
+        std::vector<std::pair<const typename Map::key_type&, const typename Map::mapped_type&>> sorted{};
+        sorted.reserve(entries.size());
+        for (const auto* entry : entries)
+        {
+            sorted.emplace_back(entry->first, entry->second);
+        }
+        return sorted;
+    }
+
+    template<typename Set>
+    auto sorted_values(const Set& set) -> std::vector<typename Set::value_type>
+    {
+        std::vector<typename Set::value_type> sorted{set.begin(), set.end()};
+        std::sort(sorted.begin(), sorted.end());
+        return sorted;
+    }
+
     struct DoNotParseException : public std::exception
     {
         std::string reason{};
@@ -59,19 +143,45 @@ namespace RC::LuaWrapperGenerator
 
     auto add_function_to_container(FunctionContainer& container, const std::string& function_name, const std::string& parent_name, const std::string& full_path_to_file, const std::string& fully_qualified_scope, const std::string& parent_scope, Class* contained_in_class = nullptr, IsFunctionScopeless = IsFunctionScopeless::No) -> Function&;
 
+    // A param matches when an overload with the same number of params has a param in the same position with the same type name, or when both are strings.
+    // Each position can be matched by a different overload, which is why the keys are per position rather than per signature.
+    struct OverloadParamKey
+    {
+        size_t num_params{};
+        size_t param_index{};
+        bool is_any_string{};
+        // Empty for the key that matches any string type.
+        std::string type_name{};
+
+        auto operator==(const OverloadParamKey&) const -> bool = default;
+    };
+
+    struct OverloadParamKeyHash
+    {
+        auto operator()(const OverloadParamKey& key) const -> size_t
+        {
+            return static_cast<size_t>(Hasher{}.update(key.num_params).update(key.param_index).update(key.is_any_string).update(key.type_name).get());
+        }
+    };
+
     class Function
     {
     private:
         std::string m_name{};
         std::string m_lua_name{};
         std::string m_wrapper_name{};
-        std::string m_parent_name{};
-        std::string m_parent_scope{};
-        std::string m_fully_qualified_scope{};
+        Symbol m_parent_name{};
+        Symbol m_parent_scope{};
+        Symbol m_fully_qualified_scope{};
         std::string m_scope_override{};
-        std::string m_full_path_to_file{};
+        Symbol m_full_path_to_file{};
         std::vector<std::vector<FunctionParam>> m_overloads{};
-        std::unique_ptr<Type::Base> m_return_type{};
+        // Keys for every param of the first 'm_num_indexed_overloads' overloads.
+        // Overloads are only ever appended so the index catches up on the new ones the next time 'has_matching_overload' is called.
+        mutable std::unordered_set<OverloadParamKey, OverloadParamKeyHash> m_overload_param_keys{};
+        mutable size_t m_num_indexed_overloads{};
+        // Owned by the code generator that interned it.
+        Type::Base* m_return_type{};
         Class* m_containing_class{};
         bool m_is_custom_redirector{false};
         bool m_shares_file_with_containing_class{true};
@@ -104,9 +214,9 @@ namespace RC::LuaWrapperGenerator
     public:
         //auto add_param(std::string param_name, std::unique_ptr<Type::Base> param_type) -> void;
 
-        auto set_return_type(std::unique_ptr<Type::Base> type) -> void { m_return_type = std::move(type); };
+        auto set_return_type(Type::Base* type) -> void { m_return_type = type; };
         template<typename T>
-        auto set_return_type() -> void { set_return_type(T::static_class); }
+        auto set_return_type() -> void { set_return_type(T::static_class.get()); }
 
         auto set_is_custom_redirector(bool new_is_custom_redirector) -> void { m_is_custom_redirector = new_is_custom_redirector; }
         auto is_custom_redirector() const -> bool { return m_is_custom_redirector; }
@@ -134,34 +244,38 @@ namespace RC::LuaWrapperGenerator
 
         auto get_fully_qualified_scope() const -> std::string_view { return m_fully_qualified_scope; }
 
-        auto set_parent_name(const std::string& new_parent_name) -> void { m_parent_name = new_parent_name; }
+        auto set_parent_name(std::string_view new_parent_name) -> void { m_parent_name = Symbol{new_parent_name}; }
         auto get_parent_name() const -> std::string_view { return m_parent_name; }
 
         auto set_lua_name(const std::string& new_lua_name) -> void { m_lua_name = new_lua_name; }
         auto get_lua_name() const -> std::string_view { return m_lua_name; }
 
-        auto set_parent_scope(const std::string& new_parent_scope) -> void { m_parent_scope = new_parent_scope; }
+        auto set_parent_scope(std::string_view new_parent_scope) -> void { m_parent_scope = Symbol{new_parent_scope}; }
         auto get_parent_scope() const -> std::string_view { return m_parent_scope; }
 
         auto get_overloads() const -> const std::vector<std::vector<FunctionParam>>& { return m_overloads; }
         auto get_overloads() -> std::vector<std::vector<FunctionParam>>& { return m_overloads; }
-        auto get_return_type() const -> Type::Base* { return m_return_type.get(); }
+        auto get_return_type() const -> Type::Base* { return m_return_type; }
         auto get_full_path_to_file() const -> std::string_view { return m_full_path_to_file; }
 
         auto set_containing_class(Class* new_containing_class) -> void { m_containing_class = new_containing_class; }
         auto get_containing_class() const -> const Class* { return m_containing_class; }
 
-        auto generate_lua_wrapper_function_body() const -> std::string;
-        auto generate_lua_return_statement() const -> std::string;
+        // Returns true if every param in 'params' matches a param in the same position of an existing overload with the same number of params.
+        // A function without params is considered to already exist as long as there's at least one overload.
+        auto has_matching_overload(const std::vector<FunctionParam>& params) const -> bool;
+
+        auto generate_lua_wrapper_function_body(CodeWriter& out) const -> void;
+        auto generate_lua_return_statement(CodeWriter& out) const -> void;
     };
 
     struct Class
     {
         class CodeGenerator& code_generator;
-        const std::string name;
-        const std::string fully_qualified_scope;
+        const Symbol name;
+        const Symbol fully_qualified_scope;
         std::string scope_override;
-        const std::string full_path_to_file;
+        const Symbol full_path_to_file;
         FunctionContainer metamethods{};
         FunctionContainer static_functions{};
         FunctionContainer constructors{};
@@ -169,7 +283,9 @@ namespace RC::LuaWrapperGenerator
         bool has_parameterless_constructor{};
 
     private:
-        std::unordered_set<const Class*> bases{};
+        // Direct bases, sorted by scope and name so that walking them gives the same order on every run.
+        // Kept sorted as bases are added so that lookups like 'find_static_function_by_name' don't have to sort.
+        std::vector<const Class*> bases{};
 
     public:
         Class(CodeGenerator& code_generator, std::string name, std::string fully_qualified_scope, std::string full_path_to_file) : code_generator(code_generator), name(std::move(name)), fully_qualified_scope(std::move(fully_qualified_scope)), full_path_to_file(std::move(full_path_to_file)) {}
@@ -177,28 +293,32 @@ namespace RC::LuaWrapperGenerator
     public:
         auto add_class(const std::string& class_name, const std::string& full_path_to_file, const std::string& fully_qualified_scope) -> Class&;
         auto find_static_function_by_name(std::string_view function_name) const -> const Function*;
+        // Every base, direct or not, depth first.
         auto get_bases() const -> std::vector<const Class*>;
+        auto get_direct_bases() const -> const std::vector<const Class*>& { return bases; }
         auto get_metamethod_by_name(const std::string& metamethod_name) const -> const Function*;
-        auto get_mutable_bases() -> std::unordered_set<const Class*>&;
-
-        auto generate_metamethods_map() const -> std::string;
-        auto generate_member_functions_map() const -> std::string;
-        auto generate_member_functions() const -> std::string;
-        auto generate_constructor() const -> std::string;
-        auto generate_setup_function() const -> std::string;
-        auto generate_create_instance_of_function() const -> std::string;
-        auto generate_internal_get_self_function() const -> std::string;
+        // Does nothing if 'base' already is a direct base.
+        auto add_base(const Class* base) -> void;
+        auto clear_bases() -> void { bases.clear(); }
+
+        auto generate_metamethods_map(CodeWriter& out) const -> void;
+        auto generate_member_functions_map(CodeWriter& out) const -> void;
+        auto generate_member_functions(CodeWriter& out) const -> void;
+        auto generate_constructor(CodeWriter& out) const -> void;
+        auto generate_setup_function(CodeWriter& out) const -> void;
+        auto generate_create_instance_of_function(CodeWriter& out) const -> void;
+        auto generate_internal_get_self_function(CodeWriter& out) const -> void;
 
     private:
-        auto generate_metamethods_map_contents() const -> std::string;
-        auto generate_member_functions_map_contents() const -> std::string;
+        auto generate_metamethods_map_contents(CodeWriter& out) const -> void;
+        auto generate_member_functions_map_contents(CodeWriter& out) const -> void;
     };
 
     class Enum
     {
     private:
         const std::string m_name{};
-        const std::string m_fully_qualified_scope{};
+        const Symbol m_fully_qualified_scope{};
         std::vector<std::pair<std::string, uint64_t>> m_keys_and_values{};
 
     public:
@@ -213,17 +333,58 @@ namespace RC::LuaWrapperGenerator
 
     namespace Type
     {
+        // Every type class has a kind.
+        // A type stores a mask of its own kind and the kinds of its template bases so that 'is_a' doesn't need any virtual calls.
+        // Type patches use the kinds from 'FirstPatchKind' onwards.
+        enum class TypeKind : uint8_t
+        {
+            EmptyBaseType,
+            Void,
+            NumericBase,
+            Int8,
+            Int16,
+            Int32,
+            Int64,
+            UInt8,
+            UInt16,
+            UInt32,
+            UInt64,
+            Float,
+            Double,
+            StringBase,
+            CString,
+            CWString,
+            String,
+            WString,
+            AutoString,
+            CustomStruct,
+            Enum,
+            Bool,
+            FunctionProto,
+
+            FirstPatchKind = 32,
+            Max = 64,
+        };
+        using TypeKindMask = uint64_t;
+
+        constexpr auto kind_bit(TypeKind kind) -> TypeKindMask
+        {
+            return TypeKindMask{1} << static_cast<uint8_t>(kind);
+        }
+
         class Base
         {
         private:
             const Container& m_container;
+            TypeKind m_kind;
+            TypeKindMask m_kinds;
             bool m_is_pointer{};
             bool m_is_ref{};
             bool m_is_const{};
 
         public:
-            explicit Base(const Container& container) : m_container(container) {}
-            ~Base() = default;
+            Base(const Container& container, TypeKind kind, TypeKindMask kinds) : m_container(container), m_kind(kind), m_kinds(kinds) {}
+            virtual ~Base() = default;
 
         public:
             virtual auto get_static_class() const -> Base* = 0;
@@ -249,28 +410,13 @@ namespace RC::LuaWrapperGenerator
             auto set_is_const(bool new_is_const) -> void  { m_is_const = new_is_const; }
             auto is_const() const -> bool { return m_is_const; }
             auto get_container() const -> const Container& { return m_container; }
+            auto get_kind() const -> TypeKind { return m_kind; }
 
+            // True if this type is a 'T' or if 'T' is one of its template bases, like 'StringBase' for 'CString'.
             template<typename T>
             [[nodiscard]] auto is_a() const -> bool
             {
-                if (get_static_class() == T::static_class.get()) { return true; }
-                auto super = get_super();
-
-                while (super && super != this)
-                {
-                    if (super == T::static_class.get())
-                    {
-                        return true;
-                    }
-                    else
-                    {
-                        auto* next_super = super->get_super();
-                        if (next_super == super) { break; }
-                        super = next_super;
-                    }
-                }
-
-                return false;
+                return (m_kinds & kind_bit(T::kind)) != 0;
             }
         };
 
@@ -279,17 +425,21 @@ namespace RC::LuaWrapperGenerator
         {
         public:
             static inline std::unique_ptr<T> static_class{};
+            static constexpr TypeKindMask ancestor_kinds{};
 
         public:
             virtual auto get_static_class() const -> Base* override { return static_class.get(); }
             virtual auto get_super() const -> Base* override { return static_class.get(); };
 
         public:
-            explicit BaseTemplate(const Container& container) : Base(container) {}
+            explicit BaseTemplate(const Container& container) : Base(container, T::kind, kind_bit(T::kind) | T::ancestor_kinds) {}
         };
 
         class EmptyBaseType : public BaseTemplate<EmptyBaseType>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::EmptyBaseType;
+
         public:
             virtual auto get_super() const -> Base* override { return nullptr; };
             virtual auto generate_cxx_name() const -> std::string override { throw std::runtime_error{"Direct call to 'EmptyBaseType::generate_cxx_name' not allowed"}; }
@@ -300,6 +450,9 @@ namespace RC::LuaWrapperGenerator
 
         class Void : public BaseTemplate<Void>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Void;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "void"; };
@@ -314,6 +467,10 @@ namespace RC::LuaWrapperGenerator
         template<typename T>
         class NumericBaseTemplate : public BaseTemplate<T>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::NumericBase;
+            static constexpr TypeKindMask ancestor_kinds = kind_bit(TypeKind::NumericBase);
+
         protected:
             virtual auto is_floating_point() const -> bool { return false; }
 
@@ -378,6 +535,9 @@ namespace RC::LuaWrapperGenerator
 
         class Int8 : public NumericBaseTemplate<Int8>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Int8;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "int8_t"; };
@@ -388,6 +548,9 @@ namespace RC::LuaWrapperGenerator
 
         class Int16 : public NumericBaseTemplate<Int16>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Int16;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "int16_t"; };
@@ -398,6 +561,9 @@ namespace RC::LuaWrapperGenerator
 
         class Int32 : public NumericBaseTemplate<Int32>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Int32;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "int32_t"; };
@@ -408,6 +574,9 @@ namespace RC::LuaWrapperGenerator
 
         class Int64 : public NumericBaseTemplate<Int64>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Int64;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "int64_t"; };
@@ -418,6 +587,9 @@ namespace RC::LuaWrapperGenerator
 
         class UInt8 : public NumericBaseTemplate<UInt8>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::UInt8;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "uint8_t"; };
@@ -428,6 +600,9 @@ namespace RC::LuaWrapperGenerator
 
         class UInt16 : public NumericBaseTemplate<UInt16>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::UInt16;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "uint16_t"; };
@@ -438,6 +613,9 @@ namespace RC::LuaWrapperGenerator
 
         class UInt32 : public NumericBaseTemplate<UInt32>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::UInt32;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "uint32_t"; };
@@ -448,6 +626,9 @@ namespace RC::LuaWrapperGenerator
 
         class UInt64 : public NumericBaseTemplate<UInt64>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::UInt64;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "uint64_t"; };
@@ -458,6 +639,9 @@ namespace RC::LuaWrapperGenerator
 
         class Float : public NumericBaseTemplate<Float>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Float;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "float"; };
@@ -469,6 +653,9 @@ namespace RC::LuaWrapperGenerator
 
         class Double : public NumericBaseTemplate<Double>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Double;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string override;
             virtual auto generate_cxx_name() const -> std::string override { return "double"; };
@@ -482,6 +669,9 @@ namespace RC::LuaWrapperGenerator
         class StringBaseTemplate : public BaseTemplate<T>
         {
         public:
+            static constexpr TypeKind kind = TypeKind::StringBase;
+            static constexpr TypeKindMask ancestor_kinds = kind_bit(TypeKind::StringBase);
+
             //virtual auto generate_lua_stack_validation_condition(int stack_index) const -> std::string override { throw std::runtime_error{"Direct call to 'StringBaseTemplate::generate_lua_stack_validation_condition' not allowed"}; };
             virtual auto generate_lua_stack_validation_condition(int stack_index) const -> std::string override
             {
@@ -503,6 +693,9 @@ namespace RC::LuaWrapperGenerator
 
         class CString : public StringBaseTemplate<CString>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::CString;
+
         public:
             virtual auto get_super() const -> Base* override { return StringBaseTemplate<EmptyBaseType>::static_class.get(); };
             virtual auto get_fully_qualified_type_name() const -> std::string override;
@@ -521,6 +714,9 @@ namespace RC::LuaWrapperGenerator
 
         class CWString : public StringBaseTemplate<CWString>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::CWString;
+
         public:
             virtual auto get_super() const -> Base* override { return StringBaseTemplate<EmptyBaseType>::static_class.get(); };
             virtual auto get_fully_qualified_type_name() const -> std::string override;
@@ -540,6 +736,9 @@ namespace RC::LuaWrapperGenerator
 
         class String : public StringBaseTemplate<String>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::String;
+
         public:
             virtual auto get_super() const -> Base* override { return StringBaseTemplate<EmptyBaseType>::static_class.get(); };
             virtual auto get_fully_qualified_type_name() const -> std::string override;
@@ -558,6 +757,9 @@ namespace RC::LuaWrapperGenerator
 
         class WString : public StringBaseTemplate<WString>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::WString;
+
         public:
             virtual auto get_super() const -> Base* override { return StringBaseTemplate<EmptyBaseType>::static_class.get(); };
             virtual auto get_fully_qualified_type_name() const -> std::string override;
@@ -577,6 +779,9 @@ namespace RC::LuaWrapperGenerator
 
         class AutoString : public StringBaseTemplate<AutoString>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::AutoString;
+
         public:
             bool m_is_wide_string{true};
 
@@ -599,9 +804,12 @@ namespace RC::LuaWrapperGenerator
 
         class CustomStruct : public BaseTemplate<CustomStruct>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::CustomStruct;
+
         private:
-            const std::string m_type_name{};
-            std::string m_fully_qualified_scope{};
+            const Symbol m_type_name{};
+            Symbol m_fully_qualified_scope{};
             bool m_is_struct_forward_declaration{};
             bool m_is_class_forward_declaration{};
             bool m_move_on_construction{};
@@ -635,9 +843,9 @@ namespace RC::LuaWrapperGenerator
             }
             auto is_class_forward_declaration() const -> bool { return m_is_class_forward_declaration; }
 
-            auto set_fully_qualified_scope(std::string new_fully_qualified_scope) -> void
+            auto set_fully_qualified_scope(std::string_view new_fully_qualified_scope) -> void
             {
-                m_fully_qualified_scope = std::move(new_fully_qualified_scope);
+                m_fully_qualified_scope = Symbol{new_fully_qualified_scope};
             }
             auto get_fully_qualified_scope() const -> std::string_view { return m_fully_qualified_scope; }
 
@@ -650,6 +858,9 @@ namespace RC::LuaWrapperGenerator
         /**/
         class Enum : public BaseTemplate<Enum>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Enum;
+
         private:
             const std::string m_enum_name{};
 
@@ -663,11 +874,17 @@ namespace RC::LuaWrapperGenerator
         public:
             explicit Enum(const Container& container) : BaseTemplate<Enum>(container) {}
              Enum(const Container& container, std::string enum_name) : BaseTemplate<Enum>(container), m_enum_name(std::move(enum_name)) {}
+
+        public:
+            auto get_enum_name() const -> std::string_view { return m_enum_name; }
         };
         //*/
 
         class Bool : public BaseTemplate<Bool>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::Bool;
+
         public:
             virtual auto get_fully_qualified_type_name() const -> std::string { return std::format("bool{}{}", is_pointer() ? "*" : "", is_ref() ? "&" : ""); };
             virtual auto generate_cxx_name() const -> std::string override { return "bool"; };
@@ -681,8 +898,12 @@ namespace RC::LuaWrapperGenerator
 
         class FunctionProto : public BaseTemplate<FunctionProto>
         {
+        public:
+            static constexpr TypeKind kind = TypeKind::FunctionProto;
+
         private:
-            std::vector<std::unique_ptr<Base>> m_param_types{};
+            // Owned by the code generator that interned them.
+            std::vector<Base*> m_param_types{};
             Base* m_return_type{};
             const std::string m_function_proto{};
             Function m_function{};
@@ -701,8 +922,10 @@ namespace RC::LuaWrapperGenerator
             explicit FunctionProto(const Container& container, const std::string& function_proto) : BaseTemplate<FunctionProto>(container), m_function_proto(function_proto) {}
 
         public:
-            auto add_param(std::unique_ptr<Base> param) -> void { m_param_types.emplace_back(std::move(param)); };
+            auto add_param(Base* param) -> void { m_param_types.emplace_back(param); };
+            auto get_param_types() const -> const std::vector<Base*>& { return m_param_types; }
             auto set_return_type(Base* new_return_type) -> void { m_return_type = new_return_type; }
+            auto get_return_type() const -> Base* { return m_return_type; }
 
             auto has_storage() const -> bool { return m_has_storage; }
             auto set_has_storage(bool new_has_storage) -> void { m_has_storage = new_has_storage; }
@@ -714,7 +937,7 @@ namespace RC::LuaWrapperGenerator
 
             auto generate_function_signature(bool real_function_pointer) const -> std::string;
             auto generate_function_signature_as_function_name() const -> std::string;
-            auto generate_lua_wrapper_function() const -> std::string;
+            auto generate_lua_wrapper_function(CodeWriter& out) const -> void;
         };
 
         auto generate_static_class_types(const Container& container) -> void;
@@ -724,7 +947,8 @@ namespace RC::LuaWrapperGenerator
     {
         // TODO: Come up with a good way to store types so that they can be used with ease later to determine what kind of Lua code to generate.
         const std::string name;
-        std::unique_ptr<Type::Base> type;
+        // Owned by the code generator that interned it.
+        Type::Base* type;
     };
 
     struct TypePatch
@@ -734,6 +958,11 @@ namespace RC::LuaWrapperGenerator
         using StringReturnNoParamCallable = std::string (*)();
         using GeneratePerClassStaticFunctionsCallable = std::string (*)(const Class&);
         using CXTypeToTypePostCallable = void (*)(Type::Base*);
+        // Must return false without writing anything if the type wasn't created by this patch.
+        using SerializeTypeCallable = bool (*)(const Type::Base*, IRWriter&);
+        using DeserializeTypeCallable = std::unique_ptr<Type::Base> (*)(CodeGenerator&, IRReader&);
+        // Calls 'CodeGenerator::register_spelled_type' for every type that the patch recognizes by its spelling alone.
+        using RegisterSpelledTypesCallable = void (*)(CodeGenerator&);
 
         TypePatchGenerateStateFilePre generate_state_file_pre{};
         TypePatchGenerateStateFilePre generate_state_file_post{};
@@ -741,6 +970,31 @@ namespace RC::LuaWrapperGenerator
         CXTypeToTypePostCallable cxtype_to_type_post{};
         StringReturnNoParamCallable generate_lua_setup_state_function_post{};
         GeneratePerClassStaticFunctionsCallable generate_per_class_static_functions{};
+        SerializeTypeCallable serialize_type{};
+        DeserializeTypeCallable deserialize_type{};
+        RegisterSpelledTypesCallable register_spelled_types{};
+    };
+
+    // Everything that affects the code generated for a built-in type.
+    // The strings point into the type that the key was made for, so a key must not outlive its type.
+    // Function protos also compare their params and return type, which are interned before the proto so a pointer compare is enough.
+    struct TypeKey
+    {
+        Type::TypeKind kind{};
+        uint8_t flags{};
+        std::string_view fully_qualified_scope{};
+        std::string_view name{};
+        const Type::FunctionProto* function_proto{};
+
+        // Returns false for types that can't be keyed, which are the types created by type patches.
+        static auto make(const Type::Base* type, TypeKey& out_key) -> bool;
+
+        auto operator==(const TypeKey& other) const -> bool;
+    };
+
+    struct TypeKeyHash
+    {
+        auto operator()(const TypeKey& key) const -> size_t;
     };
 
     class CodeGenerator
@@ -749,10 +1003,25 @@ namespace RC::LuaWrapperGenerator
         std::filesystem::path m_output_path;
         Container m_container;
         const std::vector<TypePatch>& m_type_patches;
+        // Non-null when this generator only holds the output of some of the translation units.
+        // The contents are moved into the owner by 'merge_partial_output' once parsing is done.
+        // Classes and types created by a partial generator refer to the owner so that they stay valid after the merge.
+        CodeGenerator* m_owner{};
+        // Every type that's used by the functions of this generator.
+        // Types are never freed before the generator, so functions and params can refer to them with plain pointers.
+        std::vector<std::unique_ptr<Type::Base>> m_types{};
+        // Key of a type -> the interned type.
+        // Two types with the same key generate the same code, so they can share one node.
+        std::unordered_map<TypeKey, Type::Base*, TypeKeyHash> m_interned_types{};
+        // Spelling of a type, like 'std::string' -> function that creates the type.
+        // Checked with one lookup before a type is converted by its kind.
+        std::unordered_map<std::string, TypePatch::TypePatchCXTypeToTypeCallable> m_spelled_types{};
+        // Number of threads that generate the code for classes.
+        size_t m_num_jobs{1};
 
     public:
         CodeGenerator() = delete;
-        explicit CodeGenerator(std::filesystem::path output_path, const std::vector<TypePatch>& type_patches) : m_output_path(std::move(output_path)), m_type_patches(type_patches) {}
+        explicit CodeGenerator(std::filesystem::path output_path, const std::vector<TypePatch>& type_patches, CodeGenerator* owner = nullptr) : m_output_path(std::move(output_path)), m_type_patches(type_patches), m_owner(owner) {}
 
     public:
         auto add_class(const std::string& class_name, const std::string& full_path_to_file, const std::string& fully_qualified_scope) -> Class&;
@@ -765,29 +1034,73 @@ namespace RC::LuaWrapperGenerator
     public:
         auto add_class_to_container(const std::string& class_name, ClassContainer& container, const std::string& full_path_to_file, const std::string& fully_qualified_scope) -> Class&;
 
+        // Moves everything from 'partial' into this generator.
+        // Classes, functions and overloads that already exist are merged the same way the parser handles duplicates within a single translation unit.
+        auto merge_partial_output(CodeGenerator& partial) -> void;
+        // Must be called after the last call to 'merge_partial_output'.
+        auto rebuild_function_proto_container() -> void;
+
+        // Takes ownership of 'type' and returns the identical type that's stored in this generator.
+        // If an identical type was interned earlier, 'type' is destroyed and the earlier type is returned.
+        // The returned type stays valid for as long as this generator, or the generator that it's merged into, is alive.
+        auto intern_type(std::unique_ptr<Type::Base> type) -> Type::Base*;
+        auto get_num_types() const -> size_t { return m_types.size(); }
+        // A type that's spelled exactly like 'spelling' is created by 'create_type', replacing any earlier registration for the same spelling.
+        auto register_spelled_type(std::string spelling, TypePatch::TypePatchCXTypeToTypeCallable create_type) -> void
+        {
+            m_spelled_types.insert_or_assign(std::move(spelling), create_type);
+        }
+        auto find_spelled_type(const std::string& spelling) const -> TypePatch::TypePatchCXTypeToTypeCallable
+        {
+            auto it = m_spelled_types.find(spelling);
+            return it == m_spelled_types.end() ? nullptr : it->second;
+        }
+        // Drops everything that was parsed or merged into this generator so that the output can be built again from scratch.
+        auto clear() -> void
+        {
+            m_container = Container{};
+            m_interned_types.clear();
+            m_types.clear();
+        }
+
+        // Writes the whole container as binding IR so that code can be generated from it later without parsing again.
+        auto write_ir_file(const std::filesystem::path& ir_file) const -> void;
+        // Loads a container written by 'write_ir_file' into this generator, which must be empty.
+        // The same type patches must have been added as when the file was written.
+        auto read_ir_file(const std::filesystem::path& ir_file) -> void;
+
+    private:
+        auto remap_merged_bases(const std::unordered_map<const Class*, Class*>& merged_classes) -> void;
+
     private:
-        auto generate_setup_functions_map() const -> std::string;
-        auto generate_lua_dynamic_setup_state_function() const -> std::string;
-        auto generate_lua_setup_state_functions() const -> std::string;
-        auto generate_free_functions() const -> std::string;
-        auto generate_lua_setup_global_free_functions() const -> std::string;
-        auto generate_lua_setup_enums() const -> std::string;
-        auto generate_convertible_to_set() const -> std::string;
-        auto generate_builtin_to_lua_from_heap_functions() const -> std::string;
-        auto generate_utility_member_functions() const -> std::string;
+        auto generate_setup_functions_map(CodeWriter& out) const -> void;
+        auto generate_lua_dynamic_setup_state_function(CodeWriter& out) const -> void;
+        auto generate_lua_setup_state_functions(CodeWriter& out) const -> void;
+        auto generate_free_functions(CodeWriter& out) const -> void;
+        auto generate_lua_setup_global_free_functions(CodeWriter& out) const -> void;
+        auto generate_lua_setup_enums(CodeWriter& out) const -> void;
+        auto generate_convertible_to_set(CodeWriter& out) const -> void;
+        auto generate_builtin_to_lua_from_heap_functions(CodeWriter& out) const -> void;
+        auto generate_utility_member_functions(CodeWriter& out) const -> void;
 
     public:
-        auto generate_lua_setup_file() const -> void;
+        // Zero means one job per hardware thread.
+        auto set_num_jobs(size_t num_jobs) -> void;
+        auto generate_lua_setup_file(OutputManifest& output_manifest) const -> void;
 
         // States/<StateName>/Main.hpp
     public:
-        auto generate_state_file_pre() const -> std::string;
-        auto generate_state_file() const -> void;
+        auto generate_state_file_pre(CodeWriter& out) const -> void;
+        auto generate_state_file(OutputManifest& output_manifest) const -> void;
 
         auto get_type_patches() const -> const std::vector<TypePatch>& { return m_type_patches; };
         auto get_container() const -> const Container& { return m_container; };
         auto get_container() -> Container& { return m_container; };
         auto debug_get_container() const -> const Container& { return m_container; };
+        auto get_output_path() const -> const std::filesystem::path& { return m_output_path; }
+        auto get_owner() -> CodeGenerator& { return m_owner ? *m_owner : *this; }
+        // The container that types created by this generator must use when looking up classes during code generation.
+        auto get_lookup_container() const -> const Container& { return m_owner ? m_owner->m_container : m_container; }
     };
 }
 
@@ -3,10 +3,15 @@
 
 #include <optional>
 #include <filesystem>
+#include <map>
 #include <unordered_map>
 #include <memory>
+#include <functional>
 
 #include <LuaWrapperGenerator/CodeGenerator.hpp>
+#include <LuaWrapperGenerator/BindingIR.hpp>
+#include <LuaWrapperGenerator/ParseCache.hpp>
+#include <LuaWrapperGenerator/CompilationDatabase.hpp>
 #include <File/Macros.hpp>
 
 // This needs a ton of work.
@@ -19,6 +24,7 @@ namespace RC::LuaWrapperGenerator
 {
     enum class GenerateThinClass { Yes, No };
     enum class IsStaticFunction { Yes, No };
+    enum class WithAnnotationRequests { Yes, No };
 
     struct CustomMemberFunction
     {
@@ -50,6 +56,14 @@ namespace RC::LuaWrapperGenerator
 
     auto cxtype_to_type(CodeGenerator&, const CXType&, IsPointer = IsPointer::No) -> std::unique_ptr<Type::Base>;
 
+    struct ConvertedType
+    {
+        // Null if the type can't be converted.
+        Type::Base* type{};
+        std::string reason{};
+        bool is_verbose{};
+    };
+
     class CodeParser
     {
     private:
@@ -74,21 +88,114 @@ namespace RC::LuaWrapperGenerator
         std::unordered_map<std::string, std::pair<std::string, std::string>> m_out_of_line_enums{};
         CodeGenerator m_parser_output;
         std::filesystem::path m_code_root;
+        // Kind, spelling and canonical spelling of a type -> the interned type, or why it can't be converted.
+        // Most types are used by many functions so each one only goes through 'cxtype_to_type' and the type patches once per translation unit.
+        std::unordered_map<std::string, ConvertedType> m_converted_types{};
         std::vector<TypePatch> m_type_patches{};
         std::vector<std::string> m_files_to_parse{};
         const char** m_compiler_flags{};
         int m_num_compiler_flags{};
+        // Normalized main file path -> compiler args from compile_commands.json, shared with the workers.
+        // Files that aren't in here are parsed with 'm_compiler_flags'.
+        std::shared_ptr<const std::unordered_map<std::string, std::vector<std::string>>> m_per_file_compiler_args{};
+        // Indexes into 'm_files_to_parse' in the order that the files are handed out to workers, the most expensive files first.
+        std::vector<size_t> m_file_schedule{};
+        // Seconds it took to parse each file in 'm_files_to_parse', zero if the file wasn't parsed.
+        std::vector<double> m_file_parse_durations{};
+        size_t m_num_jobs{1};
+        bool m_unity_build{};
+        // Every translation unit is parsed with this precompiled header if it isn't empty.
+        std::string m_precompiled_header{};
+        // Headers to build the precompiled header from at the start of 'parse', empty if the precompiled header already exists.
+        std::vector<std::string> m_precompiled_header_sources{};
+        // Normalized main file path -> the precompiled header that was built with the flags of that file from compile_commands.json.
+        // Files that aren't in here use 'm_precompiled_header' if they're parsed with 'm_compiler_flags', and no precompiled header otherwise.
+        std::shared_ptr<const std::unordered_map<std::string, std::string>> m_per_file_precompiled_headers{};
+        // Every file that the precompiled headers were built from, with the time each was last written when it was read.
+        // Watch mode builds the precompiled headers again when one of these changes.
+        std::vector<std::pair<std::string, std::filesystem::file_time_type>> m_precompiled_header_dependencies{};
+        // Shared with the workers, null if the parse cache is disabled.
+        std::shared_ptr<ParseCache> m_parse_cache{};
+        // USRs of the classes, enums and functions that this parser has already processed.
+        // Headers are included by most files so without this the same declarations would be extracted again for every file.
+        std::unordered_set<std::string> m_processed_declarations{};
+        size_t m_num_skipped_declarations{};
+        // Set once the requests in every project file have been collected by 'collect_annotation_requests', which happens before any file is parsed.
+        // Workers are given a copy of every request so the output of a file doesn't depend on which worker parsed it.
+        bool m_has_collected_annotation_requests{};
+        // Hash of every annotation comment that was collected up front, part of the parse cache key.
+        uint64_t m_annotation_requests_hash{};
+        // Every file that was scanned when the requests were collected, a change to one of them means the requests must be collected again.
+        std::unordered_set<std::string> m_project_files{};
+        // Every file included by the last file parsed, only collected when the parse cache is enabled.
+        std::vector<std::string> m_include_closure{};
+        // Normalized directories ending in '/'.
+        // Declarations in a file under an allowed directory are always visited, even if they're in a system header or under a denied directory.
+        std::vector<std::string> m_allowed_path_prefixes{};
+        std::vector<std::string> m_denied_path_prefixes{};
+        bool m_skip_system_headers{false};
+        // File -> whether declarations in it are skipped, cleared for every translation unit since CXFile handles belong to one translation unit.
+        std::unordered_map<CXFile, bool> m_rejected_files{};
+        size_t m_num_visited_cursors{};
+        size_t m_num_rejected_cursors{};
+        // This process only parses the files that belong to shard 'm_shard_index' out of 'm_shard_count'.
+        size_t m_shard_index{};
+        size_t m_shard_count{1};
 
     public:
         CodeParser(std::vector<std::string> files_to_parse, const char** compiler_flags, int num_compiler_flags, std::filesystem::path output_path, std::filesystem::path code_root);
         ~CodeParser();
 
     private:
-        auto cxtype_to_type(const CXType& cxtype, IsPointer is_pointer = IsPointer::No) -> std::unique_ptr<Type::Base>;
-        auto cursor_to_type(const CXCursor& cursor) -> std::unique_ptr<Type::Base>;
+        // Creates a worker that parses into a partial output which is later merged into 'owner_output'.
+        CodeParser(CodeGenerator& owner_output, const CodeParser& owner);
+
+    private:
+        // The returned type is interned by the parser output.
+        auto cxtype_to_type(const CXType& cxtype, IsPointer is_pointer = IsPointer::No) -> Type::Base*;
+        auto cursor_to_type(const CXCursor& cursor) -> Type::Base*;
 
     public:
         auto add_type_patch(TypePatch&& type_patch) -> void;
+        // Number of translation units to parse at the same time, each on its own thread with its own index.
+        auto set_num_jobs(size_t num_jobs) -> void;
+        // Parses every file as part of one synthetic translation unit so that shared headers are only parsed once.
+        // Files that can't be combined with the others are parsed separately afterwards.
+        // The parse cache and the number of jobs are ignored in this mode.
+        auto set_unity_build(bool unity_build) -> void;
+        // Parses every translation unit with an existing precompiled header.
+        // It must have been built with the same compiler flags, so files with their own flags from the compilation database don't use it.
+        auto set_precompiled_header(std::filesystem::path precompiled_header) -> void;
+        // Builds a precompiled header from 'headers' at the start of 'parse' and parses every translation unit with it.
+        // Files with their own flags from the compilation database get a precompiled header per distinct set of flags, written next to 'precompiled_header'.
+        auto set_precompiled_header_sources(std::vector<std::string> headers, std::filesystem::path precompiled_header) -> void;
+        // Enables the parse cache, translation units that haven't changed since the last run are loaded from 'cache_dir' instead of being parsed.
+        // The time it took to parse each file is also stored there, without a cache directory the files are scheduled by their size alone.
+        auto set_cache_dir(std::filesystem::path cache_dir) -> void;
+        // Parses each file that's in 'compile_commands' with its own flags instead of the global compiler flags.
+        // If no files were supplied to the constructor, every file in 'compile_commands' that contains annotations is parsed.
+        // If there's a code root, only files under it are parsed.
+        auto set_compile_commands(std::vector<CompileCommand> compile_commands) -> void;
+        // Namespaces, classes, functions and enums declared in a file under one of 'denied_paths' are skipped without being looked at.
+        // Files under one of 'allowed_paths' are never skipped.
+        auto set_path_filters(const std::vector<std::string>& allowed_paths, const std::vector<std::string>& denied_paths) -> void;
+        // Declarations in system headers are skipped unless they're under an allowed path, disabled by default.
+        auto set_skip_system_headers(bool skip_system_headers) -> void;
+        // Only parses the files that belong to shard 'shard_index' out of 'shard_count'.
+        // The files are split by their sorted position so every process that's given the same files agrees on which shard parses which file.
+        auto set_shard(size_t shard_index, size_t shard_count) -> void;
+        // Writes the output of 'parse' and the annotation requests to 'shard_file' so that it can be combined with the other shards by 'merge_shards'.
+        auto write_shard(const std::filesystem::path& shard_file) const -> void;
+        // Used instead of 'parse', combines the output of every shard of a run in shard order.
+        // Duplicate classes and functions are resolved the same way as when the output of parallel workers is merged.
+        auto merge_shards(const std::vector<std::filesystem::path>& shard_files) -> const CodeGenerator&;
+        // Used instead of 'parse', loads the output of an earlier parse that was saved with 'CodeGenerator::write_ir_file'.
+        auto load_ir(const std::filesystem::path& ir_file) -> const CodeGenerator&;
+        // Used instead of 'parse', parses every file and then keeps the translation units alive, never returns unless there's an error.
+        // Files that change are reparsed and 'on_output' is called with the full output after the initial parse and after every change.
+        // A change to a header in the precompiled header builds it again, or stops using it if it can't be built, and parses every file from scratch.
+        // An error thrown by 'on_output' is printed and doesn't stop the watch.
+        auto watch(const std::function<void(const CodeGenerator&)>& on_output) -> void;
 
         auto resolve_base(CXCursor& cursor, Class& bases) -> void;
         auto resolve_bases(CXCursor& cursor_in, std::string& buffer, std::vector<const Class*>& bases) -> void;
@@ -104,6 +211,58 @@ namespace RC::LuaWrapperGenerator
         auto generate_internal(CXCursor inner_cursor, CXCursor outer_cursor) -> CXChildVisitResult;
         auto static generator_internal_clang_wrapper(CXCursor inner_cursor, CXCursor outer_cursor, CXClientData self) -> CXChildVisitResult;
         auto parse() -> const CodeGenerator&;
+
+    private:
+        // Everything that must happen once before the first file is parsed.
+        auto prepare_for_parsing() -> void;
+        // Returns the number of seconds it took to parse the file.
+        auto parse_file(const std::string& file) -> double;
+        auto process_translation_unit(CXTranslationUnit translation_unit) -> void;
+        // Every file is parsed by its own worker and the outputs are merged in file order, however many jobs there are.
+        // That way the output is the same for any number of jobs, which duplicate wins a merge doesn't depend on which worker finished first.
+        auto parse_files_in_parallel() -> void;
+        auto parse_unity() -> void;
+        auto parse_files_with_cache() -> void;
+        // 'parse_duration' is set to zero if the file was loaded from the cache.
+        auto parse_file_or_load_from_cache(const std::string& file, double& parse_duration) -> std::unique_ptr<CodeParser>;
+        // Calls 'callable' once for every file, spread over 'num_workers' threads.
+        auto for_each_file(size_t num_workers, const std::function<void(size_t worker_index, size_t file_index)>& callable) -> void;
+        auto merge_worker_output(CodeParser& worker) -> void;
+        auto apply_custom_base_classes() -> void;
+        auto collect_include_closure(CXTranslationUnit translation_unit, const std::string& file) -> void;
+        // Always true if no code root was supplied.
+        auto is_under_code_root(std::string_view file) const -> bool;
+        // Only looks at the location of 'cursor', the result is cached per file.
+        auto is_cursor_rejected(const CXCursor& cursor) -> bool;
+        // Collects the requests in every file that's parsed and in every project header they include, before any translation unit is parsed.
+        // Without this, a request only applies to declarations that are visited after the file containing the request was parsed.
+        auto collect_annotation_requests() -> void;
+        // Path -> contents of the files to parse and of the project headers they include, found by following their '#include' directives.
+        // A header is part of the project if it's under the code root, or if there's no code root, if it isn't found through a system include directory.
+        auto read_project_files() const -> std::map<std::string, std::string>;
+        auto clear_annotation_requests() -> void;
+        auto process_annotation_comment(std::string_view comment) -> void;
+        // Stores the USR of 'cursor' in 'usr_out' so that it can be passed to 'mark_declaration_as_processed' without being retrieved again.
+        auto is_declaration_processed(const CXCursor& cursor, std::string& usr_out) -> bool;
+        auto mark_declaration_as_processed(std::string&& usr) -> void;
+        auto get_compiler_flags_hash(const std::string& file) const -> uint64_t;
+        // Null if 'file' isn't in the compilation database.
+        auto get_per_file_compiler_args(const std::string& file) const -> const std::vector<std::string>*;
+        // Null if 'file' is parsed without a precompiled header.
+        auto get_precompiled_header(const std::string& file) const -> const std::string*;
+        // The compiler flags for 'file' plus any flags added by the parser itself.
+        auto get_compiler_args(const std::string& file) const -> std::vector<const char*>;
+        auto schedule_files() -> void;
+        auto select_shard_files() -> void;
+        auto store_file_parse_durations() const -> void;
+        auto build_precompiled_headers() -> void;
+        auto build_precompiled_header(const std::string& precompiled_header, std::vector<const char*> compiler_args) -> void;
+        // A fragment is the binding IR of the parser output, optionally followed by the annotation requests.
+        // Only shards need the requests, the parse cache and watch mode always have every request already.
+        auto write_fragment(WithAnnotationRequests) const -> std::string;
+        auto read_fragment(std::string_view fragment, WithAnnotationRequests) -> void;
+        auto write_annotation_requests(IRWriter& writer) const -> void;
+        auto read_annotation_requests(IRReader& reader) -> void;
     };
 }
 
@@ -0,0 +1,58 @@
+#ifndef LUA_WRAPPER_GENERATOR_CODE_WRITER_HPP
+#define LUA_WRAPPER_GENERATOR_CODE_WRITER_HPP
+
+#include <algorithm>
+#include <format>
+#include <iterator>
+#include <string>
+#include <string_view>
+
+namespace RC::LuaWrapperGenerator
+{
+    // Generated code is formatted straight into one buffer per output file instead of building a string per function and appending it to the caller's string.
+    class CodeWriter
+    {
+    private:
+        static constexpr std::string_view indentation{"    "};
+        std::string m_buffer{};
+
+    public:
+        template<typename... Args>
+        auto write(std::format_string<Args...> format, Args&&... args) -> CodeWriter&
+        {
+            std::format_to(std::back_inserter(m_buffer), format, std::forward<Args>(args)...);
+            return *this;
+        }
+
+        auto append(std::string_view str) -> CodeWriter&
+        {
+            m_buffer.append(str);
+            return *this;
+        }
+
+        // Four spaces per level, same as the rest of the generated code.
+        auto indent(size_t levels) -> CodeWriter&
+        {
+            for (size_t i = 0; i < levels; ++i) { m_buffer.append(indentation); }
+            return *this;
+        }
+
+        template<typename... Args>
+        auto write_line(size_t indent_levels, std::format_string<Args...> format, Args&&... args) -> CodeWriter&
+        {
+            indent(indent_levels);
+            write(format, std::forward<Args>(args)...);
+            m_buffer.push_back('\n');
+            return *this;
+        }
+
+        auto remove_suffix(size_t num_chars) -> void { m_buffer.resize(m_buffer.size() - std::min(num_chars, m_buffer.size())); }
+        // Keeps the capacity so that the same writer can be reused for the next file without growing from scratch.
+        auto clear() -> void { m_buffer.clear(); }
+        auto reserve(size_t num_chars) -> void { m_buffer.reserve(num_chars); }
+        auto size() const -> size_t { return m_buffer.size(); }
+        auto get() const -> std::string_view { return m_buffer; }
+    };
+}
+
+#endif //LUA_WRAPPER_GENERATOR_CODE_WRITER_HPP
@@ -1,18 +1,57 @@
 #ifndef LUA_WRAPPER_GENERATOR_TESTING_COMMENT_PARSER_HPP
 #define LUA_WRAPPER_GENERATOR_TESTING_COMMENT_PARSER_HPP
 
+#include <array>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <unordered_map>
 
 namespace RC::LuaWrapperGenerator
 {
-    struct CommentAttributeContainer
+    // Every attribute that the generator understands.
+    // The kind is worked out once when the comment is parsed so looking up an attribute doesn't compare any strings.
+    enum class CommentAttributeKind : uint8_t
+    {
+        Lua,
+        LuaStateTypes,
+        LuaLate,
+        LuaAddMetamethod,
+        LuaMapTemplateClass,
+        LuaAddBaseToClass,
+        LuaMemberFunctionRedirector,
+        LuaStaticMemberFunctionRedirector,
+        Unknown,
+    };
+
+    auto to_comment_attribute_kind(std::string_view attribute_name) -> CommentAttributeKind;
+
+    // No attribute takes more than four params so they're stored inline, anything past that spills onto the heap.
+    class CommentAttributeParams
     {
-        std::string name{};
-        std::vector<std::string> params{};
+    private:
+        static constexpr size_t num_inline_params = 4;
+        std::array<std::string_view, num_inline_params> m_inline_params{};
+        std::vector<std::string_view> m_overflow_params{};
+        size_t m_num_params{};
 
-        CommentAttributeContainer(std::string_view attribute_name) : name(attribute_name) {}
+    public:
+        auto push_back(std::string_view param) -> void;
+        auto size() const -> size_t { return m_num_params; }
+        auto operator[](size_t param) const -> std::string_view
+        {
+            return param < num_inline_params ? m_inline_params[param] : m_overflow_params[param - num_inline_params];
+        }
+    };
+
+    // The name and params are views into the parser that they came from so they must not outlive it.
+    struct CommentAttributeContainer
+    {
+        std::string_view name{};
+        CommentAttributeKind kind{CommentAttributeKind::Unknown};
+        CommentAttributeParams params{};
+        // Index of the 'CUSTOM_ATTRIBUTE[...]' block in the comment that this attribute is in.
+        uint32_t block{};
     };
 
     class CommentAttribute
@@ -28,26 +67,38 @@ namespace RC::LuaWrapperGenerator
         auto exists() const -> bool { return attribute; }
         auto get() const -> const CommentAttributeContainer& { return *attribute; }
         auto num_params() const -> size_t { return get().params.size(); }
-        auto get_param(size_t param) -> const std::string&;
-        auto has_param(size_t param) -> bool { return param < get().params.size(); }
+        auto get_param(size_t param) const -> std::string_view;
+        auto has_param(size_t param) const -> bool { return param < get().params.size(); }
     };
 
     class CommentParser
     {
     private:
-        const std::string& m_comment;
+        std::string_view m_comment;
+        // The contents of every 'CUSTOM_ATTRIBUTE[...]' block with the spaces removed, the attributes are views into this.
+        std::string m_blocks{};
 
-        using CommentAttributes = std::unordered_map<std::string, CommentAttributeContainer>;
-        CommentAttributes m_attributes{};
+        // In the order they appear in the comment, across every 'CUSTOM_ATTRIBUTE[...]' block.
+        std::vector<CommentAttributeContainer> m_attributes{};
+        // One plus the index in 'm_attributes' of the first attribute of each kind, zero if the comment doesn't have one.
+        std::array<uint32_t, static_cast<size_t>(CommentAttributeKind::Unknown)> m_attribute_by_kind{};
 
     public:
-        explicit CommentParser(const std::string& comment);
+        explicit CommentParser(std::string_view comment);
+        // The attributes point into 'm_blocks' which a copy or move wouldn't update.
+        CommentParser(const CommentParser&) = delete;
+        CommentParser(CommentParser&&) = delete;
+        auto operator=(const CommentParser&) -> CommentParser& = delete;
+        auto operator=(CommentParser&&) -> CommentParser& = delete;
 
     private:
         auto parse() -> void;
+        auto parse_attribute_block(std::string_view attributes, uint32_t block) -> void;
+        auto add_attribute(std::string_view attribute_name, uint32_t block) -> CommentAttributeContainer&;
 
     public:
-        auto get_attribute(const std::string& attribute_name) const -> const CommentAttribute;
+        auto get_attributes() const -> const std::vector<CommentAttributeContainer>& { return m_attributes; }
+        auto get_attribute(CommentAttributeKind kind) const -> CommentAttribute;
     };
 }
 
@@ -0,0 +1,24 @@
+#ifndef LUA_WRAPPER_GENERATOR_COMPILATION_DATABASE_HPP
+#define LUA_WRAPPER_GENERATOR_COMPILATION_DATABASE_HPP
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace RC::LuaWrapperGenerator
+{
+    struct CompileCommand
+    {
+        // Absolute path to the main file.
+        std::string file{};
+        // Everything that's needed to parse the file with libclang.
+        // The compiler, the main file and any flags that are only relevant for producing output files have been removed.
+        std::vector<std::string> args{};
+    };
+
+    // Loads 'compile_commands.json' from 'build_dir' with libclang.
+    // 'build_dir' can also be the path to the file itself.
+    auto load_compile_commands(const std::filesystem::path& build_dir) -> std::vector<CompileCommand>;
+}
+
+#endif //LUA_WRAPPER_GENERATOR_COMPILATION_DATABASE_HPP
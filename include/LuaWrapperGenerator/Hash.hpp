@@ -0,0 +1,53 @@
+#ifndef LUA_WRAPPER_GENERATOR_HASH_HPP
+#define LUA_WRAPPER_GENERATOR_HASH_HPP
+
+#include <cstdint>
+#include <string_view>
+
+namespace RC::LuaWrapperGenerator
+{
+    // 64-bit FNV-1a.
+    // Used for anything that's written to disk and compared on a later run, which rules out 'std::hash'.
+    class Hasher
+    {
+    private:
+        uint64_t m_hash{14695981039346656037ull};
+
+    public:
+        auto update_bytes(std::string_view bytes) -> Hasher&
+        {
+            for (const auto byte : bytes)
+            {
+                m_hash ^= static_cast<uint8_t>(byte);
+                m_hash *= 1099511628211ull;
+            }
+            return *this;
+        }
+
+        auto update(uint64_t value) -> Hasher&
+        {
+            for (int i = 0; i < 8; ++i)
+            {
+                m_hash ^= static_cast<uint8_t>(value >> (i * 8));
+                m_hash *= 1099511628211ull;
+            }
+            return *this;
+        }
+
+        // The size is included so that "ab" + "c" and "a" + "bc" don't hash to the same value.
+        auto update(std::string_view string) -> Hasher&
+        {
+            update(static_cast<uint64_t>(string.size()));
+            return update_bytes(string);
+        }
+
+        auto get() const -> uint64_t { return m_hash; }
+    };
+
+    inline auto hash_string(std::string_view string) -> uint64_t
+    {
+        return Hasher{}.update(string).get();
+    }
+}
+
+#endif //LUA_WRAPPER_GENERATOR_HASH_HPP
@@ -0,0 +1,64 @@
+#ifndef LUA_WRAPPER_GENERATOR_OUTPUT_MANIFEST_HPP
+#define LUA_WRAPPER_GENERATOR_OUTPUT_MANIFEST_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace RC::LuaWrapperGenerator
+{
+    // Remembers what was written to every generated file so that a file whose contents didn't change isn't written again.
+    // Rewriting an unchanged file bumps its modification time which makes the build recompile everything that includes it.
+    // The generated text is hashed instead of the file on disk because the encoding the file ends up in is up to the File library.
+    // The size and modification time of the file on disk are stored as well so that a file that was edited or deleted after it was generated is written again.
+    class OutputManifest
+    {
+    private:
+        struct Entry
+        {
+            uint64_t contents_hash{};
+            uintmax_t file_size{};
+            int64_t last_write_time{};
+
+            auto operator==(const Entry&) const -> bool = default;
+        };
+
+        std::filesystem::path m_output_path;
+        // Nothing is read from or written to disk, only the hash of what would've been written is recorded.
+        bool m_is_in_memory{};
+        // Path relative to the output path -> what was written there on the previous run.
+        std::unordered_map<std::string, Entry> m_previous_entries{};
+        // Every file written or skipped on this run, ordered so that the manifest itself doesn't change between identical runs.
+        std::map<std::string, Entry> m_entries{};
+        size_t m_num_written{};
+        size_t m_num_skipped{};
+
+        OutputManifest() = default;
+
+    public:
+        explicit OutputManifest(std::filesystem::path output_path);
+        // Used to compare the output of two runs without writing either of them.
+        static auto in_memory() -> OutputManifest;
+
+    public:
+        // Writes 'contents' to 'relative_path' unless the file still has the contents that were written to it last time.
+        // Returns true if the file was written.
+        auto write_file(const std::filesystem::path& relative_path, std::string_view contents) -> bool;
+        // Must be called once every file has been written, otherwise the next run writes every file again.
+        auto save() const -> void;
+        auto get_num_written() const -> size_t { return m_num_written; }
+        auto get_num_skipped() const -> size_t { return m_num_skipped; }
+        // Path relative to the output path -> hash of what was written there on this run.
+        auto get_contents_hashes() const -> std::map<std::string, uint64_t>;
+
+    private:
+        auto get_manifest_path() const -> std::filesystem::path;
+        auto make_entry(const std::filesystem::path& file_path, uint64_t contents_hash) const -> std::optional<Entry>;
+    };
+}
+
+#endif //LUA_WRAPPER_GENERATOR_OUTPUT_MANIFEST_HPP
@@ -0,0 +1,47 @@
+#ifndef LUA_WRAPPER_GENERATOR_PARSE_CACHE_HPP
+#define LUA_WRAPPER_GENERATOR_PARSE_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace RC::LuaWrapperGenerator
+{
+    // Stores the binding IR of each translation unit on disk so that unchanged translation units don't have to be parsed again.
+    // An entry is only used if the compiler flags, the main file and every file it included are the same as when the entry was stored.
+    // The include closure of an entry is stored with it because it can't be known without parsing.
+    // Safe to use from multiple threads as long as no two threads use the same main file at the same time.
+    class ParseCache
+    {
+    private:
+        std::filesystem::path m_cache_dir;
+        // Full path -> hash of contents, nullopt if the file couldn't be read.
+        // Translation units share most of their headers so each file is only hashed once per run.
+        mutable std::unordered_map<std::string, std::optional<uint64_t>> m_file_hashes{};
+        mutable std::mutex m_file_hashes_mutex{};
+
+    public:
+        explicit ParseCache(std::filesystem::path cache_dir);
+
+    public:
+        // Returns the stored IR fragment for 'file', or nullopt if there's no entry or if the entry is out of date.
+        auto load(const std::string& file, uint64_t flags_hash) const -> std::optional<std::string>;
+        auto store(const std::string& file, uint64_t flags_hash, const std::vector<std::string>& include_closure, std::string_view fragment) const -> void;
+        auto get_cache_dir() const -> const std::filesystem::path& { return m_cache_dir; }
+        // Main file -> seconds it took to parse on a previous run, used to start the most expensive files first.
+        auto load_file_timings() const -> std::unordered_map<std::string, double>;
+        auto store_file_timings(const std::unordered_map<std::string, double>& file_timings) const -> void;
+
+    private:
+        auto get_entry_path(const std::string& file) const -> std::filesystem::path;
+        auto hash_file(const std::string& file) const -> std::optional<uint64_t>;
+        auto hash_include_closure(const std::string& file, uint64_t flags_hash, const std::vector<std::string>& include_closure) const -> std::optional<uint64_t>;
+    };
+}
+
+#endif //LUA_WRAPPER_GENERATOR_PARSE_CACHE_HPP
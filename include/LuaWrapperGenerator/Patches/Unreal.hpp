@@ -5,6 +5,7 @@
 
 #include <LuaWrapperGenerator/CodeParser.hpp>
 #include <LuaWrapperGenerator/CodeGenerator.hpp>
+#include <LuaWrapperGenerator/BindingIR.hpp>
 
 namespace RC::LuaWrapperGenerator::TypePatches::Unreal
 {
@@ -14,9 +15,14 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
     auto generate_state_file_post(const Container&) -> std::string;
     auto generate_lua_setup_state_function_post() -> std::string;
     auto generate_per_class_static_functions(const Class&) -> std::string;
+    auto serialize_type(const Type::Base*, IRWriter&) -> bool;
+    auto deserialize_type(CodeGenerator&, IRReader&) -> std::unique_ptr<Type::Base>;
 
     class TArray : public Type::BaseTemplate<TArray>
     {
+    public:
+        static constexpr Type::TypeKind kind = Type::TypeKind::FirstPatchKind;
+
     private:
         static constexpr std::string_view struct_name{"ArrayTest"};
         static constexpr std::string_view fully_qualified_struct_scope{"::RC::UnrealRuntimeTypes"};
@@ -39,6 +45,9 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
     public:
         //explicit TArray(const Container& container) : BaseTemplate<TArray>(container) {}
         TArray(const Container& container, std::unique_ptr<Type::Base> element_type) : BaseTemplate<TArray>(container), m_element_type(std::move(element_type)) {}
+
+    public:
+        auto get_element_type() const -> const Type::Base* { return m_element_type.get(); }
     };
 }
 
@@ -0,0 +1,56 @@
+#ifndef LUA_WRAPPER_GENERATOR_SYMBOL_HPP
+#define LUA_WRAPPER_GENERATOR_SYMBOL_HPP
+
+#include <string>
+#include <string_view>
+#include <format>
+
+namespace RC::LuaWrapperGenerator
+{
+    // An interned string.
+    // Scopes, names and file paths are repeated by thousands of classes, functions and types.
+    // Each unique string is only stored once for the whole run and a symbol is only a pointer to it.
+    // Two symbols with the same contents always point to the same string so comparing them is a pointer compare.
+    // The strings are never freed, a symbol stays valid until the process exits.
+    // Safe to create from multiple threads.
+    class Symbol
+    {
+    private:
+        const std::string* m_string;
+
+    public:
+        Symbol();
+        explicit Symbol(std::string_view string);
+
+    public:
+        auto str() const -> const std::string& { return *m_string; }
+        auto view() const -> std::string_view { return *m_string; }
+        auto c_str() const -> const char* { return m_string->c_str(); }
+        auto size() const -> size_t { return m_string->size(); }
+        auto empty() const -> bool { return m_string->empty(); }
+
+        operator const std::string&() const { return *m_string; }
+        operator std::string_view() const { return *m_string; }
+
+        friend auto operator==(Symbol a, Symbol b) -> bool { return a.m_string == b.m_string; }
+        friend auto operator==(Symbol a, std::string_view b) -> bool { return *a.m_string == b; }
+        friend auto operator+(const std::string& a, Symbol b) -> std::string { return a + *b.m_string; }
+        friend auto operator+(Symbol a, const std::string& b) -> std::string { return *a.m_string + b; }
+        friend auto operator+(Symbol a, const char* b) -> std::string { return *a.m_string + b; }
+        friend auto operator+(const char* a, Symbol b) -> std::string { return a + *b.m_string; }
+
+        // Number of unique strings that have been interned so far.
+        static auto get_num_symbols() -> size_t;
+    };
+}
+
+template<>
+struct std::formatter<RC::LuaWrapperGenerator::Symbol> : std::formatter<std::string_view>
+{
+    auto format(const RC::LuaWrapperGenerator::Symbol& symbol, auto& ctx) const
+    {
+        return std::formatter<std::string_view>::format(symbol.view(), ctx);
+    }
+};
+
+#endif //LUA_WRAPPER_GENERATOR_SYMBOL_HPP
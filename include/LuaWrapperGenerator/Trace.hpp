@@ -0,0 +1,48 @@
+#ifndef LUA_WRAPPER_GENERATOR_TRACE_HPP
+#define LUA_WRAPPER_GENERATOR_TRACE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace RC::LuaWrapperGenerator::Trace
+{
+    // Records spans on every thread until 'stop' is called, which writes them to 'output_file' in the Chrome trace event format.
+    // The file can be loaded into Perfetto or chrome://tracing.
+    // Spans are only recorded while tracing is enabled, a disabled span is a single atomic load.
+    auto start(std::filesystem::path output_file) -> void;
+    auto stop() -> void;
+    // Appends every span recorded since the last write to the output file and keeps recording, for runs that never reach 'stop' like watch mode.
+    // The spans of threads that have exited are only kept until they're written.
+    // Must not be called while another thread can still record a span.
+    auto flush() -> void;
+    auto is_enabled() -> bool;
+    // Shown in the trace instead of the thread id, for example "Worker 3".
+    // Threads that are given the same name are shown as one thread.
+    auto set_thread_name(std::string name) -> void;
+
+    // Records the time between its construction and its destruction as one span on the calling thread.
+    // Spans on the same thread nest by time so they must be destroyed in the reverse order of their construction.
+    class Span
+    {
+    private:
+        // Must be a string literal or otherwise outlive the trace.
+        const char* m_name{};
+        std::string m_detail{};
+        int64_t m_start{-1};
+
+    public:
+        explicit Span(const char* name);
+        // 'detail' is shown in the arguments of the span, for example the file that's being parsed.
+        Span(const char* name, std::string_view detail);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span(Span&&) = delete;
+        auto operator=(const Span&) -> Span& = delete;
+        auto operator=(Span&&) -> Span& = delete;
+    };
+}
+
+#endif //LUA_WRAPPER_GENERATOR_TRACE_HPP
@@ -0,0 +1,647 @@
+#include <stdexcept>
+#include <cstring>
+#include <format>
+
+#include <LuaWrapperGenerator/BindingIR.hpp>
+
+namespace RC::LuaWrapperGenerator
+{
+    static constexpr std::string_view binding_ir_magic{"LWGIR"};
+
+    enum class TypeTag : uint8_t
+    {
+        Null,
+        Void,
+        Int8,
+        Int16,
+        Int32,
+        Int64,
+        UInt8,
+        UInt16,
+        UInt32,
+        UInt64,
+        Float,
+        Double,
+        CString,
+        CWString,
+        String,
+        WString,
+        AutoString,
+        CustomStruct,
+        Enum,
+        Bool,
+        FunctionProto,
+        // Followed by the index of the TypePatch that wrote the type.
+        Patch,
+    };
+
+    enum TypeFlags : uint8_t
+    {
+        IsPointerFlag = 1 << 0,
+        IsRefFlag = 1 << 1,
+        IsConstFlag = 1 << 2,
+    };
+
+    enum FunctionFlags : uint8_t
+    {
+        IsCustomRedirectorFlag = 1 << 0,
+        SharesFileWithContainingClassFlag = 1 << 1,
+        IsStaticFlag = 1 << 2,
+        IsConstructorFlag = 1 << 3,
+        IsAliasFlag = 1 << 4,
+    };
+
+    enum class ForwardDeclaration : uint8_t { None, Struct, Class };
+
+    template<typename T>
+    static auto is_exactly(const Type::Base* type) -> bool
+    {
+        return type->get_kind() == T::kind;
+    }
+
+    auto IRWriter::write_u8(uint8_t value) -> void
+    {
+        m_records.push_back(static_cast<char>(value));
+    }
+
+    auto IRWriter::write_u32(uint32_t value) -> void
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            m_records.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+
+    auto IRWriter::write_u64(uint64_t value) -> void
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            m_records.push_back(static_cast<char>(value >> (i * 8)));
+        }
+    }
+
+    auto IRWriter::write_string(std::string_view string) -> void
+    {
+        auto [it, was_inserted] = m_string_indexes.emplace(std::string{string}, static_cast<uint32_t>(m_strings.size()));
+        if (was_inserted)
+        {
+            m_strings.emplace_back(it->first);
+        }
+        write_u32(it->second);
+    }
+
+    auto IRWriter::write_blob(std::string_view blob) -> void
+    {
+        write_u64(blob.size());
+        m_records.append(blob);
+    }
+
+    auto IRWriter::write_type(const Type::Base* type) -> void
+    {
+        if (!type)
+        {
+            write_u8(static_cast<uint8_t>(TypeTag::Null));
+            return;
+        }
+
+        auto write_tag = [&](TypeTag tag) {
+            write_u8(static_cast<uint8_t>(tag));
+            uint8_t flags{};
+            if (type->is_pointer()) { flags |= IsPointerFlag; }
+            if (type->is_ref()) { flags |= IsRefFlag; }
+            if (type->is_const()) { flags |= IsConstFlag; }
+            write_u8(flags);
+        };
+
+        if (is_exactly<Type::Void>(type)) { write_tag(TypeTag::Void); }
+        else if (is_exactly<Type::Int8>(type)) { write_tag(TypeTag::Int8); }
+        else if (is_exactly<Type::Int16>(type)) { write_tag(TypeTag::Int16); }
+        else if (is_exactly<Type::Int32>(type)) { write_tag(TypeTag::Int32); }
+        else if (is_exactly<Type::Int64>(type)) { write_tag(TypeTag::Int64); }
+        else if (is_exactly<Type::UInt8>(type)) { write_tag(TypeTag::UInt8); }
+        else if (is_exactly<Type::UInt16>(type)) { write_tag(TypeTag::UInt16); }
+        else if (is_exactly<Type::UInt32>(type)) { write_tag(TypeTag::UInt32); }
+        else if (is_exactly<Type::UInt64>(type)) { write_tag(TypeTag::UInt64); }
+        else if (is_exactly<Type::Float>(type)) { write_tag(TypeTag::Float); }
+        else if (is_exactly<Type::Double>(type)) { write_tag(TypeTag::Double); }
+        else if (is_exactly<Type::CString>(type)) { write_tag(TypeTag::CString); }
+        else if (is_exactly<Type::CWString>(type)) { write_tag(TypeTag::CWString); }
+        else if (is_exactly<Type::String>(type)) { write_tag(TypeTag::String); }
+        else if (is_exactly<Type::WString>(type)) { write_tag(TypeTag::WString); }
+        else if (is_exactly<Type::Bool>(type)) { write_tag(TypeTag::Bool); }
+        else if (is_exactly<Type::AutoString>(type))
+        {
+            write_tag(TypeTag::AutoString);
+            write_bool(static_cast<const Type::AutoString*>(type)->m_is_wide_string);
+        }
+        else if (is_exactly<Type::CustomStruct>(type))
+        {
+            write_tag(TypeTag::CustomStruct);
+            auto typed_type = static_cast<const Type::CustomStruct*>(type);
+            write_string(typed_type->get_type_name());
+            write_string(typed_type->get_fully_qualified_scope());
+            auto forward_declaration = ForwardDeclaration::None;
+            if (typed_type->is_struct_forward_declaration()) { forward_declaration = ForwardDeclaration::Struct; }
+            else if (typed_type->is_class_forward_declaration()) { forward_declaration = ForwardDeclaration::Class; }
+            write_u8(static_cast<uint8_t>(forward_declaration));
+            write_bool(typed_type->should_move_on_construction());
+        }
+        else if (is_exactly<Type::Enum>(type))
+        {
+            write_tag(TypeTag::Enum);
+            write_string(type->generate_cxx_name());
+        }
+        else if (is_exactly<Type::FunctionProto>(type))
+        {
+            write_tag(TypeTag::FunctionProto);
+            auto typed_type = static_cast<const Type::FunctionProto*>(type);
+            write_string(typed_type->get_function_proto());
+            write_bool(typed_type->has_storage());
+            write_u32(static_cast<uint32_t>(typed_type->get_param_types().size()));
+            for (const auto& param_type : typed_type->get_param_types())
+            {
+                write_type(param_type);
+            }
+            write_function(typed_type->get_function());
+        }
+        else
+        {
+            if (m_type_patches)
+            {
+                for (size_t i = 0; i < m_type_patches->size(); ++i)
+                {
+                    const auto& type_patch = (*m_type_patches)[i];
+                    if (!type_patch.serialize_type) { continue; }
+
+                    auto tag_offset = m_records.size();
+                    write_tag(TypeTag::Patch);
+                    write_u32(static_cast<uint32_t>(i));
+                    if (type_patch.serialize_type(type, *this)) { return; }
+                    m_records.resize(tag_offset);
+                }
+            }
+
+            throw std::runtime_error{std::format("[IRWriter::write_type] Unable to serialize type '{}'", type->generate_cxx_name())};
+        }
+    }
+
+    auto IRWriter::write_function(const Function& function) -> void
+    {
+        write_string(function.get_name());
+        write_string(function.get_parent_name());
+        write_string(function.get_full_path_to_file());
+        write_string(function.get_fully_qualified_scope());
+        write_string(function.get_parent_scope());
+        write_string(function.get_lua_name());
+        write_string(function.get_wrapper_name());
+        write_string(function.get_scope_override());
+
+        uint8_t flags{};
+        if (function.is_custom_redirector()) { flags |= IsCustomRedirectorFlag; }
+        if (function.shares_file_with_containing_class()) { flags |= SharesFileWithContainingClassFlag; }
+        if (function.is_static()) { flags |= IsStaticFlag; }
+        if (function.is_constructor()) { flags |= IsConstructorFlag; }
+        if (function.is_alias()) { flags |= IsAliasFlag; }
+        write_u8(flags);
+
+        write_type(function.get_return_type());
+        write_u32(static_cast<uint32_t>(function.get_overloads().size()));
+        for (const auto& overload : function.get_overloads())
+        {
+            write_u32(static_cast<uint32_t>(overload.size()));
+            for (const auto& param : overload)
+            {
+                write_string(param.name);
+                write_type(param.type);
+            }
+        }
+    }
+
+    auto IRWriter::write_function_container(const FunctionContainer& functions) -> void
+    {
+        write_u32(static_cast<uint32_t>(functions.size()));
+        for (const auto& [key, function] : functions)
+        {
+            write_string(key);
+            write_function(function);
+        }
+    }
+
+    auto IRWriter::write_class(const Class& the_class, const Container& container) -> void
+    {
+        write_string(the_class.name);
+        write_string(the_class.fully_qualified_scope);
+        write_string(the_class.scope_override);
+        write_string(the_class.full_path_to_file);
+        write_bool(the_class.has_parameterless_constructor);
+
+        // Bases are stored by key and resolved once every class has been read.
+        // Only the direct bases are stored, the bases of a base are stored with that base.
+        const auto& bases = the_class.get_direct_bases();
+        write_u32(static_cast<uint32_t>(bases.size()));
+        for (const auto* base : bases)
+        {
+            auto key = base->fully_qualified_scope + "::" + base->name;
+            auto thin_class = container.thin_classes.find(key);
+            write_bool(thin_class != container.thin_classes.end() && &thin_class->second == base);
+            write_string(key);
+        }
+
+        // Only the functions of the inner container are used by the parser.
+        write_function_container(the_class.container.functions);
+        write_function_container(the_class.static_functions);
+        write_function_container(the_class.constructors);
+        write_function_container(the_class.metamethods);
+    }
+
+    auto IRWriter::write_container(const Container& container) -> void
+    {
+        write_u32(static_cast<uint32_t>(container.classes.size()));
+        for (const auto& [_, the_class] : container.classes)
+        {
+            write_class(the_class, container);
+        }
+
+        write_u32(static_cast<uint32_t>(container.thin_classes.size()));
+        for (const auto& [_, the_class] : container.thin_classes)
+        {
+            write_class(the_class, container);
+        }
+
+        write_function_container(container.functions);
+
+        write_u32(static_cast<uint32_t>(container.enums.size()));
+        for (const auto& [key, the_enum] : container.enums)
+        {
+            write_string(key);
+            write_string(the_enum.get_name());
+            write_string(the_enum.get_fully_qualified_scope());
+            write_u32(static_cast<uint32_t>(the_enum.get_key_value_pairs().size()));
+            for (const auto& [enum_key, enum_value] : the_enum.get_key_value_pairs())
+            {
+                write_string(enum_key);
+                write_u64(enum_value);
+            }
+        }
+
+        write_u32(static_cast<uint32_t>(container.lua_state_types.size()));
+        for (const auto& lua_state_type : container.lua_state_types)
+        {
+            write_string(lua_state_type);
+        }
+
+        write_u32(static_cast<uint32_t>(container.extra_includes.size()));
+        for (const auto& extra_include : container.extra_includes)
+        {
+            write_string(extra_include);
+        }
+
+        // The function proto container isn't written, it's rebuilt from the types of the functions after loading.
+    }
+
+    auto IRWriter::finish() -> std::string
+    {
+        std::string records = std::move(m_records);
+        m_records.clear();
+
+        m_records.append(binding_ir_magic);
+        write_u32(binding_ir_version);
+        write_u32(static_cast<uint32_t>(m_strings.size()));
+        for (const auto& string : m_strings)
+        {
+            write_u32(static_cast<uint32_t>(string.size()));
+            m_records.append(string);
+        }
+        m_records.append(records);
+
+        return std::move(m_records);
+    }
+
+    IRReader::IRReader(std::string_view data, CodeGenerator* code_generator) : m_code_generator(code_generator), m_data(data)
+    {
+        if (m_data.size() < binding_ir_magic.size() || read_raw(binding_ir_magic.size()) != binding_ir_magic)
+        {
+            throw std::runtime_error{"[IRReader] Data is not binding IR"};
+        }
+
+        if (auto version = read_u32(); version != binding_ir_version)
+        {
+            throw std::runtime_error{std::format("[IRReader] Binding IR version is {}, expected {}", version, binding_ir_version)};
+        }
+
+        auto num_strings = read_u32();
+        m_strings.reserve(num_strings);
+        for (uint32_t i = 0; i < num_strings; ++i)
+        {
+            auto size = read_u32();
+            m_strings.emplace_back(read_raw(size));
+        }
+    }
+
+    auto IRReader::read_raw(size_t size) -> std::string_view
+    {
+        if (size > m_data.size() - m_position)
+        {
+            throw std::runtime_error{"[IRReader] Unexpected end of binding IR"};
+        }
+
+        auto raw = m_data.substr(m_position, size);
+        m_position += size;
+        return raw;
+    }
+
+    auto IRReader::read_u8() -> uint8_t
+    {
+        return static_cast<uint8_t>(read_raw(1)[0]);
+    }
+
+    auto IRReader::read_u32() -> uint32_t
+    {
+        auto raw = read_raw(4);
+        uint32_t value{};
+        for (int i = 0; i < 4; ++i)
+        {
+            value |= static_cast<uint32_t>(static_cast<uint8_t>(raw[i])) << (i * 8);
+        }
+        return value;
+    }
+
+    auto IRReader::read_u64() -> uint64_t
+    {
+        auto raw = read_raw(8);
+        uint64_t value{};
+        for (int i = 0; i < 8; ++i)
+        {
+            value |= static_cast<uint64_t>(static_cast<uint8_t>(raw[i])) << (i * 8);
+        }
+        return value;
+    }
+
+    auto IRReader::read_string() -> std::string
+    {
+        auto index = read_u32();
+        if (index >= m_strings.size())
+        {
+            throw std::runtime_error{std::format("[IRReader] String index {} is out of range", index)};
+        }
+        return std::string{m_strings[index]};
+    }
+
+    auto IRReader::read_blob() -> std::string_view
+    {
+        auto size = read_u64();
+        return read_raw(size);
+    }
+
+    auto IRReader::get_code_generator() -> CodeGenerator&
+    {
+        if (!m_code_generator)
+        {
+            throw std::runtime_error{"[IRReader] A code generator is required to read types and classes"};
+        }
+        return *m_code_generator;
+    }
+
+    auto IRReader::read_type() -> std::unique_ptr<Type::Base>
+    {
+        auto tag = static_cast<TypeTag>(read_u8());
+        if (tag == TypeTag::Null) { return nullptr; }
+
+        auto& code_generator = get_code_generator();
+        const auto& container = code_generator.get_lookup_container();
+        auto flags = read_u8();
+
+        std::unique_ptr<Type::Base> type{};
+        switch (tag)
+        {
+            case TypeTag::Void:
+                type = std::make_unique<Type::Void>(container);
+                break;
+            case TypeTag::Int8:
+                type = std::make_unique<Type::Int8>(container);
+                break;
+            case TypeTag::Int16:
+                type = std::make_unique<Type::Int16>(container);
+                break;
+            case TypeTag::Int32:
+                type = std::make_unique<Type::Int32>(container);
+                break;
+            case TypeTag::Int64:
+                type = std::make_unique<Type::Int64>(container);
+                break;
+            case TypeTag::UInt8:
+                type = std::make_unique<Type::UInt8>(container);
+                break;
+            case TypeTag::UInt16:
+                type = std::make_unique<Type::UInt16>(container);
+                break;
+            case TypeTag::UInt32:
+                type = std::make_unique<Type::UInt32>(container);
+                break;
+            case TypeTag::UInt64:
+                type = std::make_unique<Type::UInt64>(container);
+                break;
+            case TypeTag::Float:
+                type = std::make_unique<Type::Float>(container);
+                break;
+            case TypeTag::Double:
+                type = std::make_unique<Type::Double>(container);
+                break;
+            case TypeTag::CString:
+                type = std::make_unique<Type::CString>(container);
+                break;
+            case TypeTag::CWString:
+                type = std::make_unique<Type::CWString>(container);
+                break;
+            case TypeTag::String:
+                type = std::make_unique<Type::String>(container);
+                break;
+            case TypeTag::WString:
+                type = std::make_unique<Type::WString>(container);
+                break;
+            case TypeTag::Bool:
+                type = std::make_unique<Type::Bool>(container);
+                break;
+            case TypeTag::AutoString:
+            {
+                auto typed_type = std::make_unique<Type::AutoString>(container);
+                typed_type->m_is_wide_string = read_bool();
+                type = std::move(typed_type);
+                break;
+            }
+            case TypeTag::CustomStruct:
+            {
+                auto type_name = read_string();
+                auto typed_type = std::make_unique<Type::CustomStruct>(container, std::move(type_name));
+                typed_type->set_fully_qualified_scope(read_string());
+                auto forward_declaration = static_cast<ForwardDeclaration>(read_u8());
+                if (forward_declaration == ForwardDeclaration::Struct) { typed_type->set_is_struct_forward_declaration(true); }
+                else if (forward_declaration == ForwardDeclaration::Class) { typed_type->set_is_class_forward_declaration(true); }
+                typed_type->set_move_on_construction(read_bool());
+                type = std::move(typed_type);
+                break;
+            }
+            case TypeTag::Enum:
+                type = std::make_unique<Type::Enum>(container, read_string());
+                break;
+            case TypeTag::FunctionProto:
+            {
+                auto typed_type = std::make_unique<Type::FunctionProto>(container, read_string());
+                typed_type->set_has_storage(read_bool());
+                auto num_params = read_u32();
+                for (uint32_t i = 0; i < num_params; ++i)
+                {
+                    typed_type->add_param(code_generator.intern_type(read_type()));
+                }
+                auto function = read_function(nullptr);
+                typed_type->set_return_type(function.get_return_type());
+                typed_type->set_function(std::move(function));
+                type = std::move(typed_type);
+                break;
+            }
+            case TypeTag::Patch:
+            {
+                auto type_patch_index = read_u32();
+                const auto& type_patches = code_generator.get_type_patches();
+                if (type_patch_index >= type_patches.size() || !type_patches[type_patch_index].deserialize_type)
+                {
+                    throw std::runtime_error{std::format("[IRReader] Type was written by type patch {} which can't read it", type_patch_index)};
+                }
+                type = type_patches[type_patch_index].deserialize_type(code_generator, *this);
+                break;
+            }
+            default:
+                throw std::runtime_error{std::format("[IRReader] Unknown type tag {}", static_cast<uint8_t>(tag))};
+        }
+
+        type->set_is_pointer(flags & IsPointerFlag);
+        type->set_is_ref(flags & IsRefFlag);
+        type->set_is_const(flags & IsConstFlag);
+        return type;
+    }
+
+    auto IRReader::read_function(Class* containing_class) -> Function
+    {
+        auto name = read_string();
+        auto parent_name = read_string();
+        auto full_path_to_file = read_string();
+        auto fully_qualified_scope = read_string();
+        auto parent_scope = read_string();
+        Function function{std::move(name), std::move(parent_name), std::move(full_path_to_file), std::move(fully_qualified_scope), std::move(parent_scope), nullptr, containing_class};
+        function.set_lua_name(read_string());
+        function.set_wrapper_name(read_string());
+        function.set_scope_override(read_string());
+
+        auto flags = read_u8();
+        function.set_is_custom_redirector(flags & IsCustomRedirectorFlag);
+        function.set_shares_file_with_containing_class(flags & SharesFileWithContainingClassFlag);
+        function.set_is_static(flags & IsStaticFlag);
+        function.set_is_constructor(flags & IsConstructorFlag);
+        function.set_is_alias(flags & IsAliasFlag);
+
+        function.set_return_type(get_code_generator().intern_type(read_type()));
+        auto num_overloads = read_u32();
+        for (uint32_t i = 0; i < num_overloads; ++i)
+        {
+            auto& overload = function.get_overloads().emplace_back();
+            auto num_params = read_u32();
+            for (uint32_t param_index = 0; param_index < num_params; ++param_index)
+            {
+                auto param_name = read_string();
+                overload.emplace_back(std::move(param_name), get_code_generator().intern_type(read_type()));
+            }
+        }
+
+        return function;
+    }
+
+    auto IRReader::read_function_container(FunctionContainer& functions, Class* containing_class) -> void
+    {
+        auto num_functions = read_u32();
+        for (uint32_t i = 0; i < num_functions; ++i)
+        {
+            auto key = read_string();
+            functions.emplace(std::move(key), read_function(containing_class));
+        }
+    }
+
+    auto IRReader::read_container() -> void
+    {
+        auto& code_generator = get_code_generator();
+        auto& container = code_generator.get_container();
+
+        struct PendingBase
+        {
+            Class* the_class{};
+            bool is_thin_class{};
+            std::string key{};
+        };
+        std::vector<PendingBase> pending_bases{};
+
+        auto read_classes = [&](ClassContainer& classes) {
+            auto num_classes = read_u32();
+            for (uint32_t i = 0; i < num_classes; ++i)
+            {
+                auto name = read_string();
+                auto fully_qualified_scope = read_string();
+                auto scope_override = read_string();
+                auto full_path_to_file = read_string();
+                auto& the_class = code_generator.add_class_to_container(name, classes, full_path_to_file, fully_qualified_scope);
+                the_class.scope_override = std::move(scope_override);
+                the_class.has_parameterless_constructor = read_bool();
+
+                auto num_bases = read_u32();
+                for (uint32_t base_index = 0; base_index < num_bases; ++base_index)
+                {
+                    auto is_thin_class = read_bool();
+                    pending_bases.emplace_back(PendingBase{&the_class, is_thin_class, read_string()});
+                }
+
+                read_function_container(the_class.container.functions, &the_class);
+                read_function_container(the_class.static_functions, &the_class);
+                read_function_container(the_class.constructors, &the_class);
+                read_function_container(the_class.metamethods, &the_class);
+            }
+        };
+        read_classes(container.classes);
+        read_classes(container.thin_classes);
+
+        for (const auto& pending_base : pending_bases)
+        {
+            auto& classes = pending_base.is_thin_class ? container.thin_classes : container.classes;
+            if (auto base = classes.find(pending_base.key); base != classes.end())
+            {
+                pending_base.the_class->add_base(&base->second);
+            }
+        }
+
+        read_function_container(container.functions, nullptr);
+
+        auto num_enums = read_u32();
+        for (uint32_t i = 0; i < num_enums; ++i)
+        {
+            auto key = read_string();
+            auto name = read_string();
+            auto fully_qualified_scope = read_string();
+            auto [the_enum, _] = container.enums.emplace(std::move(key), Enum{std::move(name), std::move(fully_qualified_scope)});
+            auto num_pairs = read_u32();
+            for (uint32_t pair_index = 0; pair_index < num_pairs; ++pair_index)
+            {
+                auto enum_key = read_string();
+                the_enum->second.add_key_value_pair(std::move(enum_key), read_u64());
+            }
+        }
+
+        auto num_lua_state_types = read_u32();
+        for (uint32_t i = 0; i < num_lua_state_types; ++i)
+        {
+            container.lua_state_types.emplace(read_string());
+        }
+
+        auto num_extra_includes = read_u32();
+        for (uint32_t i = 0; i < num_extra_includes; ++i)
+        {
+            container.extra_includes.emplace_back(read_string());
+        }
+    }
+}
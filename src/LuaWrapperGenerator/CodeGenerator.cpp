@@ -1,8 +1,18 @@
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
 #include <stdexcept>
+#include <thread>
 #include <type_traits>
 
 #include <LuaWrapperGenerator/CodeGenerator.hpp>
+#include <LuaWrapperGenerator/BindingIR.hpp>
+#include <LuaWrapperGenerator/Trace.hpp>
 #include <File/File.hpp>
 
 namespace RC::LuaWrapperGenerator
@@ -60,20 +70,9 @@ namespace RC::LuaWrapperGenerator
     template<typename ReturnType>
     auto find_class_by_name_internal(auto& self, std::string_view fully_qualified_scope, std::string_view name) -> ReturnType
     {
-        //printf_s("\nClasses:\n");
-        for (auto& the_class : self.classes)
-        {
-            //printf_s("Class: %s\n", the_class.second.name.c_str());
-            if (the_class.second.name == name && the_class.second.fully_qualified_scope == fully_qualified_scope) { return &the_class.second; }
-        }
-
-        //printf_s("\nThin classes:\n");
-        for (auto& the_class : self.thin_classes)
-        {
-            //printf_s("Thin class: %s\n", the_class.second.name.c_str());
-            if (the_class.second.name == name && the_class.second.fully_qualified_scope == fully_qualified_scope) { return &the_class.second; }
-        }
-
+        ClassKey key{fully_qualified_scope, name};
+        if (auto the_class = self.classes.find(key); the_class != self.classes.end()) { return &the_class->second; }
+        if (auto the_class = self.thin_classes.find(key); the_class != self.thin_classes.end()) { return &the_class->second; }
         return nullptr;
     }
 
@@ -90,7 +89,7 @@ namespace RC::LuaWrapperGenerator
     auto CodeGenerator::add_class_to_container(const std::string& class_name, ClassContainer& container, const std::string& full_path_to_file, const std::string& fully_qualified_scope) -> Class&
     {
         auto[the_class, successfully_inserted] = container.insert({fully_qualified_scope + "::" + class_name,
-                                                                          Class{*this,
+                                                                          Class{get_owner(),
                                                                                   class_name,
                                                                                   fully_qualified_scope,
                                                                                   full_path_to_file}});
@@ -118,9 +117,343 @@ namespace RC::LuaWrapperGenerator
         return function->second;
     }
 
-    static auto generate_cxx_call(const Function& function, bool generate_call_and_return_code = true) -> std::string
+    static auto is_any_string_type(const Type::Base* type) -> bool
+    {
+        return type->is_a<Type::AutoString>() || type->is_a<Type::WString>() || type->is_a<Type::String>() || type->is_a<Type::CWString>() || type->is_a<Type::CString>();
+    }
+
+    auto Function::has_matching_overload(const std::vector<FunctionParam>& params) const -> bool
+    {
+        if (params.empty()) { return !m_overloads.empty(); }
+
+        for (; m_num_indexed_overloads < m_overloads.size(); ++m_num_indexed_overloads)
+        {
+            const auto& overload_params = m_overloads[m_num_indexed_overloads];
+            for (size_t i = 0; i < overload_params.size(); ++i)
+            {
+                const auto* param_type = overload_params[i].type;
+                m_overload_param_keys.emplace(OverloadParamKey{overload_params.size(), i, false, param_type->get_fully_qualified_type_name()});
+                // Hack for hard-coded strings.
+                if (is_any_string_type(param_type))
+                {
+                    m_overload_param_keys.emplace(OverloadParamKey{overload_params.size(), i, true});
+                }
+            }
+        }
+
+        for (size_t i = 0; i < params.size(); ++i)
+        {
+            const auto* checked_param_type = params[i].type;
+            if (m_overload_param_keys.contains(OverloadParamKey{params.size(), i, false, checked_param_type->get_fully_qualified_type_name()})) { continue; }
+            if (is_any_string_type(checked_param_type) && m_overload_param_keys.contains(OverloadParamKey{params.size(), i, true})) { continue; }
+            return false;
+        }
+        return true;
+    }
+
+    static auto merge_functions(FunctionContainer& into, FunctionContainer& from, Class* containing_class) -> void
+    {
+        while (!from.empty())
+        {
+            auto node = from.extract(from.begin());
+            if (auto it = into.find(node.key()); it != into.end())
+            {
+                // The same function was found in more than one partial output.
+                // Only keep the overloads that the existing function doesn't already have.
+                auto& existing_function = it->second;
+                for (auto& overload : node.mapped().get_overloads())
+                {
+                    if (existing_function.has_matching_overload(overload)) { continue; }
+                    existing_function.get_overloads().emplace_back(std::move(overload));
+                }
+            }
+            else
+            {
+                if (containing_class) { node.mapped().set_containing_class(containing_class); }
+                into.insert(std::move(node));
+            }
+        }
+    }
+
+    static auto merge_classes(ClassContainer& into, ClassContainer& from, std::unordered_map<const Class*, Class*>& merged_classes, std::vector<ClassContainer::node_type>& discarded_classes) -> void
+    {
+        while (!from.empty())
+        {
+            auto result = into.insert(from.extract(from.begin()));
+            if (result.inserted) { continue; }
+
+            // The class was found in more than one partial output.
+            // The first one is kept and everything that the discarded one has, that the kept one doesn't, is moved over.
+            auto& kept_class = result.position->second;
+            auto& discarded_class = result.node.mapped();
+            merge_functions(kept_class.container.functions, discarded_class.container.functions, &kept_class);
+            merge_functions(kept_class.static_functions, discarded_class.static_functions, &kept_class);
+            merge_functions(kept_class.constructors, discarded_class.constructors, &kept_class);
+            merge_functions(kept_class.metamethods, discarded_class.metamethods, &kept_class);
+            kept_class.has_parameterless_constructor |= discarded_class.has_parameterless_constructor;
+            if (kept_class.scope_override.empty()) { kept_class.scope_override = discarded_class.scope_override; }
+            for (const auto* base : discarded_class.get_direct_bases())
+            {
+                kept_class.add_base(base);
+            }
+
+            merged_classes.emplace(&discarded_class, &kept_class);
+            // Other classes from the same partial output may still point to the discarded class.
+            // It needs to stay alive until those pointers have been remapped.
+            discarded_classes.emplace_back(std::move(result.node));
+        }
+    }
+
+    auto CodeGenerator::remap_merged_bases(const std::unordered_map<const Class*, Class*>& merged_classes) -> void
+    {
+        if (merged_classes.empty()) { return; }
+
+        auto remap_bases = [&](ClassContainer& classes) {
+            for (auto& [_, the_class] : classes)
+            {
+                auto bases = the_class.get_direct_bases();
+                the_class.clear_bases();
+                for (const auto* base : bases)
+                {
+                    if (auto merged_class = merged_classes.find(base); merged_class != merged_classes.end())
+                    {
+                        if (merged_class->second != &the_class) { the_class.add_base(merged_class->second); }
+                    }
+                    else
+                    {
+                        the_class.add_base(base);
+                    }
+                }
+            }
+        };
+
+        remap_bases(m_container.classes);
+        remap_bases(m_container.thin_classes);
+    }
+
+    auto CodeGenerator::merge_partial_output(CodeGenerator& partial) -> void
+    {
+        auto& partial_container = partial.get_container();
+
+        std::unordered_map<const Class*, Class*> merged_classes{};
+        std::vector<ClassContainer::node_type> discarded_classes{};
+        merge_classes(m_container.classes, partial_container.classes, merged_classes, discarded_classes);
+        merge_classes(m_container.thin_classes, partial_container.thin_classes, merged_classes, discarded_classes);
+        remap_merged_bases(merged_classes);
+
+        merge_functions(m_container.functions, partial_container.functions, nullptr);
+        m_container.enums.merge(partial_container.enums);
+        m_container.lua_state_types.merge(partial_container.lua_state_types);
+        m_container.extra_includes.insert(m_container.extra_includes.end(), std::make_move_iterator(partial_container.extra_includes.begin()), std::make_move_iterator(partial_container.extra_includes.end()));
+
+        // Functions that were discarded above may have been the only users of some of the function protos.
+        // The container is rebuilt from the functions that survived the merge by 'rebuild_function_proto_container'.
+        partial_container = Container{};
+
+        // The merged functions still refer to the types of the partial generator.
+        // They aren't re-interned since that would require every param to be remapped, identical types from different partials are kept apart.
+        m_types.insert(m_types.end(), std::make_move_iterator(partial.m_types.begin()), std::make_move_iterator(partial.m_types.end()));
+        partial.m_types.clear();
+        partial.m_interned_types.clear();
+    }
+
+    enum TypeKeyFlags : uint8_t
+    {
+        IsPointerKeyFlag = 1 << 0,
+        IsRefKeyFlag = 1 << 1,
+        IsConstKeyFlag = 1 << 2,
+        IsWideStringKeyFlag = 1 << 3,
+        IsStructForwardDeclarationKeyFlag = 1 << 4,
+        IsClassForwardDeclarationKeyFlag = 1 << 5,
+        MoveOnConstructionKeyFlag = 1 << 6,
+        HasStorageKeyFlag = 1 << 7,
+    };
+
+    auto TypeKey::make(const Type::Base* type, TypeKey& out_key) -> bool
+    {
+        if (type->get_kind() >= Type::TypeKind::FirstPatchKind) { return false; }
+
+        out_key = TypeKey{type->get_kind()};
+        if (type->is_pointer()) { out_key.flags |= IsPointerKeyFlag; }
+        if (type->is_ref()) { out_key.flags |= IsRefKeyFlag; }
+        if (type->is_const()) { out_key.flags |= IsConstKeyFlag; }
+
+        switch (type->get_kind())
+        {
+            case Type::TypeKind::AutoString:
+                if (static_cast<const Type::AutoString*>(type)->m_is_wide_string) { out_key.flags |= IsWideStringKeyFlag; }
+                break;
+            case Type::TypeKind::CustomStruct:
+            {
+                auto typed_type = static_cast<const Type::CustomStruct*>(type);
+                out_key.fully_qualified_scope = typed_type->get_fully_qualified_scope();
+                out_key.name = typed_type->get_type_name();
+                if (typed_type->is_struct_forward_declaration()) { out_key.flags |= IsStructForwardDeclarationKeyFlag; }
+                if (typed_type->is_class_forward_declaration()) { out_key.flags |= IsClassForwardDeclarationKeyFlag; }
+                if (typed_type->should_move_on_construction()) { out_key.flags |= MoveOnConstructionKeyFlag; }
+                break;
+            }
+            case Type::TypeKind::Enum:
+                out_key.name = static_cast<const Type::Enum*>(type)->get_enum_name();
+                break;
+            case Type::TypeKind::FunctionProto:
+            {
+                auto typed_type = static_cast<const Type::FunctionProto*>(type);
+                out_key.name = typed_type->get_function_proto();
+                out_key.function_proto = typed_type;
+                if (typed_type->has_storage()) { out_key.flags |= HasStorageKeyFlag; }
+                break;
+            }
+            default:
+                break;
+        }
+        return true;
+    }
+
+    auto TypeKey::operator==(const TypeKey& other) const -> bool
+    {
+        if (kind != other.kind || flags != other.flags || fully_qualified_scope != other.fully_qualified_scope || name != other.name) { return false; }
+        if (!function_proto || !other.function_proto) { return function_proto == other.function_proto; }
+        return function_proto->get_param_types() == other.function_proto->get_param_types() && function_proto->get_return_type() == other.function_proto->get_return_type();
+    }
+
+    auto TypeKeyHash::operator()(const TypeKey& key) const -> size_t
+    {
+        // The params of a function proto are left out, they're almost always implied by its spelling.
+        return static_cast<size_t>(Hasher{}.update(static_cast<uint64_t>(key.kind) << 8 | key.flags).update(key.fully_qualified_scope).update(key.name).get());
+    }
+
+    auto CodeGenerator::intern_type(std::unique_ptr<Type::Base> type) -> Type::Base*
+    {
+        if (!type) { return nullptr; }
+
+        TypeKey key{};
+        if (!TypeKey::make(type.get(), key))
+        {
+            // Type patches can store anything in their types, so there's no way to tell if two of them are identical.
+            // Each one gets its own node.
+            return m_types.emplace_back(std::move(type)).get();
+        }
+
+        auto is_function_proto = type->get_kind() == Type::TypeKind::FunctionProto;
+        if (auto it = m_interned_types.find(key); it != m_interned_types.end())
+        {
+            // 'cxtype_to_type' registers function protos as it creates them, the registration must not outlive the discarded type.
+            if (is_function_proto)
+            {
+                auto& function_proto_container = m_container.function_proto_container;
+                auto function_proto = function_proto_container.find(static_cast<Type::FunctionProto*>(type.get())->get_function_proto());
+                if (function_proto != function_proto_container.end() && function_proto->second == type.get())
+                {
+                    function_proto->second = static_cast<Type::FunctionProto*>(it->second);
+                }
+            }
+            return it->second;
+        }
+
+        // The key points into the type, which doesn't move when the owning pointer is moved into 'm_types'.
+        auto* interned_type = m_types.emplace_back(std::move(type)).get();
+        m_interned_types.emplace(key, interned_type);
+        if (is_function_proto)
+        {
+            auto* function_proto = static_cast<Type::FunctionProto*>(interned_type);
+            m_container.function_proto_container.emplace(function_proto->get_function_proto(), function_proto);
+        }
+        return interned_type;
+    }
+
+    static auto collect_function_protos(const Type::Base* type, FunctionProtoContainer& function_proto_container) -> void
+    {
+        if (!type || type->get_kind() != Type::TypeKind::FunctionProto) { return; }
+
+        auto* function_proto = const_cast<Type::FunctionProto*>(static_cast<const Type::FunctionProto*>(type));
+        function_proto_container.emplace(function_proto->get_function_proto(), function_proto);
+        for (const auto& param_type : function_proto->get_param_types())
+        {
+            collect_function_protos(param_type, function_proto_container);
+        }
+    }
+
+    static auto collect_function_protos(const FunctionContainer& functions, FunctionProtoContainer& function_proto_container) -> void
+    {
+        for (const auto& [_, function] : functions)
+        {
+            collect_function_protos(function.get_return_type(), function_proto_container);
+            for (const auto& overload : function.get_overloads())
+            {
+                for (const auto& param : overload)
+                {
+                    collect_function_protos(param.type, function_proto_container);
+                }
+            }
+        }
+    }
+
+    auto CodeGenerator::rebuild_function_proto_container() -> void
+    {
+        auto& function_proto_container = m_container.function_proto_container;
+        function_proto_container.clear();
+
+        collect_function_protos(m_container.functions, function_proto_container);
+        auto collect_from_classes = [&](const ClassContainer& classes) {
+            for (const auto& [_, the_class] : classes)
+            {
+                collect_function_protos(the_class.container.functions, function_proto_container);
+                collect_function_protos(the_class.static_functions, function_proto_container);
+                collect_function_protos(the_class.constructors, function_proto_container);
+                collect_function_protos(the_class.metamethods, function_proto_container);
+            }
+        };
+        collect_from_classes(m_container.classes);
+        collect_from_classes(m_container.thin_classes);
+    }
+
+    auto CodeGenerator::write_ir_file(const std::filesystem::path& ir_file) const -> void
+    {
+        Trace::Span span{"write_ir_file", ir_file.string()};
+        IRWriter writer{m_type_patches};
+        // Patched types are stored by the index of their patch, a different set of patches can't read them back.
+        writer.write_u32(static_cast<uint32_t>(m_type_patches.size()));
+        writer.write_container(m_container);
+        auto contents = writer.finish();
+
+        if (ir_file.has_parent_path())
+        {
+            std::filesystem::create_directories(ir_file.parent_path());
+        }
+        std::ofstream file{ir_file, std::ios::binary | std::ios::trunc};
+        if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size())))
+        {
+            throw std::runtime_error{std::format("Unable to write binding IR to '{}'", ir_file.string())};
+        }
+    }
+
+    auto CodeGenerator::read_ir_file(const std::filesystem::path& ir_file) -> void
+    {
+        Trace::Span span{"read_ir_file", ir_file.string()};
+        std::ifstream file{ir_file, std::ios::binary};
+        if (!file)
+        {
+            throw std::runtime_error{std::format("Unable to open binding IR file '{}'", ir_file.string())};
+        }
+        // The reader copies everything it needs so the contents don't have to outlive this function.
+        std::string contents{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+        IRReader reader{contents, this};
+        if (auto num_type_patches = reader.read_u32(); num_type_patches != m_type_patches.size())
+        {
+            throw std::runtime_error{std::format("'{}' was written with {} type patches, expected {}", ir_file.string(), num_type_patches, m_type_patches.size())};
+        }
+        reader.read_container();
+        if (!reader.is_at_end())
+        {
+            throw std::runtime_error{std::format("Unexpected data at the end of '{}'", ir_file.string())};
+        }
+        rebuild_function_proto_container();
+    }
+
+    static auto generate_cxx_call(CodeWriter& out, const Function& function, bool generate_call_and_return_code = true) -> void
     {
-        std::string buffer{};
         std::vector<std::string> recursion_resetters{};
 
         enum class IsWrappedInLambda { Yes, No };
@@ -140,47 +473,47 @@ namespace RC::LuaWrapperGenerator
                     {
                         pointer_ref.append("&");
                     }
-                    buffer.append(std::format("        auto{} return_value = ", pointer_ref));
+                    out.write("        auto{} return_value = ", pointer_ref);
                 }
             }
 
             if (generate_return_statement == GenerateReturnStatement::Yes && is_wrapped_in_lambda == IsWrappedInLambda::Yes)
             {
-                buffer.append("                return ");
+                out.append("                return ");
             }
 
             if (function.get_containing_class() && !function.is_static())
             {
-                buffer.append(std::format("{}self->{}(", return_value_is_void ? "        " : "", function.get_name()));
+                out.write("{}self->{}(", return_value_is_void ? "        " : "", function.get_name());
             }
             else
             {
                 if (function.is_constructor())
                 {
-                    buffer.append(std::format("{}{}(", return_value_is_void ? "        " : "", function.get_fully_qualified_scope()));
+                    out.write("{}{}(", return_value_is_void ? "        " : "", function.get_fully_qualified_scope());
                 }
                 else
                 {
-                    buffer.append(std::format("{}{}::{}(", return_value_is_void ? "        " : "", function.get_fully_qualified_scope(), function.get_name()));
+                    out.write("{}{}::{}(", return_value_is_void ? "        " : "", function.get_fully_qualified_scope(), function.get_name());
                 }
             }
 
             for (size_t i = 0; i < params.size(); ++i)
             {
                 const auto& param = params[i];
-                buffer.append(std::format("param_{}", /*param.type->is_a<Type::CustomStruct>() && !param.type->is_pointer() ? "*" : "",*/ i + 1));
+                out.write("param_{}", /*param.type->is_a<Type::CustomStruct>() && !param.type->is_pointer() ? "*" : "",*/ i + 1);
 
                 if (i + 1 < params.size())
                 {
-                    buffer.append(", ");
+                    out.append(", ");
                 }
             }
 
-            buffer.append(");\n\n");
+            out.append(");\n\n");
 
             for (const auto recursion_resetter : recursion_resetters)
             {
-                buffer.append(recursion_resetter);
+                out.append(recursion_resetter);
             }
         };
 
@@ -196,22 +529,22 @@ namespace RC::LuaWrapperGenerator
 
                 if (!param.type->needs_extra_processing())
                 {
-                    buffer.append(std::format("        luaL_argcheck(lua_state, {}, {}, \"\");\n", param.type->generate_lua_stack_validation_condition(lua_stack_index), lua_current_param));
+                    out.write("        luaL_argcheck(lua_state, {}, {}, \"\");\n", param.type->generate_lua_stack_validation_condition(lua_stack_index), lua_current_param);
                 }
 
                 if (param.type->needs_extra_processing())
                 {
-                    buffer.append(std::format("{}", param.type->generate_extra_processing(lua_stack_index, lua_current_param)));
+                    out.append(param.type->generate_extra_processing(lua_stack_index, lua_current_param));
                 }
                 else if (!param.type->needs_conversion_from_lua())
                 {
                     auto is_string = param.type->is_a<Type::CString>() || param.type->is_a<Type::CWString>() || param.type->is_a<Type::String>() || param.type->is_a<Type::WString>() || param.type->is_a<Type::AutoString>();
-                    buffer.append(std::format("        auto{} param_{} = {};\n", !is_string && param.type->is_ref() ? "&" : "", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index)));
+                    out.write("        auto{} param_{} = {};\n", !is_string && param.type->is_ref() ? "&" : "", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index));
                 }
                 else
                 {
-                    buffer.append(std::format("        auto param_inter_{} = {};\n", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index)));
-                    buffer.append(std::format("        {};\n", param.type->generate_converted_type(lua_stack_index, recursion_resetters)));
+                    out.write("        auto param_inter_{} = {};\n", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index));
+                    out.write("        {};\n", param.type->generate_converted_type(lua_stack_index, recursion_resetters));
                 }
 
                 // We could check for non-nullptr userdata here for 'CustomStruct' types.
@@ -222,7 +555,7 @@ namespace RC::LuaWrapperGenerator
                 //    buffer.append(std::format("    luaL_argcheck(lua_state, param_{}, {}, \"test2\");\n", lua_stack_index, lua_current_param));
                 //}
 
-                buffer.append("\n");
+                out.append("\n");
             }
 
             if (generate_call_and_return_code)
@@ -232,70 +565,70 @@ namespace RC::LuaWrapperGenerator
         }
         else
         {
-            buffer.append("        std::unordered_set<int> matching_overloads{};\n");
-            buffer.append("        int num_matching_overloads{};\n");
-            buffer.append("        auto num_params_on_stack = lua_gettop(lua_state);\n");
+            out.append("        std::unordered_set<int> matching_overloads{};\n");
+            out.append("        int num_matching_overloads{};\n");
+            out.append("        auto num_params_on_stack = lua_gettop(lua_state);\n");
             for (int x = 0; x < function.get_overloads().size(); ++x)
             {
-                buffer.append("        if (");
+                out.append("        if (");
                 const auto& param_overloads = function.get_overloads()[x];
-                buffer.append(std::format("(num_params_on_stack == {}) &&\n", param_overloads.size()));
+                out.write("(num_params_on_stack == {}) &&\n", param_overloads.size());
                 for (int i = 0; i < param_overloads.size(); ++i)
                 {
                     const auto& param = param_overloads[i];
                     const auto lua_stack_index = i + 1;
                     const auto lua_current_param = i + 2;
 
-                    buffer.append(std::format("            ({})", param.type->generate_lua_stack_validation_condition(lua_stack_index)));
+                    out.write("            ({})", param.type->generate_lua_stack_validation_condition(lua_stack_index));
                     if (i + 1 < param_overloads.size())
                     {
-                        buffer.append(" &&\n");
+                        out.append(" &&\n");
                     }
                 }
-                buffer.append(")\n");
-                buffer.append("        {\n");
+                out.append(")\n");
+                out.append("        {\n");
                 for (int i = 0; i < param_overloads.size(); ++i)
                 {
                     const auto& param = param_overloads[i];
                     const auto lua_stack_index = i + 1;
                     const auto lua_current_param = i + 2;
-                    buffer.append(std::format("            bool param_overload_resolution_condition_{} = [=]() {{\n", lua_stack_index));
-                    buffer.append(std::format("{}\n", param.type->generate_lua_overload_resolution_condition(lua_stack_index)));
-                    buffer.append("            }();\n\n");
+                    out.write("            bool param_overload_resolution_condition_{} = [=]() {{\n", lua_stack_index);
+                    out.write("{}\n", param.type->generate_lua_overload_resolution_condition(lua_stack_index));
+                    out.append("            }();\n\n");
                 }
 
-                buffer.append("            if (");
+                out.append("            if (");
                 for (int i = 0; i < param_overloads.size(); ++i)
                 {
                     const auto& param = param_overloads[i];
                     const auto lua_stack_index = i + 1;
                     const auto lua_current_param = i + 2;
 
-                    buffer.append(std::format("{}param_overload_resolution_condition_{}", i == 0 ? "" : "                ", lua_stack_index));
+                    out.write("{}param_overload_resolution_condition_{}", i == 0 ? "" : "                ", lua_stack_index);
                     if (i + 1 < param_overloads.size())
                     {
-                        buffer.append(" &&\n");
+                        out.append(" &&\n");
                     }
                 }
 
-                buffer.append(")\n");
-                buffer.append("            {\n");
-                buffer.append(std::format("                matching_overloads.emplace({});\n", x));
-                buffer.append("            }\n");
+                out.append(")\n");
+                out.append("            {\n");
+                out.write("                matching_overloads.emplace({});\n", x);
+                out.append("            }\n");
 
-                buffer.append("        }\n\n");
+                out.append("        }\n\n");
             }
 
-            buffer.append("        if (matching_overloads.size() > 1)\n");
-            buffer.append("        {\n");
-            buffer.append(std::format("            luaL_error(lua_state, \"Ambiguous overload for function '{}' (no overload was specific enough to match the parameters)\");\n", function.get_name()));
-            buffer.append("        }\n");
-            buffer.append("        else if (matching_overloads.empty())\n");
-            buffer.append("        {\n");
-            buffer.append(std::format("            luaL_error(lua_state, \"No overload found for function '{}'\");\n", function.get_name()));
-            buffer.append("        }\n\n");
+            out.append("        if (matching_overloads.size() > 1)\n");
+            out.append("        {\n");
+            out.write("            luaL_error(lua_state, \"Ambiguous overload for function '{}' (no overload was specific enough to match the parameters)\");\n", function.get_name());
+            out.append("        }\n");
+            out.append("        else if (matching_overloads.empty())\n");
+            out.append("        {\n");
+            out.write("            luaL_error(lua_state, \"No overload found for function '{}'\");\n", function.get_name());
+            out.append("        }\n\n");
 
-            buffer.append("        auto selected_overload = *matching_overloads.begin();\n\n");
+            out.append("        auto selected_overload = *matching_overloads.begin();\n\n");
 
             std::string pointer_ref{};
             if (function.get_return_type()->is_pointer())
@@ -306,20 +639,20 @@ namespace RC::LuaWrapperGenerator
             {
                 pointer_ref.append("&");
             }
-            buffer.append(std::format("        {}[=]() {{\n", !function.get_return_type()->is_a<Type::Void>() || function.get_return_type()->is_pointer() ? std::format("auto{} return_value = ", pointer_ref) : ""));
+            out.write("        {}[=]() {{\n", !function.get_return_type()->is_a<Type::Void>() || function.get_return_type()->is_pointer() ? std::format("auto{} return_value = ", pointer_ref) : "");
             for (size_t x = 0; x < function.get_overloads().size(); ++x)
             {
                 const auto& param_overloads = function.get_overloads()[x];
 
                 if (x == 0)
                 {
-                    buffer.append(std::format("            if (selected_overload == {})\n", x));
+                    out.write("            if (selected_overload == {})\n", x);
                 }
                 else
                 {
-                    buffer.append(std::format("            else if (selected_overload == {})\n", x));
+                    out.write("            else if (selected_overload == {})\n", x);
                 }
-                buffer.append("            {\n");
+                out.append("            {\n");
 
                 for (int i = 0; i < param_overloads.size(); ++i)
                 {
@@ -329,21 +662,21 @@ namespace RC::LuaWrapperGenerator
 
                     if (!param.type->needs_extra_processing())
                     {
-                        buffer.append(std::format("                luaL_argcheck(lua_state, {}, {}, \"\");\n", param.type->generate_lua_stack_validation_condition(lua_stack_index), lua_current_param));
+                        out.write("                luaL_argcheck(lua_state, {}, {}, \"\");\n", param.type->generate_lua_stack_validation_condition(lua_stack_index), lua_current_param);
                     }
 
                     if (param.type->needs_extra_processing())
                     {
-                        buffer.append(std::format("{}", param.type->generate_extra_processing(lua_stack_index, lua_current_param)));
+                        out.append(param.type->generate_extra_processing(lua_stack_index, lua_current_param));
                     }
                     else if (!param.type->needs_conversion_from_lua())
                     {
-                        buffer.append(std::format("                auto{} param_{} = {};\n", param.type->is_ref() ? "&" : "", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index)));
+                        out.write("                auto{} param_{} = {};\n", param.type->is_ref() ? "&" : "", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index));
                     }
                     else
                     {
-                        buffer.append(std::format("                auto param_inter_{} = {};\n", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index)));
-                        buffer.append(std::format("                {};\n", param.type->generate_converted_type(lua_stack_index, recursion_resetters)));
+                        out.write("                auto param_inter_{} = {};\n", lua_stack_index, param.type->generate_lua_stack_retriever(lua_stack_index));
+                        out.write("                {};\n", param.type->generate_converted_type(lua_stack_index, recursion_resetters));
                     }
                 }
 
@@ -351,18 +684,17 @@ namespace RC::LuaWrapperGenerator
                 {
                     generate_function_tail(param_overloads, IsWrappedInLambda::Yes, !function.get_return_type()->is_a<Type::Void>() || function.get_return_type()->is_pointer() ? GenerateReturnStatement::Yes : GenerateReturnStatement::No);
                 }
-                buffer.append("            }\n");
+                out.append("            }\n");
             }
-            buffer.append("            else\n");
-            buffer.append("            {\n");
-            buffer.append("                luaL_error(lua_state, \"Overload resolution failed and wasn't caught\");\n");
+            out.append("            else\n");
+            out.append("            {\n");
+            out.append("                luaL_error(lua_state, \"Overload resolution failed and wasn't caught\");\n");
             // Must throw here otherwise the compiler gives a warning because it can't see the jmp from luaL_error.
-            buffer.append("                throw std::runtime_error{\"\"};\n");
-            buffer.append("            }\n");
-            buffer.append("        }();\n\n");
+            out.append("                throw std::runtime_error{\"\"};\n");
+            out.append("            }\n");
+            out.append("        }();\n\n");
         }
 
-        return buffer;
     }
 
     namespace Type
@@ -1022,51 +1354,49 @@ namespace RC::LuaWrapperGenerator
             }
             return function_signature;
         }
-        auto FunctionProto::generate_lua_wrapper_function() const -> std::string
-        {
-            std::string buffer{};
-            buffer.append(std::format("inline auto {}(lua_State* lua_state) -> int\n", generate_function_signature_as_function_name()));
-            buffer.append("{\n");
-            buffer.append("    try\n    {\n");
-
-            buffer.append("        // Prologue\n");
-            buffer.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
-            buffer.append("        lua_getmetatable(lua_state, 1);\n");
-            buffer.append("        lua_pushliteral(lua_state, \"__name\");\n");
-            buffer.append("        lua_rawget(lua_state, -2);\n");
-            buffer.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
-            buffer.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
-            buffer.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
-            buffer.append("        lua_pop(lua_state, 2);\n");
-            buffer.append("        lua_remove(lua_state, 1);\n\n");
-
-            buffer.append("        // Native call\n");
-            buffer.append(generate_cxx_call(get_function(), false));
-            buffer.append("\n");
-            buffer.append(std::format("    std::bit_cast<{}>(function_proto->function_pointer)(", generate_function_signature(true)));
+        auto FunctionProto::generate_lua_wrapper_function(CodeWriter& out) const -> void
+        {
+            out.write("inline auto {}(lua_State* lua_state) -> int\n", generate_function_signature_as_function_name());
+            out.append("{\n");
+            out.append("    try\n    {\n");
+
+            out.append("        // Prologue\n");
+            out.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
+            out.append("        lua_getmetatable(lua_state, 1);\n");
+            out.append("        lua_pushliteral(lua_state, \"__name\");\n");
+            out.append("        lua_rawget(lua_state, -2);\n");
+            out.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
+            out.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
+            out.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
+            out.append("        lua_pop(lua_state, 2);\n");
+            out.append("        lua_remove(lua_state, 1);\n\n");
+
+            out.append("        // Native call\n");
+            generate_cxx_call(out, get_function(), false);
+            out.append("\n");
+            out.write("    std::bit_cast<{}>(function_proto->function_pointer)(", generate_function_signature(true));
             const auto& params = get_function().get_overloads()[0];
             for (size_t i = 0; i < params.size(); ++i)
             {
                 const auto& param = params[i];
-                buffer.append(std::format("param_{}", i + 1));
+                out.write("param_{}", i + 1);
 
                 if (i + 1 < params.size())
                 {
-                    buffer.append(", ");
+                    out.append(", ");
                 }
             }
-            buffer.append(");\n");
+            out.append(");\n");
             // TODO: Implement return value.
-            buffer.append("return 0;\n");
-            buffer.append("    }\n");
-            buffer.append("    catch (std::exception& e)\n");
-            buffer.append("    {\n");
-            buffer.append("        luaL_error(lua_state, e.what());\n");
-            buffer.append("        return 0;\n");
-            buffer.append("    }\n");
-            buffer.append("\n");
-            buffer.append("}\n");
-            return buffer;
+            out.append("return 0;\n");
+            out.append("    }\n");
+            out.append("    catch (std::exception& e)\n");
+            out.append("    {\n");
+            out.append("        luaL_error(lua_state, e.what());\n");
+            out.append("        return 0;\n");
+            out.append("    }\n");
+            out.append("\n");
+            out.append("}\n");
         }
     }
 
@@ -1093,17 +1423,19 @@ namespace RC::LuaWrapperGenerator
         return nullptr;
     }
 
-    auto Class::get_bases() const -> std::vector<const Class*>
+    static auto collect_bases(const std::vector<const Class*>& bases, std::vector<const Class*>& all_bases) -> void
     {
-        std::vector<const Class*> all_bases{};
-
-        for (const auto& base : bases)
+        for (const auto* base : bases)
         {
             all_bases.emplace_back(base);
-            auto bases_bases = base->get_bases();
-            all_bases.insert(all_bases.end(), std::make_move_iterator(bases_bases.begin()), std::make_move_iterator(bases_bases.end()));
+            collect_bases(base->get_direct_bases(), all_bases);
         }
+    }
 
+    auto Class::get_bases() const -> std::vector<const Class*>
+    {
+        std::vector<const Class*> all_bases{};
+        collect_bases(bases, all_bases);
         return all_bases;
     }
 
@@ -1119,9 +1451,20 @@ namespace RC::LuaWrapperGenerator
         }
     }
 
-    auto Class::get_mutable_bases() -> std::unordered_set<const Class*>&
+    // Classes with the same scope and name, like a class and its thin class, are ordered by address since they can't be told apart otherwise.
+    static auto is_base_ordered_before(const Class* a, const Class* b) -> bool
+    {
+        auto a_key = std::pair<std::string_view, std::string_view>{a->fully_qualified_scope, a->name};
+        auto b_key = std::pair<std::string_view, std::string_view>{b->fully_qualified_scope, b->name};
+        if (a_key != b_key) { return a_key < b_key; }
+        return std::less<const Class*>{}(a, b);
+    }
+
+    auto Class::add_base(const Class* base) -> void
     {
-        return bases;
+        auto it = std::lower_bound(bases.begin(), bases.end(), base, is_base_ordered_before);
+        if (it != bases.end() && *it == base) { return; }
+        bases.insert(it, base);
     }
 
     auto is_name_an_operator_overload(std::string_view name) -> bool
@@ -1175,10 +1518,8 @@ namespace RC::LuaWrapperGenerator
         }
     }
 
-    auto Class::generate_metamethods_map_contents() const -> std::string
+    auto Class::generate_metamethods_map_contents(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
         for (const auto& metamethod_name : s_valid_metamethod_names)
         {
             auto metamethod_impl = get_metamethod_by_name(metamethod_name);
@@ -1197,17 +1538,14 @@ namespace RC::LuaWrapperGenerator
 
             if (metamethod_impl)
             {
-                buffer.append(std::format("    {{\"{}\", &{}}},\n", metamethod_impl->get_name(), metamethod_impl->get_wrapper_name()));
+                out.write("    {{\"{}\", &{}}},\n", metamethod_impl->get_name(), metamethod_impl->get_wrapper_name());
             }
         }
 
-        return buffer;
     }
 
-    auto Class::generate_member_functions_map_contents() const -> std::string
+    auto Class::generate_member_functions_map_contents(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
         std::unordered_map<std::string_view, bool> reserved_function_name_collision{
                 {"Set", false},
                 {"set", false},
@@ -1218,7 +1556,7 @@ namespace RC::LuaWrapperGenerator
         };
 
         auto generate_map_contents_from_container = [&](const FunctionContainer& functions, const Class* the_class) {
-            for (const auto&[_, function] : functions)
+            for (const auto&[_, function] : sorted_by_key(functions))
             {
                 auto function_name = function.get_name();
                 if (auto it = reserved_function_name_collision.find(function_name); it != reserved_function_name_collision.end())
@@ -1232,11 +1570,11 @@ namespace RC::LuaWrapperGenerator
                 }
                 if (function.is_custom_redirector())
                 {
-                    buffer.append(std::format("    {{\"{}\", &{}}},\n", function_name, function.get_wrapper_name()));
+                    out.write("    {{\"{}\", &{}}},\n", function_name, function.get_wrapper_name());
                 }
                 else
                 {
-                    buffer.append(std::format("    {{\"{}\", &{}_{}_member_function_wrapper_{}}},\n", function_name, scope_as_function_name(the_class->fully_qualified_scope), the_class->name, function_name));
+                    out.write("    {{\"{}\", &{}_{}_member_function_wrapper_{}}},\n", function_name, scope_as_function_name(the_class->fully_qualified_scope), the_class->name, function_name);
                 }
             }
         };
@@ -1248,34 +1586,35 @@ namespace RC::LuaWrapperGenerator
             generate_map_contents_from_container(inherited_class->container.functions, inherited_class);
         }
 
-        buffer.append("\n    // Generic utility\n");
+        // The utilities all take the same getter for 'self', and 'Set' and 'set' are the same wrapper, so each is only formatted once.
+        auto scope_name = scope_as_function_name(fully_qualified_scope);
+        auto get_self = std::format("internal_{}__{}_get_self<{}::{}**, true>", scope_name, name, fully_qualified_scope, name);
+
+        out.append("\n    // Generic utility\n");
         if (!reserved_function_name_collision.at("Set") && !reserved_function_name_collision.at("set"))
         {
-            buffer.append(std::format("    {{\"Set\", &lua_util_userdata_member_function_wrapper_Set<\"{}_{}Metatable\", {}::{}, convertible_to_{}_{}, decltype(internal_{}__{}_get_self<{}::{}**, true>), internal_{}__{}_get_self<{}::{}**, true>>}},\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
-            buffer.append(std::format("    {{\"set\", &lua_util_userdata_member_function_wrapper_Set<\"{}_{}Metatable\", {}::{}, convertible_to_{}_{}, decltype(internal_{}__{}_get_self<{}::{}**, true>), internal_{}__{}_get_self<{}::{}**, true>>}},\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
+            auto set_wrapper = std::format("lua_util_userdata_member_function_wrapper_Set<\"{}_{}Metatable\", {}::{}, convertible_to_{}_{}, decltype({}), {}>", scope_name, name, fully_qualified_scope, name, scope_name, name, get_self, get_self);
+            out.write_line(1, "{{\"Set\", &{}}},", set_wrapper);
+            out.write_line(1, "{{\"set\", &{}}},", set_wrapper);
         }
         if (!reserved_function_name_collision.at("Get") && !reserved_function_name_collision.at("get"))
         {
-            buffer.append("    {\"Get\", &lua_util_userdata_member_function_wrapper_Get},\n");
-            buffer.append("    {\"get\", &lua_util_userdata_member_function_wrapper_Get},\n");
+            out.append("    {\"Get\", &lua_util_userdata_member_function_wrapper_Get},\n");
+            out.append("    {\"get\", &lua_util_userdata_member_function_wrapper_Get},\n");
         }
         if (!reserved_function_name_collision.at("IsValid"))
         {
-            buffer.append(std::format("    {{\"IsValid\", &lua_util_userdata_member_function_wrapper_IsValid<decltype(internal_{}__{}_get_self<{}::{}**, true>), internal_{}__{}_get_self<{}::{}**, true>>}},\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
+            out.write_line(1, "{{\"IsValid\", &lua_util_userdata_member_function_wrapper_IsValid<decltype({}), {}>}},", get_self, get_self);
         }
         if (!reserved_function_name_collision.at("GetAddress"))
         {
-            buffer.append(std::format("    {{\"GetAddress\", &lua_util_userdata_member_function_wrapper_GetAddress<decltype(internal_{}__{}_get_self<{}::{}**, true>), internal_{}__{}_get_self<{}::{}**, true>>}},\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
+            out.write_line(1, "{{\"GetAddress\", &lua_util_userdata_member_function_wrapper_GetAddress<decltype({}), {}>}},", get_self, get_self);
         }
-
-        return buffer;
     }
 
-    auto Class::generate_member_functions() const -> std::string
+    auto Class::generate_member_functions(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        for (const auto&[_, member_function] : container.functions)
+        for (const auto&[_, member_function] : sorted_by_key(container.functions))
         {
             if (member_function.is_custom_redirector()) { continue; }
 
@@ -1285,136 +1624,122 @@ namespace RC::LuaWrapperGenerator
                 // TODO: Properly implement operator overloading by redirecting as many as possible to the Lua equivalent.
                 continue;
             }
-            buffer.append(std::format("inline auto {}_{}_member_function_wrapper_{}(lua_State* lua_state) -> int\n{{\n", scope_as_function_name(fully_qualified_scope), name, member_function.get_name()));
-            buffer.append(member_function.generate_lua_wrapper_function_body());
-            buffer.append("}\n\n");
+            out.write("inline auto {}_{}_member_function_wrapper_{}(lua_State* lua_state) -> int\n{{\n", scope_as_function_name(fully_qualified_scope), name, member_function.get_name());
+            member_function.generate_lua_wrapper_function_body(out);
+            out.append("}\n\n");
         }
 
-        for (const auto&[_, static_member_function] : static_functions)
+        for (const auto&[_, static_member_function] : sorted_by_key(static_functions))
         {
             if (static_member_function.is_custom_redirector()) { continue; }
 
             auto function_name = static_member_function.get_name();
-            buffer.append(std::format("inline auto {}_{}_member_function_wrapper_{}(lua_State* lua_state) -> int\n{{\n", scope_as_function_name(fully_qualified_scope), name, static_member_function.get_name()));
-            buffer.append(static_member_function.generate_lua_wrapper_function_body());
-            buffer.append("}\n\n");
+            out.write("inline auto {}_{}_member_function_wrapper_{}(lua_State* lua_state) -> int\n{{\n", scope_as_function_name(fully_qualified_scope), name, static_member_function.get_name());
+            static_member_function.generate_lua_wrapper_function_body(out);
+            out.append("}\n\n");
         }
 
-        return buffer;
     }
 
-    auto Class::generate_constructor() const -> std::string
+    auto Class::generate_constructor(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
         if (auto constructor_it = constructors.find(fully_qualified_scope + "::" + name + "::" + name); constructor_it != constructors.end())
         {
             const auto& constructor = constructor_it->second;
 
-            buffer.append(std::format("inline auto lua_setup_{}_{}_constructor_dispatch(lua_State* lua_state) -> void\n", scope_as_function_name(fully_qualified_scope), name));
-            buffer.append("{\n");
-            buffer.append("    lua_newtable(lua_state);\n");
-            buffer.append("    lua_pushliteral(lua_state, \"__call\");\n");
-            buffer.append("    lua_pushcfunction(lua_state, ([](lua_State* lua_state) -> int {\n");
-            buffer.append("        lua_remove(lua_state, 1);\n");
+            out.write("inline auto lua_setup_{}_{}_constructor_dispatch(lua_State* lua_state) -> void\n", scope_as_function_name(fully_qualified_scope), name);
+            out.append("{\n");
+            out.append("    lua_newtable(lua_state);\n");
+            out.append("    lua_pushliteral(lua_state, \"__call\");\n");
+            out.append("    lua_pushcfunction(lua_state, ([](lua_State* lua_state) -> int {\n");
+            out.append("        lua_remove(lua_state, 1);\n");
             auto function_name = constructor.get_name();
             if (has_parameterless_constructor)
             {
-                buffer.append("        if (lua_gettop(lua_state) == 0)\n");
-                buffer.append("        {\n");
-                buffer.append(std::format("            auto constructed_object = {}::{}{{}};\n", fully_qualified_scope, name));
-                buffer.append(std::format("            auto* userdata = static_cast<{}::{}*>(lua_newuserdatauv(lua_state, sizeof({}::{}), 1));\n", fully_qualified_scope, name, fully_qualified_scope, name));
-                buffer.append("            lua_pushinteger(lua_state, 0);\n");
-                buffer.append("            lua_setiuservalue(lua_state, -2, 1);\n");
-                buffer.append(std::format("            new(userdata) {}::{}{{std::move(constructed_object)}};\n", fully_qualified_scope, name));
+                out.append("        if (lua_gettop(lua_state) == 0)\n");
+                out.append("        {\n");
+                out.write("            auto constructed_object = {}::{}{{}};\n", fully_qualified_scope, name);
+                out.write("            auto* userdata = static_cast<{}::{}*>(lua_newuserdatauv(lua_state, sizeof({}::{}), 1));\n", fully_qualified_scope, name, fully_qualified_scope, name);
+                out.append("            lua_pushinteger(lua_state, 0);\n");
+                out.append("            lua_setiuservalue(lua_state, -2, 1);\n");
+                out.write("            new(userdata) {}::{}{{std::move(constructed_object)}};\n", fully_qualified_scope, name);
                 // Is 'fully_qualified_scope' right ?
-                buffer.append(std::format("            luaL_getmetatable(lua_state, \"{}_{}Metatable\");\n", scope_as_function_name(fully_qualified_scope), name));
-                buffer.append("            lua_setmetatable(lua_state, -2);\n");
-                buffer.append("            return 1;\n");
-                buffer.append("        }\n");
+                out.write("            luaL_getmetatable(lua_state, \"{}_{}Metatable\");\n", scope_as_function_name(fully_qualified_scope), name);
+                out.append("            lua_setmetatable(lua_state, -2);\n");
+                out.append("            return 1;\n");
+                out.append("        }\n");
             }
-            buffer.append(constructor.generate_lua_wrapper_function_body());
-            buffer.append("    }));\n");
-            buffer.append("    lua_rawset(lua_state, -3);\n");
-            buffer.append("    lua_setmetatable(lua_state, -2);\n");
-            buffer.append("}");
+            constructor.generate_lua_wrapper_function_body(out);
+            out.append("    }));\n");
+            out.append("    lua_rawset(lua_state, -3);\n");
+            out.append("    lua_setmetatable(lua_state, -2);\n");
+            out.append("}");
         }
 
-        return buffer;
     }
 
-    auto Class::generate_metamethods_map() const -> std::string
+    auto Class::generate_metamethods_map(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append(std::format("inline static std::unordered_map<std::string, int (*)(lua_State*, void*)> {}_{}_metamethods = {{\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append(generate_metamethods_map_contents());
-        buffer.append("};\n");
-
-        return buffer;
+        out.write("inline static std::unordered_map<std::string, int (*)(lua_State*, void*)> {}_{}_metamethods = {{\n", scope_as_function_name(fully_qualified_scope), name);
+        generate_metamethods_map_contents(out);
+        out.append("};\n");
     }
 
-    auto Class::generate_member_functions_map() const -> std::string
+    auto Class::generate_member_functions_map(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append(std::format("inline static std::unordered_map<std::string, int (*)(lua_State*)> {}_{}_member_functions = {{\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append(generate_member_functions_map_contents());
-        buffer.append("};\n");
-
-        return buffer;
+        out.write("inline static std::unordered_map<std::string, int (*)(lua_State*)> {}_{}_member_functions = {{\n", scope_as_function_name(fully_qualified_scope), name);
+        generate_member_functions_map_contents(out);
+        out.append("};\n");
     }
 
-    auto Class::generate_setup_function() const -> std::string
+    auto Class::generate_setup_function(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append(std::format("inline auto lua_setup_{}_{}(lua_State* lua_state) -> void\n{{\n", scope_as_function_name(fully_qualified_scope), name));
+        out.write("inline auto lua_setup_{}_{}(lua_State* lua_state) -> void\n{{\n", scope_as_function_name(fully_qualified_scope), name);
 
-        buffer.append("    // Metatable For Userdata -> START\n");
-        buffer.append(std::format("    luaL_newmetatable(lua_state, \"{}_{}Metatable\");\n\n", scope_as_function_name(fully_qualified_scope), name));
+        out.append("    // Metatable For Userdata -> START\n");
+        out.write("    luaL_newmetatable(lua_state, \"{}_{}Metatable\");\n\n", scope_as_function_name(fully_qualified_scope), name);
 
-        buffer.append("    lua_pushliteral(lua_state, \"__cxx_name\");\n");
-        buffer.append(std::format("    lua_pushliteral(lua_state, \"{}::{}\");\n", fully_qualified_scope, name));
-        buffer.append("    lua_rawset(lua_state, -3);\n\n");
+        out.append("    lua_pushliteral(lua_state, \"__cxx_name\");\n");
+        out.write("    lua_pushliteral(lua_state, \"{}::{}\");\n", fully_qualified_scope, name);
+        out.append("    lua_rawset(lua_state, -3);\n\n");
 
         for (const auto& type_patch : code_generator.get_type_patches())
         {
             if (type_patch.generate_per_class_static_functions)
             {
-                buffer.append(type_patch.generate_per_class_static_functions(*this));
+                out.append(type_patch.generate_per_class_static_functions(*this));
             }
         }
 
-        buffer.append("    lua_pushliteral(lua_state, \"__index\");\n");
-        buffer.append("    lua_pushcclosure(lua_state, [](lua_State* lua_state) -> int {\n");
-        buffer.append("        if (!lua_isuserdata(lua_state, -2))\n");
-        buffer.append("        {\n");
-        buffer.append("                lua_remove(lua_state, -1);\n");
-        buffer.append("                lua_remove(lua_state, -2);\n");
-        buffer.append(std::format("                luaL_error(lua_state, \"{} member accessed without self context\");\n", name));
-        buffer.append("        }\n\n");
+        out.append("    lua_pushliteral(lua_state, \"__index\");\n");
+        out.append("    lua_pushcclosure(lua_state, [](lua_State* lua_state) -> int {\n");
+        out.append("        if (!lua_isuserdata(lua_state, -2))\n");
+        out.append("        {\n");
+        out.append("                lua_remove(lua_state, -1);\n");
+        out.append("                lua_remove(lua_state, -2);\n");
+        out.write("                luaL_error(lua_state, \"{} member accessed without self context\");\n", name);
+        out.append("        }\n\n");
 
-        buffer.append("        luaL_argcheck(lua_state, lua_isstring(lua_state, -1), 2, \"accessing __index must be done with a string\");\n\n");
+        out.append("        luaL_argcheck(lua_state, lua_isstring(lua_state, -1), 2, \"accessing __index must be done with a string\");\n\n");
 
-        buffer.append("        auto index = std::string_view{lua_tostring(lua_state, -1)};\n");
-        buffer.append(std::format("        if (auto it = {}_{}_member_functions.find(index.data()); it != {}_{}_member_functions.end())\n", scope_as_function_name(fully_qualified_scope), name, scope_as_function_name(fully_qualified_scope), name));
-        buffer.append("        {\n");
-        buffer.append("            lua_pop(lua_state, 1);\n");
-        buffer.append("            lua_pushcfunction(lua_state, it->second);\n");
-        buffer.append("            return 1;\n");
-        buffer.append("        }\n\n");
+        out.append("        auto index = std::string_view{lua_tostring(lua_state, -1)};\n");
+        out.write("        if (auto it = {}_{}_member_functions.find(index.data()); it != {}_{}_member_functions.end())\n", scope_as_function_name(fully_qualified_scope), name, scope_as_function_name(fully_qualified_scope), name);
+        out.append("        {\n");
+        out.append("            lua_pop(lua_state, 1);\n");
+        out.append("            lua_pushcfunction(lua_state, it->second);\n");
+        out.append("            return 1;\n");
+        out.append("        }\n\n");
 
-        buffer.append(std::format("        auto [_, self] = internal_{}__{}_get_self<{}::{}*, false, false>(lua_state);\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
+        out.write("        auto [_, self] = internal_{}__{}_get_self<{}::{}*, false, false>(lua_state);\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name);
 
-        buffer.append(std::format("        if (!self) {{ luaL_error(lua_state, \"{} member accessed with self == nullptr\"); }};\n", name));
+        out.write("        if (!self) {{ luaL_error(lua_state, \"{} member accessed with self == nullptr\"); }};\n", name);
 
-        buffer.append(std::format("        auto index_it = {}_{}_metamethods.find(\"__index\");\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append(std::format("        if (index_it == {}_{}_metamethods.end()) {{ return 0; }}\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append("        return index_it->second(lua_state, self);\n");
+        out.write("        auto index_it = {}_{}_metamethods.find(\"__index\");\n", scope_as_function_name(fully_qualified_scope), name);
+        out.write("        if (index_it == {}_{}_metamethods.end()) {{ return 0; }}\n", scope_as_function_name(fully_qualified_scope), name);
+        out.append("        return index_it->second(lua_state, self);\n");
 
-        buffer.append("    }, 0);\n");
-        buffer.append("    lua_rawset(lua_state, -3);\n\n");
+        out.append("    }, 0);\n");
+        out.append("    lua_rawset(lua_state, -3);\n\n");
 
         for (const auto& metamethod_name : s_valid_metamethod_names)
         {
@@ -1439,30 +1764,30 @@ namespace RC::LuaWrapperGenerator
                 //buffer.append(std::format("    lua_pushcfunction(lua_state, &{});\n", metamethod_impl->get_wrapper_name()));
                 //buffer.append("    lua_rawset(lua_state, -3);\n\n");
 
-                buffer.append(std::format("    lua_pushliteral(lua_state, \"{}\");\n", metamethod_impl->get_name()));
-                buffer.append("    lua_pushcclosure(lua_state, [](lua_State* lua_state) -> int {\n");
-                buffer.append("        if (!lua_isuserdata(lua_state, 1))\n");
-                buffer.append("        {\n");
-                buffer.append("                lua_remove(lua_state, 1);\n");
-                buffer.append(std::format("                luaL_error(lua_state, \"metamethod '{}' for '{}' accessed without self context\");\n", metamethod_impl->get_name(), name));
-                buffer.append("        }\n\n");
+                out.write("    lua_pushliteral(lua_state, \"{}\");\n", metamethod_impl->get_name());
+                out.append("    lua_pushcclosure(lua_state, [](lua_State* lua_state) -> int {\n");
+                out.append("        if (!lua_isuserdata(lua_state, 1))\n");
+                out.append("        {\n");
+                out.append("                lua_remove(lua_state, 1);\n");
+                out.write("                luaL_error(lua_state, \"metamethod '{}' for '{}' accessed without self context\");\n", metamethod_impl->get_name(), name);
+                out.append("        }\n\n");
 
-                buffer.append(std::format("        auto [_, self] = internal_{}__{}_get_self<{}::{}*, false, false>(lua_state);\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name));
+                out.write("        auto [_, self] = internal_{}__{}_get_self<{}::{}*, false, false>(lua_state);\n", scope_as_function_name(fully_qualified_scope), name, fully_qualified_scope, name);
 
-                buffer.append(std::format("        if (!self) {{ luaL_error(lua_state, \"{} member accessed with self == nullptr\"); }};\n", name));
+                out.write("        if (!self) {{ luaL_error(lua_state, \"{} member accessed with self == nullptr\"); }};\n", name);
 
-                buffer.append(std::format("        auto it = {}_{}_metamethods.find(\"{}\");\n", scope_as_function_name(fully_qualified_scope), name, metamethod_impl->get_name()));
-                buffer.append(std::format("        if (it == {}_{}_metamethods.end()) {{ return 0; }}\n", scope_as_function_name(fully_qualified_scope), name));
-                buffer.append("        return it->second(lua_state, self);\n");
+                out.write("        auto it = {}_{}_metamethods.find(\"{}\");\n", scope_as_function_name(fully_qualified_scope), name, metamethod_impl->get_name());
+                out.write("        if (it == {}_{}_metamethods.end()) {{ return 0; }}\n", scope_as_function_name(fully_qualified_scope), name);
+                out.append("        return it->second(lua_state, self);\n");
 
-                buffer.append("    }, 0);\n");
-                buffer.append("    lua_rawset(lua_state, -3);\n\n");
+                out.append("    }, 0);\n");
+                out.append("    lua_rawset(lua_state, -3);\n\n");
             }
         }
 
-        buffer.append("    // Remove table from the stack now that we're done with it.\n");
-        buffer.append("    lua_remove(lua_state, -1);\n");
-        buffer.append("    // Metatable For Userdata -> END\n\n");
+        out.append("    // Remove table from the stack now that we're done with it.\n");
+        out.append("    lua_remove(lua_state, -1);\n");
+        out.append("    // Metatable For Userdata -> END\n\n");
 
         std::vector<std::string> scope_parts{};
         auto fully_qualified_scope = scope_override.empty() ? this->fully_qualified_scope : scope_override;
@@ -1470,9 +1795,9 @@ namespace RC::LuaWrapperGenerator
 
         if (scope_parts.empty())
         {
-            buffer.append("    // Scopes -> START\n");
-            buffer.append("    lua_newtable(lua_state);\n");
-            buffer.append(std::format("    lua_setglobal(lua_state, \"{}\");\n", name));
+            out.append("    // Scopes -> START\n");
+            out.append("    lua_newtable(lua_state);\n");
+            out.write("    lua_setglobal(lua_state, \"{}\");\n", name);
         }
         else
         {
@@ -1484,100 +1809,94 @@ namespace RC::LuaWrapperGenerator
                 // Remove the first scope which always becomes the global table.
                 scope_parts.erase(scope_parts.begin());
 
-                buffer.append("    // Scopes -> START\n");
-                buffer.append(std::format("    bool global_table_exists = lua_getglobal(lua_state, \"{}\") == LUA_TTABLE;\n", global_table_name));
-                buffer.append("    if (!global_table_exists)\n");
-                buffer.append("    {\n");
-                buffer.append("        lua_pop(lua_state, 1);\n");
-                buffer.append("        lua_newtable(lua_state);\n");
-                buffer.append("    }\n\n");
+                out.append("    // Scopes -> START\n");
+                out.write("    bool global_table_exists = lua_getglobal(lua_state, \"{}\") == LUA_TTABLE;\n", global_table_name);
+                out.append("    if (!global_table_exists)\n");
+                out.append("    {\n");
+                out.append("        lua_pop(lua_state, 1);\n");
+                out.append("        lua_newtable(lua_state);\n");
+                out.append("    }\n\n");
 
                 for (const auto& scope_part : scope_parts)
                 {
-                    buffer.append(std::format("    lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-                    buffer.append("    if (lua_rawget(lua_state, -2) != LUA_TTABLE)\n");
-                    buffer.append("    {\n");
-                    buffer.append("        lua_pop(lua_state, 1);\n");
-                    buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-                    buffer.append("        lua_newtable(lua_state);\n");
-                    buffer.append("        lua_rawset(lua_state, -3);\n");
-                    buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-                    buffer.append("        lua_rawget(lua_state, -2);\n");
-                    buffer.append("    }\n\n");
+                    out.write("    lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+                    out.append("    if (lua_rawget(lua_state, -2) != LUA_TTABLE)\n");
+                    out.append("    {\n");
+                    out.append("        lua_pop(lua_state, 1);\n");
+                    out.write("        lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+                    out.append("        lua_newtable(lua_state);\n");
+                    out.append("        lua_rawset(lua_state, -3);\n");
+                    out.write("        lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+                    out.append("        lua_rawget(lua_state, -2);\n");
+                    out.append("    }\n\n");
                 }
-                buffer.append(std::format("    lua_pushliteral(lua_state, \"{}\");\n", name));
+                out.write("    lua_pushliteral(lua_state, \"{}\");\n", name);
             }
 
-            buffer.append("    lua_newtable(lua_state);\n\n");
+            out.append("    lua_newtable(lua_state);\n\n");
 
-            for (const auto&[_, static_function] : static_functions)
+            for (const auto&[_, static_function] : sorted_by_key(static_functions))
             {
-                buffer.append(std::format("    lua_pushliteral(lua_state, \"{}\");\n", static_function.get_name()));
+                out.write("    lua_pushliteral(lua_state, \"{}\");\n", static_function.get_name());
                 if (static_function.is_custom_redirector())
                 {
-                    buffer.append(std::format("    lua_pushcfunction(lua_state, &{});\n", static_function.get_wrapper_name()));
+                    out.write("    lua_pushcfunction(lua_state, &{});\n", static_function.get_wrapper_name());
                 }
                 else
                 {
-                    buffer.append(std::format("    lua_pushcfunction(lua_state, &{}_{}_member_function_wrapper_{});\n", scope_as_function_name(static_function.get_containing_class()->fully_qualified_scope), static_function.get_containing_class()->name, static_function.get_name()));
+                    out.write("    lua_pushcfunction(lua_state, &{}_{}_member_function_wrapper_{});\n", scope_as_function_name(static_function.get_containing_class()->fully_qualified_scope), static_function.get_containing_class()->name, static_function.get_name());
                 }
 
-                buffer.append("    lua_rawset(lua_state, -3);\n\n");
+                out.append("    lua_rawset(lua_state, -3);\n\n");
             }
 
             if (constructors.contains(fully_qualified_scope + "::" + name + "::" + name))
             {
-                buffer.append("    // Metatable For Table -> START\n");
-                buffer.append(std::format("    lua_setup_{}_{}_constructor_dispatch(lua_state);\n", scope_as_function_name(fully_qualified_scope), name));
-                buffer.append("    // Metatable For Table -> END\n\n");
+                out.append("    // Metatable For Table -> START\n");
+                out.write("    lua_setup_{}_{}_constructor_dispatch(lua_state);\n", scope_as_function_name(fully_qualified_scope), name);
+                out.append("    // Metatable For Table -> END\n\n");
             }
 
             if (!put_in_global_table)
             {
-                buffer.append("    lua_rawset(lua_state, -3);\n");
+                out.append("    lua_rawset(lua_state, -3);\n");
 
                 if (!scope_parts.empty())
                 {
                     //buffer.append("    lua_pop(lua_state, 1);\n");
-                    buffer.append(std::format("    lua_pop(lua_state, {});\n", scope_parts.size()));
+                    out.write("    lua_pop(lua_state, {});\n", scope_parts.size());
                 }
-                buffer.append("\n    if (global_table_exists)\n");
-                buffer.append("    {\n");
-                buffer.append("        lua_pop(lua_state, 1);\n");
-                buffer.append("    }\n");
-                buffer.append("    else\n");
-                buffer.append("    {\n");
-                buffer.append(std::format("        lua_setglobal(lua_state, \"{}\");\n", global_table_name));
-                buffer.append("    }\n");
+                out.append("\n    if (global_table_exists)\n");
+                out.append("    {\n");
+                out.append("        lua_pop(lua_state, 1);\n");
+                out.append("    }\n");
+                out.append("    else\n");
+                out.append("    {\n");
+                out.write("        lua_setglobal(lua_state, \"{}\");\n", global_table_name);
+                out.append("    }\n");
             }
             else
             {
-                buffer.append(std::format("    lua_setglobal(lua_state, \"{}\");\n", name));
+                out.write("    lua_setglobal(lua_state, \"{}\");\n", name);
             }
         }
 
-        buffer.append("    // Scopes -> END\n");
-
-        buffer.append("}\n");
+        out.append("    // Scopes -> END\n");
 
-        return buffer;
+        out.append("}\n");
     }
 
-    auto Class::generate_create_instance_of_function() const -> std::string
+    auto Class::generate_create_instance_of_function(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append(std::format("auto lua_create_instance_of_{}(lua_State* lua_state) -> void\n{{\n", name));
-
-        buffer.append(std::format("    auto* userdata = static_cast<{}::{}*>(lua_newuserdatauv(lua_state, sizeof({}::{}), 0));\n", fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name));
-        buffer.append(std::format("    new(userdata) {}::{}{{}};\n\n", fully_qualified_scope, name));
+        out.write("auto lua_create_instance_of_{}(lua_State* lua_state) -> void\n{{\n", name);
 
-        buffer.append(std::format("    luaL_getmetatable(lua_state, \"{}_{}Metatable\");\n", fully_qualified_scope, name));
-        buffer.append("    lua_setmetatable(lua_state, -2);\n");
+        out.write("    auto* userdata = static_cast<{}::{}*>(lua_newuserdatauv(lua_state, sizeof({}::{}), 0));\n", fully_qualified_scope, name, scope_as_function_name(fully_qualified_scope), name);
+        out.write("    new(userdata) {}::{}{{}};\n\n", fully_qualified_scope, name);
 
-        buffer.append("}\n");
+        out.write("    luaL_getmetatable(lua_state, \"{}_{}Metatable\");\n", fully_qualified_scope, name);
+        out.append("    lua_setmetatable(lua_state, -2);\n");
 
-        return buffer;
+        out.append("}\n");
     }
 
     //auto Class::generate_lua_wrapper_function_body_prologue() const -> std::string
@@ -1606,68 +1925,64 @@ namespace RC::LuaWrapperGenerator
     //    return buffer;
     //}
 
-    auto Class::generate_internal_get_self_function() const -> std::string
+    auto Class::generate_internal_get_self_function(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append(std::format("template<typename ReturnType = {}::{}*, bool return_container_or_nullptr = false, bool pop_userdata = true>\n", fully_qualified_scope, name));
-        buffer.append(std::format("inline auto internal_{}__{}_get_self(lua_State* lua_state) -> std::pair<bool, ReturnType>\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append("{\n");
+        out.write("template<typename ReturnType = {}::{}*, bool return_container_or_nullptr = false, bool pop_userdata = true>\n", fully_qualified_scope, name);
+        out.write("inline auto internal_{}__{}_get_self(lua_State* lua_state) -> std::pair<bool, ReturnType>\n", scope_as_function_name(fully_qualified_scope), name);
+        out.append("{\n");
         //buffer.append(std::format("    {}\n", generate_lua_wrapper_function_body_prologue()));
-        buffer.append(std::format("    luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param was not userdata of type '{}'\");\n", name));
-
-        buffer.append("    lua_getiuservalue(lua_state, 1, 1);\n");
-        buffer.append("    int pointer_depth = lua_tointeger(lua_state, -1);\n");
-        buffer.append("    bool is_pointer = pointer_depth > 0;\n");
-
-        buffer.append("    lua_getmetatable(lua_state, 1);\n");
-        buffer.append("    lua_pushliteral(lua_state, \"__name\");\n");
-        buffer.append("    lua_rawget(lua_state, -2);\n");
-        buffer.append("    auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
-        buffer.append(std::format("    auto bad_self_error_message = std::format(\"self was '{{}}', expected '{}_{}Metatable' or derivative\", metatable_name);\n", scope_as_function_name(fully_qualified_scope), name));
-        buffer.append(std::format("    luaL_argcheck(lua_state, convertible_to_{}_{}.contains(metatable_name), 1, bad_self_error_message.c_str());\n", scope_as_function_name(fully_qualified_scope), name));
-
-        buffer.append("    lua_pop(lua_state, 3);\n");
-
-        buffer.append(std::format("    {}::{}** self_container{{}};\n", fully_qualified_scope, name));
-        buffer.append(std::format("    {}::{}* self{{}};\n", fully_qualified_scope, name));
-        buffer.append(std::format("    if (is_pointer)\n    {{\n"));
-        buffer.append("        auto* outer_most_container = lua_touserdata(lua_state, 1);\n");
-        buffer.append("        if (outer_most_container)\n");
-        buffer.append("        {\n");
-        buffer.append(std::format("            self_container = static_cast<{}::{}**>(deref(outer_most_container, pointer_depth - 1));\n", fully_qualified_scope, name));
-        buffer.append("            if (self_container) { self = *self_container; }\n");
-        buffer.append("        }\n");
-        buffer.append(std::format("    }}\n    else\n    {{\n"));
-        buffer.append(std::format("        self = static_cast<{}::{}*>(lua_touserdata(lua_state, 1));\n", fully_qualified_scope, name));
-        buffer.append(std::format("    }}\n"));
-        buffer.append("    if constexpr (pop_userdata)\n");
-        buffer.append("    {\n");
-        buffer.append("        lua_remove(lua_state, 1);\n");
-        buffer.append("    }\n");
-
-        buffer.append("    if constexpr (return_container_or_nullptr)\n");
-        buffer.append("    {\n");
-        buffer.append("        if (is_pointer)\n");
-        buffer.append("        {\n");
-        buffer.append("            return {is_pointer, self_container};\n");
-        buffer.append("        }\n");
-        buffer.append("        else\n");
-        buffer.append("        {\n");
+        out.write("    luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param was not userdata of type '{}'\");\n", name);
+
+        out.append("    lua_getiuservalue(lua_state, 1, 1);\n");
+        out.append("    int pointer_depth = lua_tointeger(lua_state, -1);\n");
+        out.append("    bool is_pointer = pointer_depth > 0;\n");
+
+        out.append("    lua_getmetatable(lua_state, 1);\n");
+        out.append("    lua_pushliteral(lua_state, \"__name\");\n");
+        out.append("    lua_rawget(lua_state, -2);\n");
+        out.append("    auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
+        out.write("    auto bad_self_error_message = std::format(\"self was '{{}}', expected '{}_{}Metatable' or derivative\", metatable_name);\n", scope_as_function_name(fully_qualified_scope), name);
+        out.write("    luaL_argcheck(lua_state, convertible_to_{}_{}.contains(metatable_name), 1, bad_self_error_message.c_str());\n", scope_as_function_name(fully_qualified_scope), name);
+
+        out.append("    lua_pop(lua_state, 3);\n");
+
+        out.write("    {}::{}** self_container{{}};\n", fully_qualified_scope, name);
+        out.write("    {}::{}* self{{}};\n", fully_qualified_scope, name);
+        out.write("    if (is_pointer)\n    {{\n");
+        out.append("        auto* outer_most_container = lua_touserdata(lua_state, 1);\n");
+        out.append("        if (outer_most_container)\n");
+        out.append("        {\n");
+        out.write("            self_container = static_cast<{}::{}**>(deref(outer_most_container, pointer_depth - 1));\n", fully_qualified_scope, name);
+        out.append("            if (self_container) { self = *self_container; }\n");
+        out.append("        }\n");
+        out.write("    }}\n    else\n    {{\n");
+        out.write("        self = static_cast<{}::{}*>(lua_touserdata(lua_state, 1));\n", fully_qualified_scope, name);
+        out.write("    }}\n");
+        out.append("    if constexpr (pop_userdata)\n");
+        out.append("    {\n");
+        out.append("        lua_remove(lua_state, 1);\n");
+        out.append("    }\n");
+
+        out.append("    if constexpr (return_container_or_nullptr)\n");
+        out.append("    {\n");
+        out.append("        if (is_pointer)\n");
+        out.append("        {\n");
+        out.append("            return {is_pointer, self_container};\n");
+        out.append("        }\n");
+        out.append("        else\n");
+        out.append("        {\n");
         // This bit_cast is safe only when the caller checks 'is_pointer' before usage.
-        buffer.append("            luaL_argcheck(lua_state, self, 1, \"self was nullptr\");\n");
-        buffer.append("            return {is_pointer, std::bit_cast<ReturnType>(self)};\n");
-        buffer.append("        }\n");
-        buffer.append("    }\n");
-        buffer.append("    else\n");
-        buffer.append("    {\n");
-        buffer.append(std::format("        luaL_argcheck(lua_state, self, 1, \"self was nullptr\");\n"));
-        buffer.append("        return {is_pointer, self};\n");
-        buffer.append("    }\n");
-
-        buffer.append("}");
+        out.append("            luaL_argcheck(lua_state, self, 1, \"self was nullptr\");\n");
+        out.append("            return {is_pointer, std::bit_cast<ReturnType>(self)};\n");
+        out.append("        }\n");
+        out.append("    }\n");
+        out.append("    else\n");
+        out.append("    {\n");
+        out.write("        luaL_argcheck(lua_state, self, 1, \"self was nullptr\");\n");
+        out.append("        return {is_pointer, self};\n");
+        out.append("    }\n");
 
-        return buffer;
+        out.append("}");
     }
 
     auto Enum::add_key_value_pair(std::string key, uint64_t value) -> void
@@ -1675,48 +1990,40 @@ namespace RC::LuaWrapperGenerator
         m_keys_and_values.emplace_back(std::move(key), value);
     }
 
-    auto Function::generate_lua_wrapper_function_body() const -> std::string
+    auto Function::generate_lua_wrapper_function_body(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-
-        buffer.append("    try\n    {\n");
+        out.append("    try\n    {\n");
 
         if (get_containing_class() && !is_static())
         {
-            buffer.append("        // Prologue\n");
-            buffer.append(std::format("        auto [_, self] = internal_{}_get_self(lua_state);\n\n", scope_as_function_name(get_fully_qualified_scope())));
+            out.append("        // Prologue\n");
+            out.write("        auto [_, self] = internal_{}_get_self(lua_state);\n\n", scope_as_function_name(get_fully_qualified_scope()));
         }
 
-        buffer.append("        // Native call\n");
-        buffer.append(generate_cxx_call(*this));
-        buffer.append(generate_lua_return_statement());
-        buffer.append("\n");
-        buffer.append("    }\n");
-        buffer.append("    catch (std::exception& e)\n");
-        buffer.append("    {\n");
-        buffer.append("        luaL_error(lua_state, e.what());\n");
-        buffer.append("        return 0;\n");
-        buffer.append("    }\n");
-        buffer.append("\n");
-
-        return buffer;
+        out.append("        // Native call\n");
+        generate_cxx_call(out, *this);
+        generate_lua_return_statement(out);
+        out.append("\n");
+        out.append("    }\n");
+        out.append("    catch (std::exception& e)\n");
+        out.append("    {\n");
+        out.append("        luaL_error(lua_state, e.what());\n");
+        out.append("        return 0;\n");
+        out.append("    }\n");
+        out.append("\n");
     }
 
-    auto Function::generate_lua_return_statement() const -> std::string
+    auto Function::generate_lua_return_statement(CodeWriter& out) const -> void
     {
         if (get_return_type()->is_a<Type::Void>() && !get_return_type()->is_pointer())
         {
-            return "        return 0;";
+            out.append("        return 0;");
         }
         else
         {
-            std::string buffer{};
-
-            buffer.append(std::format("{}", get_return_type()->generate_lua_stack_pusher("return_value", "")));
+            out.append(get_return_type()->generate_lua_stack_pusher("return_value", ""));
             // TODO: We don't support multiple return values.
-            buffer.append(";\n        return 1;");
-
-            return buffer;
+            out.append(";\n        return 1;");
         }
     }
 
@@ -1730,22 +2037,23 @@ namespace RC::LuaWrapperGenerator
         return add_class_to_container(class_name, m_container.thin_classes, full_path_to_file, fully_qualified_scope);
     }
 
-    auto CodeGenerator::generate_setup_functions_map() const -> std::string
+    auto CodeGenerator::generate_setup_functions_map(CodeWriter& out) const -> void
     {
-        std::string buffer{"static std::unordered_map<std::string, void (*)(lua_State*)> s_state_setup_functions{\n"};
+        Trace::Span span{"generate_setup_functions_map"};
+        out.append("static std::unordered_map<std::string, void (*)(lua_State*)> s_state_setup_functions{\n");
 
-        for (const auto& lua_state_type : m_container.lua_state_types)
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
         {
-            buffer.append(std::format("    {{\"{}\", &lua_setup_state_{}}},\n", lua_state_type, lua_state_type));
+            out.write("    {{\"{}\", &lua_setup_state_{}}},\n", lua_state_type, lua_state_type);
         }
 
-        buffer.append("};\n");
-        return buffer;
+        out.append("};\n");
     }
 
-    auto CodeGenerator::generate_lua_dynamic_setup_state_function() const -> std::string
+    auto CodeGenerator::generate_lua_dynamic_setup_state_function(CodeWriter& out) const -> void
     {
-        return {R"(auto lua_setup_state(lua_State* lua_state, const std::string& state_name) -> void
+        Trace::Span span{"generate_lua_dynamic_setup_state_function"};
+        out.append(R"(auto lua_setup_state(lua_State* lua_state, const std::string& state_name) -> void
 {
     if (auto it = s_state_setup_functions.find(state_name); it != s_state_setup_functions.end())
     {
@@ -1755,285 +2063,279 @@ namespace RC::LuaWrapperGenerator
     {
         luaL_error(lua_state, std::format("Was unable to find lua state type '{}'", state_name).c_str());
     }
-})"};
-    }
-
-    static auto generate_function_proto_metatable() -> std::string
-    {
-        std::string buffer{};
-        buffer.append("auto inline setup_FunctionProto(lua_State* lua_state) -> void\n");
-        buffer.append("{\n");
-        buffer.append("    luaL_newmetatable(lua_state, \"FunctionProtoMetatable\");\n");
-        buffer.append("    lua_pushliteral(lua_state, \"__call\");\n");
-        buffer.append("    lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
-        buffer.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
-        buffer.append("        lua_getmetatable(lua_state, 1);\n");
-        buffer.append("        lua_pushliteral(lua_state, \"__name\");\n");
-        buffer.append("        lua_rawget(lua_state, -2);\n");
-        buffer.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
-        buffer.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
-        buffer.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
-        buffer.append("        lua_pop(lua_state, 2);\n");
-        buffer.append("        return function_proto->lua_wrapper_function_function_pointer(lua_state);\n");
-        buffer.append("    });\n");
-        buffer.append("    lua_rawset(lua_state, -3);\n");
-        buffer.append("    lua_pushliteral(lua_state, \"__index\");\n");
-        buffer.append("    lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
-        buffer.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
-        buffer.append("        lua_getmetatable(lua_state, 1);\n");
-        buffer.append("        lua_pushliteral(lua_state, \"__name\");\n");
-        buffer.append("        lua_rawget(lua_state, -2);\n");
-        buffer.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
-        buffer.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
-        buffer.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
-        buffer.append("        lua_pop(lua_state, 2);\n");
-        buffer.append("        lua_remove(lua_state, 1);\n");
-        buffer.append("        if (lua_isstring(lua_state, 1))\n");
-        buffer.append("        {\n");
-        buffer.append("            auto member_name = std::string{lua_tostring(lua_state, 1)};\n");
-        buffer.append("            if (member_name == \"GetFunctionAddress\")\n");
-        buffer.append("            {\n");
-        buffer.append("                lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
-        buffer.append("                    luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
-        buffer.append("                    lua_getmetatable(lua_state, 1);\n");
-        buffer.append("                    lua_pushliteral(lua_state, \"__name\");\n");
-        buffer.append("                    lua_rawget(lua_state, -2);\n");
-        buffer.append("                    auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
-        buffer.append("                    if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
-        buffer.append("                    auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
-        buffer.append("                    lua_pop(lua_state, 3);\n");
-        buffer.append("                    lua_pushinteger(lua_state, std::bit_cast<lua_Integer>(function_proto->function_pointer));\n");
-        buffer.append("                    return 1;\n");
-        buffer.append("                });\n");
-        buffer.append("                return 1;\n");
-        buffer.append("            }\n");
-        buffer.append("            else\n");
-        buffer.append("            {\n");
-        buffer.append("                return 0;\n");
-        buffer.append("            }\n");
-        buffer.append("        }\n");
-        buffer.append("        else\n");
-        buffer.append("        {\n");
-        buffer.append("            return 0;\n");
-        buffer.append("        }\n");
-        buffer.append("    });\n");
-        buffer.append("    lua_rawset(lua_state, -3);\n");
-        buffer.append("    lua_pop(lua_state, 1);\n");
-        buffer.append("}\n");
-        return buffer;
-    }
-
-    auto CodeGenerator::generate_lua_setup_state_functions() const -> std::string
-    {
-        std::string buffer{};
-
-        for (const auto& lua_state_type : m_container.lua_state_types)
-        {
-            buffer.append(std::format("inline auto lua_setup_state_{}(lua_State* lua_state) -> void\n", lua_state_type));
-            buffer.append("{\n");
-
-            buffer.append("setup_FunctionProto(lua_state);");
-
-            for (const auto&[_, the_class] : m_container.classes)
-            {
-                buffer.append(std::format("    lua_setup_{}_{}(lua_state);\n", scope_as_function_name(the_class.fully_qualified_scope), the_class.name));
-            }
-
-            buffer.append("\n");
-            buffer.append(std::format("    lua_setup_global_free_functions_{}(lua_state);\n", lua_state_type));
-            buffer.append(std::format("    lua_setup_enums_{}(lua_state);\n", lua_state_type));
+})");
+    }
+
+    static auto generate_function_proto_metatable(CodeWriter& out) -> void
+    {
+        out.append("auto inline setup_FunctionProto(lua_State* lua_state) -> void\n");
+        out.append("{\n");
+        out.append("    luaL_newmetatable(lua_state, \"FunctionProtoMetatable\");\n");
+        out.append("    lua_pushliteral(lua_state, \"__call\");\n");
+        out.append("    lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
+        out.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
+        out.append("        lua_getmetatable(lua_state, 1);\n");
+        out.append("        lua_pushliteral(lua_state, \"__name\");\n");
+        out.append("        lua_rawget(lua_state, -2);\n");
+        out.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
+        out.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
+        out.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
+        out.append("        lua_pop(lua_state, 2);\n");
+        out.append("        return function_proto->lua_wrapper_function_function_pointer(lua_state);\n");
+        out.append("    });\n");
+        out.append("    lua_rawset(lua_state, -3);\n");
+        out.append("    lua_pushliteral(lua_state, \"__index\");\n");
+        out.append("    lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
+        out.append("        luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
+        out.append("        lua_getmetatable(lua_state, 1);\n");
+        out.append("        lua_pushliteral(lua_state, \"__name\");\n");
+        out.append("        lua_rawget(lua_state, -2);\n");
+        out.append("        auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
+        out.append("        if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
+        out.append("        auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
+        out.append("        lua_pop(lua_state, 2);\n");
+        out.append("        lua_remove(lua_state, 1);\n");
+        out.append("        if (lua_isstring(lua_state, 1))\n");
+        out.append("        {\n");
+        out.append("            auto member_name = std::string{lua_tostring(lua_state, 1)};\n");
+        out.append("            if (member_name == \"GetFunctionAddress\")\n");
+        out.append("            {\n");
+        out.append("                lua_pushcfunction(lua_state, [](lua_State* lua_state) -> int {\n");
+        out.append("                    luaL_argcheck(lua_state, lua_isuserdata(lua_state, 1), 1, \"first param for 'FunctionProto' was not userdata\");\n");
+        out.append("                    lua_getmetatable(lua_state, 1);\n");
+        out.append("                    lua_pushliteral(lua_state, \"__name\");\n");
+        out.append("                    lua_rawget(lua_state, -2);\n");
+        out.append("                    auto metatable_name = std::string{lua_tostring(lua_state, -1)};\n");
+        out.append("                    if (metatable_name != \"FunctionProtoMetatable\") { luaL_error(lua_state, \"self was '{}', expected FunctionProtoMetatable\"); }\n");
+        out.append("                    auto function_proto = static_cast<FunctionProto*>(lua_touserdata(lua_state, 1));\n");
+        out.append("                    lua_pop(lua_state, 3);\n");
+        out.append("                    lua_pushinteger(lua_state, std::bit_cast<lua_Integer>(function_proto->function_pointer));\n");
+        out.append("                    return 1;\n");
+        out.append("                });\n");
+        out.append("                return 1;\n");
+        out.append("            }\n");
+        out.append("            else\n");
+        out.append("            {\n");
+        out.append("                return 0;\n");
+        out.append("            }\n");
+        out.append("        }\n");
+        out.append("        else\n");
+        out.append("        {\n");
+        out.append("            return 0;\n");
+        out.append("        }\n");
+        out.append("    });\n");
+        out.append("    lua_rawset(lua_state, -3);\n");
+        out.append("    lua_pop(lua_state, 1);\n");
+        out.append("}\n");
+    }
+
+    auto CodeGenerator::generate_lua_setup_state_functions(CodeWriter& out) const -> void
+    {
+        Trace::Span span{"generate_lua_setup_state_functions"};
+
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
+        {
+            out.write("inline auto lua_setup_state_{}(lua_State* lua_state) -> void\n", lua_state_type);
+            out.append("{\n");
+
+            out.append("setup_FunctionProto(lua_state);");
+
+            for (const auto&[_, the_class] : sorted_by_key(m_container.classes))
+            {
+                out.write("    lua_setup_{}_{}(lua_state);\n", scope_as_function_name(the_class.fully_qualified_scope), the_class.name);
+            }
+
+            out.append("\n");
+            out.write("    lua_setup_global_free_functions_{}(lua_state);\n", lua_state_type);
+            out.write("    lua_setup_enums_{}(lua_state);\n", lua_state_type);
 
             for (const auto& type_patch : m_type_patches)
             {
-                buffer.append(type_patch.generate_lua_setup_state_function_post());
+                out.append(type_patch.generate_lua_setup_state_function_post());
             }
 
-            buffer.append("}\n\n");
+            out.append("}\n\n");
         }
 
-        return buffer;
     }
 
-    auto CodeGenerator::generate_lua_setup_file() const -> void
+    auto CodeGenerator::generate_lua_setup_file(OutputManifest& output_manifest) const -> void
     {
-        auto file = File::open(m_output_path / "include/LuaBindings/LuaSetup.hpp", File::OpenFor::Writing, File::OverwriteExistingFile::Yes, File::CreateIfNonExistent::Yes);
-
-        std::string file_contents = "#ifndef LUAWRAPPERGENERATOR_LUASETUP_HPP\n#define LUAWRAPPERGENERATOR_LUASETUP_HPP\n\n";
+        Trace::Span span{"generate_lua_setup_file"};
+        CodeWriter file_contents{};
+        file_contents.append("#ifndef LUAWRAPPERGENERATOR_LUASETUP_HPP\n#define LUAWRAPPERGENERATOR_LUASETUP_HPP\n\n");
 
         file_contents.append("#include <atomic>\n");
         file_contents.append("#include <format>\n");
         file_contents.append("#include <functional>\n");
         file_contents.append("\n");
 
-        for (const auto& lua_state_type : m_container.lua_state_types)
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
         {
-            file_contents.append(std::format("#include <LuaBindings/States/{}/Main.hpp>\n", lua_state_type));
+            file_contents.write("#include <LuaBindings/States/{}/Main.hpp>\n", lua_state_type);
         }
 
         file_contents.append("\nnamespace RC::LuaBindings\n{\n");
-        file_contents.append(generate_setup_functions_map());
+        generate_setup_functions_map(file_contents);
         file_contents.append("\n");
-        file_contents.append(generate_lua_dynamic_setup_state_function());
+        generate_lua_dynamic_setup_state_function(file_contents);
         file_contents.append("\n} // RC::LuaBindings\n\n#endif //LUAWRAPPERGENERATOR_LUASETUP_HPP\n");
 
-        file.write_string_to_file(File::StringType{file_contents.begin(), file_contents.end()});
-        file.close();
+        output_manifest.write_file("include/LuaBindings/LuaSetup.hpp", file_contents.get());
     }
 
-    auto CodeGenerator::generate_free_functions() const -> std::string
+    auto CodeGenerator::generate_free_functions(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-        for (const auto&[_, free_function] : m_container.functions)
+        Trace::Span span{"generate_free_functions"};
+        for (const auto&[_, free_function] : sorted_by_key(m_container.functions))
         {
             if (free_function.is_custom_redirector()) { continue; }
             if (free_function.is_alias()) { continue; }
             if (!free_function.get_wrapper_name().empty()) { continue; }
 
-            buffer.append(std::format("inline auto lua_{}_wrapper(lua_State* lua_state) -> int\n{{\n", free_function.get_name()));
+            out.write("inline auto lua_{}_wrapper(lua_State* lua_state) -> int\n{{\n", free_function.get_name());
             //buffer.append(std::format("    \n", free_function.get_name()));
-            buffer.append(free_function.generate_lua_wrapper_function_body());
-            buffer.append("}\n");
+            free_function.generate_lua_wrapper_function_body(out);
+            out.append("}\n");
         }
-        return buffer;
     }
 
-    static auto resolve_to_scope(std::vector<std::string>& scope_parts, std::string& buffer, auto callable) -> void
+    static auto resolve_to_scope(std::vector<std::string>& scope_parts, CodeWriter& out, auto callable) -> void
     {
         auto global_table_name = scope_parts[0];
 
         // Remove the first scope which always becomes the global table.
         scope_parts.erase(scope_parts.begin());
 
-        buffer.append(std::format("        bool global_table_exists = lua_getglobal(lua_state, \"{}\") == LUA_TTABLE;\n", global_table_name));
-        buffer.append("        if (!global_table_exists)\n");
-        buffer.append("        {\n");
-        buffer.append("            lua_newtable(lua_state);\n");
-        buffer.append("        }\n\n");
+        out.write("        bool global_table_exists = lua_getglobal(lua_state, \"{}\") == LUA_TTABLE;\n", global_table_name);
+        out.append("        if (!global_table_exists)\n");
+        out.append("        {\n");
+        out.append("            lua_newtable(lua_state);\n");
+        out.append("        }\n\n");
 
         for (const auto& scope_part : scope_parts)
         {
-            buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-            buffer.append("        if (lua_rawget(lua_state, -2) != LUA_TTABLE)\n");
-            buffer.append("        {\n");
-            buffer.append(std::format("            lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-            buffer.append("            lua_newtable(lua_state);\n");
-            buffer.append("            lua_rawset(lua_state, -4);\n");
-            buffer.append(std::format("            lua_pushliteral(lua_state, \"{}\");\n", scope_part));
-            buffer.append("            lua_rawget(lua_state, -3);\n");
-            buffer.append("        }\n\n");
+            out.write("        lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+            out.append("        if (lua_rawget(lua_state, -2) != LUA_TTABLE)\n");
+            out.append("        {\n");
+            out.write("            lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+            out.append("            lua_newtable(lua_state);\n");
+            out.append("            lua_rawset(lua_state, -4);\n");
+            out.write("            lua_pushliteral(lua_state, \"{}\");\n", scope_part);
+            out.append("            lua_rawget(lua_state, -3);\n");
+            out.append("        }\n\n");
         }
 
         callable();
 
         if (!scope_parts.empty())
         {
-            buffer.append("        lua_pop(lua_state, 2);\n");
+            out.append("        lua_pop(lua_state, 2);\n");
         }
-        buffer.append("\n        if (!global_table_exists)\n");
-        buffer.append("        {\n");
-        buffer.append(std::format("            lua_setglobal(lua_state, \"{}\");\n", global_table_name));
-        buffer.append("        }\n");
-        buffer.append("        else\n");
-        buffer.append("        {\n");
-        buffer.append("            lua_pop(lua_state, 1);\n");
-        buffer.append("        }\n");
-
+        out.append("\n        if (!global_table_exists)\n");
+        out.append("        {\n");
+        out.write("            lua_setglobal(lua_state, \"{}\");\n", global_table_name);
+        out.append("        }\n");
+        out.append("        else\n");
+        out.append("        {\n");
+        out.append("            lua_pop(lua_state, 1);\n");
+        out.append("        }\n");
     }
 
-    auto CodeGenerator::generate_lua_setup_global_free_functions() const -> std::string
+    auto CodeGenerator::generate_lua_setup_global_free_functions(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-        for (const auto& lua_state_type : m_container.lua_state_types)
+        Trace::Span span{"generate_lua_setup_global_free_functions"};
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
         {
-            buffer.append(std::format("inline auto lua_setup_global_free_functions_{}(lua_State* lua_state) -> void\n{{\n", lua_state_type));
-            for (const auto&[_, free_function] : m_container.functions)
+            out.write("inline auto lua_setup_global_free_functions_{}(lua_State* lua_state) -> void\n{{\n", lua_state_type);
+            for (const auto&[_, free_function] : sorted_by_key(m_container.functions))
             {
                 auto fully_qualified_scope = free_function.get_scope_override().empty() ? free_function.get_fully_qualified_scope() : free_function.get_scope_override();
                 auto wrapper_function = free_function.get_wrapper_name().empty() ? std::format("lua_{}_wrapper", free_function.get_name()) : std::string{free_function.get_wrapper_name()};
 
-                buffer.append("    {\n");
+                out.append("    {\n");
 
                 if (fully_qualified_scope.empty() || fully_qualified_scope == "::")
                 {
-                    buffer.append(std::format("        lua_pushcfunction(lua_state, &{});\n", wrapper_function));
-                    buffer.append(std::format("        lua_setglobal(lua_state, \"{}\");\n", free_function.get_lua_name()));
+                    out.write("        lua_pushcfunction(lua_state, &{});\n", wrapper_function);
+                    out.write("        lua_setglobal(lua_state, \"{}\");\n", free_function.get_lua_name());
                 }
                 else
                 {
                     std::vector<std::string> scope_parts{};
                     get_scope_parts(fully_qualified_scope, scope_parts);
-                    resolve_to_scope(scope_parts, buffer, [&]() {
-                        buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", free_function.get_lua_name()));
-                        buffer.append(std::format("        lua_pushcfunction(lua_state, &{});\n", wrapper_function));
-                        buffer.append("        lua_rawset(lua_state, -3);\n");
+                    resolve_to_scope(scope_parts, out, [&]() {
+                        out.write("        lua_pushliteral(lua_state, \"{}\");\n", free_function.get_lua_name());
+                        out.write("        lua_pushcfunction(lua_state, &{});\n", wrapper_function);
+                        out.append("        lua_rawset(lua_state, -3);\n");
                     });
                 }
-                buffer.append("    }\n");
-                buffer.append("\n");
+                out.append("    }\n");
+                out.append("\n");
             }
-            buffer.append("}\n");
+            out.append("}\n");
         }
-        return buffer;
     }
 
-    auto CodeGenerator::generate_lua_setup_enums() const -> std::string
+    auto CodeGenerator::generate_lua_setup_enums(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-        for (const auto& lua_state_type : m_container.lua_state_types)
+        Trace::Span span{"generate_lua_setup_enums"};
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
         {
-            buffer.append(std::format("inline auto lua_setup_enums_{}(lua_State* lua_state) -> void\n{{\n", lua_state_type));
-            for (const auto&[_, the_enum] : m_container.enums)
+            out.write("inline auto lua_setup_enums_{}(lua_State* lua_state) -> void\n{{\n", lua_state_type);
+            for (const auto&[_, the_enum] : sorted_by_key(m_container.enums))
             {
                 auto fully_qualified_scope = the_enum.get_fully_qualified_scope();
 
-                buffer.append("    {\n");
+                out.append("    {\n");
 
                 if (fully_qualified_scope.empty() || fully_qualified_scope == "::")
                 {
                     //buffer.append(std::format("        lua_pushcfunction(lua_state, &{});\n", wrapper_function));
                     //buffer.append(std::format("        lua_setglobal(lua_state, \"{}\");\n", the_enum.get_name()));
 
-                    buffer.append("        lua_newtable(lua_state);\n");
+                    out.append("        lua_newtable(lua_state);\n");
                     for (const auto&[enum_key, enum_value] : the_enum.get_key_value_pairs())
                     {
-                        buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", enum_key));
-                        buffer.append(std::format("        lua_pushinteger(lua_state, {});\n", enum_value));
-                        buffer.append("lua_rawset(lua_state, -3);\n");
+                        out.write("        lua_pushliteral(lua_state, \"{}\");\n", enum_key);
+                        out.write("        lua_pushinteger(lua_state, {});\n", enum_value);
+                        out.append("lua_rawset(lua_state, -3);\n");
                     }
-                    buffer.append(std::format("        lua_setglobal(lua_state, \"{}\");\n", the_enum.get_name()));
+                    out.write("        lua_setglobal(lua_state, \"{}\");\n", the_enum.get_name());
                 }
                 else
                 {
                     std::vector<std::string> scope_parts{};
                     get_scope_parts(fully_qualified_scope, scope_parts);
-                    resolve_to_scope(scope_parts, buffer, [&]() {
+                    resolve_to_scope(scope_parts, out, [&]() {
                         //buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", the_enum.get_name()));
                         //buffer.append(std::format("        lua_pushcfunction(lua_state, &{});\n", wrapper_function));
                         //buffer.append("        lua_rawset(lua_state, -3);\n");
 
-                        buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", the_enum.get_name()));
-                        buffer.append("        lua_newtable(lua_state);\n");
+                        out.write("        lua_pushliteral(lua_state, \"{}\");\n", the_enum.get_name());
+                        out.append("        lua_newtable(lua_state);\n");
                         for (const auto&[enum_key, enum_value] : the_enum.get_key_value_pairs())
                         {
-                            buffer.append(std::format("        lua_pushliteral(lua_state, \"{}\");\n", enum_key));
-                            buffer.append(std::format("        lua_pushinteger(lua_state, {});\n", enum_value));
-                            buffer.append("        lua_rawset(lua_state, -3);\n");
+                            out.write("        lua_pushliteral(lua_state, \"{}\");\n", enum_key);
+                            out.write("        lua_pushinteger(lua_state, {});\n", enum_value);
+                            out.append("        lua_rawset(lua_state, -3);\n");
                         }
-                        buffer.append("        lua_rawset(lua_state, -3);\n");
+                        out.append("        lua_rawset(lua_state, -3);\n");
                     });
                 }
-                buffer.append("    }\n");
-                buffer.append("\n");
+                out.append("    }\n");
+                out.append("\n");
             }
-            buffer.append("}\n");
+            out.append("}\n");
         }
-        return buffer;
     }
 
-    auto CodeGenerator::generate_convertible_to_set() const -> std::string
+    auto CodeGenerator::generate_convertible_to_set(CodeWriter& out) const -> void
     {
-        std::string buffer{};
-        std::unordered_map<std::string, std::unordered_set<std::string>> class_buffer{};
+        Trace::Span span{"generate_convertible_to_set"};
+        auto size_before = out.size();
+        // Ordered so that the sets and their contents come out in the same order on every run.
+        std::map<std::string, std::set<std::string>> class_buffer{};
 
         for (const auto&[_, the_class] : m_container.classes)
         {
@@ -2047,34 +2349,32 @@ namespace RC::LuaWrapperGenerator
         // Generate 'set' for all types that have another type that inherits from it.
         for (const auto&[the_class, convertible_from_classes] : class_buffer)
         {
-            buffer.append(std::format("inline std::unordered_set<std::string> convertible_to_{} {{\n", the_class));
+            out.write("inline std::unordered_set<std::string> convertible_to_{} {{\n", the_class);
             for (const auto& convertible_from_class : convertible_from_classes)
             {
-                buffer.append(std::format("        {{\"{}Metatable\"}},\n", convertible_from_class));
+                out.write("        {{\"{}Metatable\"}},\n", convertible_from_class);
             }
-            buffer.append("};\n\n");
+            out.append("};\n\n");
         }
 
         // Generate empty 'set' for all types that are final.
-        for (const auto&[_, the_class] : m_container.classes)
+        for (const auto&[_, the_class] : sorted_by_key(m_container.classes))
         {
             if (!class_buffer.contains(scope_as_function_name(the_class.fully_qualified_scope) + "_" + the_class.name))
             {
-                buffer.append(std::format("    inline std::unordered_set<std::string> convertible_to_{}_{} {{ }};\n\n", scope_as_function_name(the_class.fully_qualified_scope), the_class.name));
+                out.write("    inline std::unordered_set<std::string> convertible_to_{}_{} {{ }};\n\n", scope_as_function_name(the_class.fully_qualified_scope), the_class.name);
             }
         }
 
         // Removing the last newlines that were appended by the loop.
         // This is because surrounding newlines is not local to this scope and should be taken care of by whatever function calls this function.
-        buffer.pop_back();
-        buffer.pop_back();
-
-        return buffer;
+        if (out.size() > size_before) { out.remove_suffix(2); }
     }
 
-    auto CodeGenerator::generate_builtin_to_lua_from_heap_functions() const -> std::string
+    auto CodeGenerator::generate_builtin_to_lua_from_heap_functions(CodeWriter& out) const -> void
     {
-        return R"(#define GenerateBuiltinToLuaFromHeapFunction(BuiltinType) \
+        Trace::Span span{"generate_builtin_to_lua_from_heap_functions"};
+        out.append(R"(#define GenerateBuiltinToLuaFromHeapFunction(BuiltinType) \
 inline auto lua_##BuiltinType##_to_lua_from_heap(lua_State* lua_state, void* item, uint32_t pointer_depth) -> void \
 { \
     auto* userdata = static_cast<BuiltinType*>(lua_newuserdatauv(lua_state, sizeof(BuiltinType*), 1)); \
@@ -2097,12 +2397,13 @@ inline auto lua_##BuiltinType##_to_lua_from_heap(lua_State* lua_state, void* ite
     GenerateBuiltinToLuaFromHeapFunction(double)
 #undef GenerateBuiltinToLuaFromHeapFunction
 
-)";
+)");
     }
 
-    auto CodeGenerator::generate_utility_member_functions() const -> std::string
+    auto CodeGenerator::generate_utility_member_functions(CodeWriter& out) const -> void
     {
-        return R"(inline auto deref(void* ptr, uint32_t num) -> void*
+        Trace::Span span{"generate_utility_member_functions"};
+        out.append(R"(inline auto deref(void* ptr, uint32_t num) -> void*
 {
     if (num == 0) { return ptr; }
     void* final_ptr{ptr};
@@ -2299,12 +2600,13 @@ inline auto lua_Userdata_to_lua_from_heap(lua_State* lua_state, std::conditional
     }
     luaL_getmetatable(lua_state, MetatableName.value);
     lua_setmetatable(lua_state, -2);
-})";
+})");
     }
 
-    auto CodeGenerator::generate_state_file_pre() const -> std::string
+    auto CodeGenerator::generate_state_file_pre(CodeWriter& out) const -> void
     {
-        return R"(// https://stackoverflow.com/a/45365798
+        Trace::Span span{"generate_state_file_pre"};
+        out.append(R"(// https://stackoverflow.com/a/45365798
 template<typename Callable>
 union storage
 {
@@ -2388,23 +2690,127 @@ struct FunctionProto
     void* function_pointer{};
     using LuaWrapperFunctionPointer = int(*)(lua_State*);
     LuaWrapperFunctionPointer lua_wrapper_function_function_pointer{};
-};)";
+};)");
+    }
+
+    auto CodeGenerator::set_num_jobs(size_t num_jobs) -> void
+    {
+        m_num_jobs = num_jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : num_jobs;
+    }
+
+    // Calls 'callable' once for every index below 'count', spread over 'num_workers' threads.
+    static auto for_each_index_in_parallel(size_t num_workers, size_t count, const std::function<void(size_t index)>& callable) -> void
+    {
+        if (num_workers <= 1)
+        {
+            for (size_t index = 0; index < count; ++index)
+            {
+                callable(index);
+            }
+            return;
+        }
+
+        // Indices are handed out one at a time because the amount of code per class varies a lot.
+        std::atomic<size_t> next_index{};
+        std::mutex exception_mutex{};
+        std::exception_ptr worker_exception{};
+        std::vector<std::thread> threads{};
+        for (size_t worker_index = 0; worker_index < num_workers; ++worker_index)
+        {
+            threads.emplace_back([&, worker_index] {
+                Trace::set_thread_name(std::format("Codegen worker {}", worker_index));
+                try
+                {
+                    for (auto index = next_index++; index < count; index = next_index++)
+                    {
+                        callable(index);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock{exception_mutex};
+                    if (!worker_exception) { worker_exception = std::current_exception(); }
+                    next_index = count;
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (worker_exception) { std::rethrow_exception(worker_exception); }
     }
 
-    auto CodeGenerator::generate_state_file() const -> void
+    auto CodeGenerator::generate_state_file(OutputManifest& output_manifest) const -> void
     {
-        for (const auto& lua_state_type : m_container.lua_state_types)
+        // The code for a class doesn't depend on the state so it's generated once, in parallel, and copied into every state file.
+        // Each class gets its own buffers, which are concatenated in container order so the output doesn't depend on the number of jobs.
+        std::vector<const Class*> classes{};
+        classes.reserve(m_container.classes.size());
+        for (const auto&[_, the_class] : sorted_by_key(m_container.classes))
         {
-            std::filesystem::path state_file = m_output_path / std::format("include/LuaBindings/States/{}/Main.hpp", lua_state_type);
-            auto file = File::open(m_output_path / state_file, File::OpenFor::Writing, File::OverwriteExistingFile::Yes, File::CreateIfNonExistent::Yes);
+            classes.emplace_back(&the_class);
+        }
 
-            std::string file_contents = std::format("#ifndef LUAWRAPPERGENERATOR_{}_MAIN_HPP\n#define LUAWRAPPERGENERATOR_{}_MAIN_HPP\n\n", lua_state_type, lua_state_type);
+        std::vector<CodeWriter> all_class_definitions(classes.size());
+        std::vector<CodeWriter> all_class_setups(classes.size());
+        {
+            auto num_workers = std::min(m_num_jobs, classes.size());
+            Trace::Span span{"generate_classes"};
+            for_each_index_in_parallel(num_workers, classes.size(), [&](size_t class_index) {
+                const auto& the_class = *classes[class_index];
+                {
+                    Trace::Span class_span{"generate_class", the_class.name};
+                    auto& class_definitions = all_class_definitions[class_index];
+                    // Classes without a constructor write nothing and don't get the separator either.
+                    the_class.generate_constructor(class_definitions);
+                    if (class_definitions.size() != 0)
+                    {
+                        class_definitions.append("\n\n");
+                    }
+                    the_class.generate_internal_get_self_function(class_definitions);
+                    class_definitions.append("\n\n");
+                    the_class.generate_member_functions(class_definitions);
+                    class_definitions.append("\n\n");
+                }
+                {
+                    Trace::Span class_span{"generate_class_setup", the_class.name};
+                    auto& class_setup = all_class_setups[class_index];
+                    the_class.generate_member_functions_map(class_setup);
+                    class_setup.append("\n");
+                    the_class.generate_metamethods_map(class_setup);
+                    class_setup.append("\n");
+                    the_class.generate_setup_function(class_setup);
+                    class_setup.append("\n");
+
+                    // This is commented out until I implement constructor support.
+                    // Right now, there's no support for them at all which means it's impossible to construct the object if it can't be default constructed.
+                    // I also don't have the possibility to check whether it can be default constructed either so for now we just can't generate this helper function.
+                    //the_class.generate_create_instance_of_function(class_setup);
+                    //class_setup.append("\n");
+
+                    class_setup.append("\n");
+                }
+            });
+        }
+
+        // Reused for every state so that each file after the first is written into an already large enough buffer.
+        CodeWriter file_contents{};
+        for (const auto& lua_state_type : sorted_values(m_container.lua_state_types))
+        {
+            Trace::Span span{"generate_state_file", lua_state_type};
+
+            file_contents.clear();
+            file_contents.write("#ifndef LUAWRAPPERGENERATOR_{}_MAIN_HPP\n#define LUAWRAPPERGENERATOR_{}_MAIN_HPP\n\n", lua_state_type, lua_state_type);
             file_contents.append("#include <string>\n");
             file_contents.append("#include <format>\n");
             file_contents.append("\n");
             file_contents.append("#include <lua.hpp>\n");
 
-            std::unordered_set<std::string> includes{};
+            // Sorted by path so the includes don't move around between runs.
+            std::set<std::string> includes{};
             for (const auto&[_, the_class] : m_container.classes)
             {
                 includes.emplace(the_class.full_path_to_file);
@@ -2426,16 +2832,16 @@ struct FunctionProto
 
             for (const auto& file_to_include : includes)
             {
-                file_contents.append(std::format("#include \"{}\"\n", file_to_include));
+                file_contents.write("#include \"{}\"\n", file_to_include);
             }
 
             file_contents.append("\nnamespace RC::LuaBindings\n{\n");
 
-            file_contents.append(generate_state_file_pre());
+            generate_state_file_pre(file_contents);
 
             file_contents.append("\n\n");
 
-            file_contents.append(generate_utility_member_functions());
+            generate_utility_member_functions(file_contents);
 
             file_contents.append("\n\n");
 
@@ -2455,68 +2861,49 @@ struct FunctionProto
                 file_contents.append("\n\n");
             }
 
-            file_contents.append(generate_convertible_to_set());
+            generate_convertible_to_set(file_contents);
 
             file_contents.append("\n\n");
 
-            file_contents.append(generate_function_proto_metatable());
+            generate_function_proto_metatable(file_contents);
 
-            for (const auto&[_, func_proto] : m_container.function_proto_container)
+            for (const auto&[_, func_proto] : sorted_by_key(m_container.function_proto_container))
             {
-                file_contents.append(func_proto->generate_lua_wrapper_function());
+                func_proto->generate_lua_wrapper_function(file_contents);
             }
 
             file_contents.append("\n\n");
 
-            for (const auto&[_, the_class] : m_container.classes)
+            for (const auto& class_definitions : all_class_definitions)
             {
-                if (auto constructor_contents = the_class.generate_constructor(); !constructor_contents.empty())
-                {
-                    file_contents.append(constructor_contents);
-                    file_contents.append("\n\n");
-                }
-                file_contents.append(the_class.generate_internal_get_self_function());
-                file_contents.append("\n\n");
-                file_contents.append(the_class.generate_member_functions());
-                file_contents.append("\n\n");
+                file_contents.append(class_definitions.get());
             }
 
 
-            for (const auto&[_, the_class] : m_container.classes)
+            for (const auto& class_setup : all_class_setups)
             {
-                file_contents.append(the_class.generate_member_functions_map());
-                file_contents.append("\n");
-                file_contents.append(the_class.generate_metamethods_map());
-                file_contents.append("\n");
-                file_contents.append(the_class.generate_setup_function());
-                file_contents.append("\n");
-
-                // This is commented out until I implement constructor support.
-                // Right now, there's no support for them at all which means it's impossible to construct the object if it can't be default constructed.
-                // I also don't have the possibility to check whether it can be default constructed either so for now we just can't generate this helper function.
-                //file_contents.append(the_class.generate_create_instance_of_function());
-                //file_contents.append("\n");
-
-                file_contents.append("\n");
+                file_contents.append(class_setup.get());
             }
 
-            file_contents.append(generate_builtin_to_lua_from_heap_functions());
+            generate_builtin_to_lua_from_heap_functions(file_contents);
 
-            file_contents.append(std::format("{}", generate_free_functions()));
-            file_contents.append(std::format("\n{}", generate_lua_setup_global_free_functions()));
-            file_contents.append(std::format("\n{}", generate_lua_setup_enums()));
+            generate_free_functions(file_contents);
+            file_contents.append("\n");
+            generate_lua_setup_global_free_functions(file_contents);
+            file_contents.append("\n");
+            generate_lua_setup_enums(file_contents);
 
-            file_contents.append(std::format("\n{}", generate_lua_setup_state_functions()));
+            file_contents.append("\n");
+            generate_lua_setup_state_functions(file_contents);
 
             for (const auto& type_patch : m_type_patches)
             {
                 file_contents.append(type_patch.generate_state_file_post(m_container));
             }
 
-            file_contents.append(std::format("}} // RC::LuaBindings\n\n#endif //LUAWRAPPERGENERATOR_{}_MAIN_HPP\n", lua_state_type));
+            file_contents.write("}} // RC::LuaBindings\n\n#endif //LUAWRAPPERGENERATOR_{}_MAIN_HPP\n", lua_state_type);
 
-            file.write_string_to_file(File::StringType{file_contents.begin(), file_contents.end()});
-            file.close();
+            output_manifest.write_file(std::format("include/LuaBindings/States/{}/Main.hpp", lua_state_type), file_contents.get());
         }
     }
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <ranges>
 #include <stdexcept>
 #include <functional>
@@ -5,56 +6,85 @@
 #include <format>
 #include <iostream>
 #include <utility>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <numeric>
 
 #include <LuaWrapperGenerator/CodeParser.hpp>
 #include <LuaWrapperGenerator/CommentParser.hpp>
+#include <LuaWrapperGenerator/Hash.hpp>
+#include <LuaWrapperGenerator/Trace.hpp>
 #include <Helpers/String.hpp>
 #include <Timer/ScopedTimer.hpp>
 
 namespace RC::LuaWrapperGenerator
 {
-    auto static resolve_scope(const CXCursor& cursor) -> std::string
+    struct CursorHash
     {
-        std::string buffer{};
+        auto operator()(const CXCursor& cursor) const -> size_t { return clang_hashCursor(cursor); }
+    };
 
-        auto parent_cursor = clang_getCursorSemanticParent(cursor);
-        auto cursor_kind = clang_getCursorKind(parent_cursor);
+    struct CursorEqual
+    {
+        auto operator()(const CXCursor& a, const CXCursor& b) const -> bool { return clang_equalCursors(a, b) != 0; }
+    };
 
-        std::vector<std::string> scopes{};
-        while (cursor_kind != CXCursorKind::CXCursor_TranslationUnit && cursor_kind != CXCursorKind::CXCursor_FirstInvalid)
-        {
-            //buffer.append(std::format("::{}", clang_getCString(clang_getCursorSpelling(parent_cursor))));
-            auto cursor_spelling = clang_getCursorSpelling(parent_cursor);
-            scopes.emplace_back(std::format("::{}", clang_getCString(cursor_spelling)));
-            clang_disposeString(cursor_spelling);
-            parent_cursor = clang_getCursorSemanticParent(parent_cursor);
-            cursor_kind = clang_getCursorKind(parent_cursor);
-        }
+    // Semantic parent -> fully qualified scope of the declarations directly inside it, for example '::RC::Unreal' for the namespace 'Unreal' in 'RC'.
+    // Cursors are only valid for the translation unit that they came from so this is cleared by 'process_translation_unit'.
+    thread_local std::unordered_map<CXCursor, Symbol, CursorHash, CursorEqual> resolved_scopes{};
 
-        for (auto& scope : std::ranges::reverse_view(scopes))
-        {
-            buffer.append(scope);
-        }
+    static auto resolve_scope_of_parent(const CXCursor& parent_cursor) -> const std::string&
+    {
+        static const std::string global_scope{};
+        auto cursor_kind = clang_getCursorKind(parent_cursor);
+        if (cursor_kind == CXCursorKind::CXCursor_TranslationUnit || cursor_kind == CXCursorKind::CXCursor_FirstInvalid) { return global_scope; }
+
+        if (auto it = resolved_scopes.find(parent_cursor); it != resolved_scopes.end()) { return it->second.str(); }
+
+        // Symbols are never freed so the scope of the outer parent stays valid while it's being added to.
+        const auto& outer_scope = resolve_scope_of_parent(clang_getCursorSemanticParent(parent_cursor));
+        auto cursor_spelling = clang_getCursorSpelling(parent_cursor);
+        std::string scope{};
+        scope.reserve(outer_scope.size() + 32);
+        scope.append(outer_scope);
+        scope.append("::");
+        scope.append(clang_getCString(cursor_spelling));
+        clang_disposeString(cursor_spelling);
+        return resolved_scopes.emplace(parent_cursor, Symbol{scope}).first->second.str();
+    }
 
-        //auto parent_cursor = clang_getCursorSemanticParent(cursor);
-        //auto parent_kind = clang_getCursorKind(parent_cursor);
-        //auto parent_name = std::string{clang_getCString(clang_getCursorSpelling(parent_cursor))};
-        //printf_s("parent_kind #1: %i\n", parent_kind);
-        //printf_s("parent_name #1: %s\n", parent_name.c_str());
-//
-        //auto parent_cursor2 = clang_getCursorSemanticParent(parent_cursor);
-        //auto parent_kind2 = clang_getCursorKind(parent_cursor2);
-        //auto parent_name2 = std::string{clang_getCString(clang_getCursorSpelling(parent_cursor2))};
-        //printf_s("parent_kind #2: %i\n", parent_kind2);
-        //printf_s("parent_name #2: %s\n", parent_name2.c_str());
-//
-        //auto parent_cursor3 = clang_getCursorSemanticParent(parent_cursor2);
-        //auto parent_kind3 = clang_getCursorKind(parent_cursor3);
-        //auto parent_name3 = std::string{clang_getCString(clang_getCursorSpelling(parent_cursor3))};
-        //printf_s("parent_kind #3: %i\n", parent_kind3);
-        //printf_s("parent_name #3: %s\n", parent_name3.c_str());
+    // Every declaration in the same class or namespace shares the parent chain, so only the first one walks it.
+    auto static resolve_scope(const CXCursor& cursor) -> const std::string&
+    {
+        return resolve_scope_of_parent(clang_getCursorSemanticParent(cursor));
+    }
 
-        return buffer;
+    template<typename StringType>
+    static auto create_spelled_type(CodeGenerator& code_generator, const CXType&, IsPointer) -> std::unique_ptr<Type::Base>
+    {
+        return std::make_unique<StringType>(code_generator.get_lookup_container());
+    }
+
+    // We don't support 'using namespace std;' with the C++ standard library.
+    static auto register_builtin_spelled_types(CodeGenerator& code_generator) -> void
+    {
+        code_generator.register_spelled_type("std::string", &create_spelled_type<Type::String>);
+        code_generator.register_spelled_type("std::wstring", &create_spelled_type<Type::WString>);
+        // TODO: Resolve the 'using' statement to figure out if this is a wide string.
+        //       We're assuming this is a wide string at the moment.
+        code_generator.register_spelled_type("File::StringType", &create_spelled_type<Type::AutoString>);
+        code_generator.register_spelled_type("RC::File::StringType", &create_spelled_type<Type::AutoString>);
+        // TODO: Properly support string_view.
+        code_generator.register_spelled_type("std::string_view", &create_spelled_type<Type::String>);
+        // TODO: Properly support wstring_view.
+        code_generator.register_spelled_type("std::wstring_view", &create_spelled_type<Type::WString>);
+        // TODO: Properly support File::StringViewType.
+        code_generator.register_spelled_type("File::StringViewType", &create_spelled_type<Type::AutoString>);
     }
 
     auto cxtype_to_type(CodeGenerator& code_generator, const CXType& cxtype, IsPointer is_pointer) -> std::unique_ptr<Type::Base>
@@ -87,100 +117,71 @@ namespace RC::LuaWrapperGenerator
             //throw DoNotParseException{"templated types are not supported"};
             return nullptr;
         }
-        // We don't support 'using namespace std;' with the C++ standard library.
-        else if (type_spelling == "std::string")
-        {
-            //return Type::String::static_class.get();
-            type = std::make_unique<Type::String>(code_generator.get_container());
-        }
-        else if (type_spelling == "std::wstring")
-        {
-            //return Type::WString::static_class.get();
-            type = std::make_unique<Type::WString>(code_generator.get_container());
-        }
-        else if (type_spelling == "File::StringType" || type_spelling == "RC::File::StringType")
-        {
-            //return Type::AutoString::static_class.get();
-            // TODO: Resolve the 'using' statement to figure out if this is a wide string.
-            //       We're assuming this is a wide string at the moment.
-            type = std::make_unique<Type::AutoString>(code_generator.get_container());
-        }
-        else if (type_spelling == "std::string_view")
-        {
-            // TODO: Properly support string_view.
-            type = std::make_unique<Type::String>(code_generator.get_container());
-        }
-        else if (type_spelling == "std::wstring_view")
-        {
-            // TODO: Properly support wstring_view.
-            type = std::make_unique<Type::WString>(code_generator.get_container());
-        }
-        else if (type_spelling == "File::StringViewType")
+        else if (auto create_spelled_type = code_generator.find_spelled_type(type_spelling))
         {
-            // TODO: Properly support File::StringViewType.
-            type = std::make_unique<Type::AutoString>(code_generator.get_container());
+            type = create_spelled_type(code_generator, cxtype, is_pointer);
         }
         else if (cxtype.kind == CXTypeKind::CXType_Void)
         {
             //return Type::Void::static_class.get();
-            type = std::make_unique<Type::Void>(code_generator.get_container());
+            type = std::make_unique<Type::Void>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_SChar)
         {
             //return Type::Int8::static_class.get();
-            type = std::make_unique<Type::Int8>(code_generator.get_container());
+            type = std::make_unique<Type::Int8>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_Short)
         {
             //return Type::Int16::static_class.get();
-            type = std::make_unique<Type::Int16>(code_generator.get_container());
+            type = std::make_unique<Type::Int16>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_Int)
         {
             //return Type::Int32::static_class.get();
-            type = std::make_unique<Type::Int32>(code_generator.get_container());
+            type = std::make_unique<Type::Int32>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_LongLong)
         {
             //return Type::Int64::static_class.get();
-            type = std::make_unique<Type::Int64>(code_generator.get_container());
+            type = std::make_unique<Type::Int64>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_UChar)
         {
             //return Type::UInt8::static_class.get();
-            type = std::make_unique<Type::UInt8>(code_generator.get_container());
+            type = std::make_unique<Type::UInt8>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_UShort)
         {
             //return Type::UInt16::static_class.get();
-            type = std::make_unique<Type::UInt16>(code_generator.get_container());
+            type = std::make_unique<Type::UInt16>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_UInt)
         {
             //return Type::UInt32::static_class.get();
-            type = std::make_unique<Type::UInt32>(code_generator.get_container());
+            type = std::make_unique<Type::UInt32>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_ULongLong)
         {
             //return Type::UInt64::static_class.get();
-            type = std::make_unique<Type::UInt64>(code_generator.get_container());
+            type = std::make_unique<Type::UInt64>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_Float)
         {
             //return Type::Float::static_class.get();
-            type = std::make_unique<Type::Float>(code_generator.get_container());
+            type = std::make_unique<Type::Float>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_Double)
         {
             //return Type::Double::static_class.get();
-            type = std::make_unique<Type::Double>(code_generator.get_container());
+            type = std::make_unique<Type::Double>(code_generator.get_lookup_container());
         }
         else if (cxtype.kind == CXTypeKind::CXType_Char_S)
         {
             if (is_pointer == IsPointer::Yes)
             {
                 //printf_s("Is Pointer == Yes\n");
-                type = std::make_unique<Type::CString>(code_generator.get_container());
+                type = std::make_unique<Type::CString>(code_generator.get_lookup_container());
                 type->set_is_pointer(true);
             }
             else
@@ -192,7 +193,7 @@ namespace RC::LuaWrapperGenerator
         {
             if (is_pointer == IsPointer::Yes)
             {
-                type = std::make_unique<Type::CWString>(code_generator.get_container());
+                type = std::make_unique<Type::CWString>(code_generator.get_lookup_container());
                 type->set_is_pointer(true);
             }
             else
@@ -202,12 +203,12 @@ namespace RC::LuaWrapperGenerator
         }
         else if (cxtype.kind == CXTypeKind::CXType_Bool)
         {
-            type = std::make_unique<Type::Bool>(code_generator.get_container());
+            type = std::make_unique<Type::Bool>(code_generator.get_lookup_container());
         }
             /**/
         else if (cxtype.kind == CXTypeKind::CXType_Enum)
         {
-            type = std::make_unique<Type::Enum>(code_generator.get_container(), type_spelling);
+            type = std::make_unique<Type::Enum>(code_generator.get_lookup_container(), type_spelling);
         }
             //*/
         else if (cxtype.kind == CXTypeKind::CXType_Pointer)
@@ -249,11 +250,11 @@ namespace RC::LuaWrapperGenerator
             auto last_semi_colon = canonical_name.find_last_of(':');
             if (last_semi_colon != canonical_name.npos)
             {
-                type = std::make_unique<Type::CustomStruct>(code_generator.get_container(), canonical_name.substr(last_semi_colon + 1));
+                type = std::make_unique<Type::CustomStruct>(code_generator.get_lookup_container(), canonical_name.substr(last_semi_colon + 1));
             }
             else
             {
-                type = std::make_unique<Type::CustomStruct>(code_generator.get_container(), canonical_name);
+                type = std::make_unique<Type::CustomStruct>(code_generator.get_lookup_container(), canonical_name);
             }
 
             if (clang_isReference(clang_getCursorKind(clang_getTypeDeclaration(cxtype))))
@@ -265,7 +266,7 @@ namespace RC::LuaWrapperGenerator
 
             auto type_decl_cursor = clang_getTypeDeclaration(cxtype);
 
-            auto scope = resolve_scope(type_decl_cursor);
+            const auto& scope = resolve_scope(type_decl_cursor);
             typed_type->set_fully_qualified_scope(scope);
 
             if (clang_isCursorDefinition(type_decl_cursor) == 0)
@@ -299,11 +300,11 @@ namespace RC::LuaWrapperGenerator
 
                 if (start_of_type != 0)
                 {
-                    type = std::make_unique<Type::CustomStruct>(code_generator.get_container(), canonical_name.substr(start_of_type + 1, first_angle_brace - start_of_type - 1));
+                    type = std::make_unique<Type::CustomStruct>(code_generator.get_lookup_container(), canonical_name.substr(start_of_type + 1, first_angle_brace - start_of_type - 1));
                 }
                 else
                 {
-                    type = std::make_unique<Type::CustomStruct>(code_generator.get_container(), canonical_name);
+                    type = std::make_unique<Type::CustomStruct>(code_generator.get_lookup_container(), canonical_name);
                 }
             }
             else
@@ -319,12 +320,12 @@ namespace RC::LuaWrapperGenerator
             auto function_proto_type_spelling = clang_getTypeSpelling(cxtype);
             auto function_proto = std::string{clang_getCString(function_proto_type_spelling)};
             clang_disposeString(function_proto_type_spelling);
-            type = std::make_unique<Type::FunctionProto>(code_generator.get_container(), function_proto);
+            type = std::make_unique<Type::FunctionProto>(code_generator.get_lookup_container(), function_proto);
 
             auto typed_type = static_cast<Type::FunctionProto*>(type.get());
             for (int i = 0; i < clang_getNumArgTypes(cxtype); i++)
             {
-                typed_type->add_param(cxtype_to_type(code_generator, clang_getArgType(cxtype, i)));
+                typed_type->add_param(code_generator.intern_type(cxtype_to_type(code_generator, clang_getArgType(cxtype, i))));
             }
 
             auto[function_proto_it, was_inserted] = code_generator.get_container().function_proto_container.emplace(typed_type->get_function_proto(), typed_type);
@@ -342,12 +343,12 @@ namespace RC::LuaWrapperGenerator
             for (int i = 0; i < clang_getNumArgTypes(cxtype); ++i)
             {
                 auto arg_cxtype = clang_getArgType(cxtype, i);
-                auto arg_type = cxtype_to_type(code_generator, arg_cxtype);
-                overload.emplace_back("", std::move(arg_type));
+                auto arg_type = code_generator.intern_type(cxtype_to_type(code_generator, arg_cxtype));
+                overload.emplace_back("", arg_type);
             }
 
-            auto return_type = cxtype_to_type(code_generator, clang_getResultType(cxtype));
-            function.set_return_type(std::move(return_type));
+            auto return_type = code_generator.intern_type(cxtype_to_type(code_generator, clang_getResultType(cxtype)));
+            function.set_return_type(return_type);
             typed_type->set_return_type(function.get_return_type());
             typed_type->set_function(std::move(function));
         }
@@ -377,33 +378,67 @@ namespace RC::LuaWrapperGenerator
         return type;
     }
 
-    auto CodeParser::cxtype_to_type(const CXType& cxtype, IsPointer is_pointer) -> std::unique_ptr<Type::Base>
+    // The spelling alone isn't enough since the same spelling refers to different types in different scopes, the canonical spelling is fully qualified.
+    // The spelling is still needed because types like 'File::StringType' are recognized by how they're spelled, not by what they resolve to.
+    static auto make_converted_type_key(const CXType& cxtype, IsPointer is_pointer) -> std::string
     {
-        auto cxtype_spelling = clang_getTypeSpelling(cxtype);
-        std::string type_spelling = clang_getCString(cxtype_spelling);
-        clang_disposeString(cxtype_spelling);
-        auto type = ::RC::LuaWrapperGenerator::cxtype_to_type(m_parser_output, cxtype, is_pointer);
-        if (!type)
+        auto type_spelling = clang_getTypeSpelling(cxtype);
+        auto canonical_type_spelling = clang_getTypeSpelling(clang_getCanonicalType(cxtype));
+        auto key = std::format("{}{}{}\n{}", static_cast<int>(cxtype.kind), is_pointer == IsPointer::Yes ? '*' : ' ', clang_getCString(type_spelling), clang_getCString(canonical_type_spelling));
+        clang_disposeString(canonical_type_spelling);
+        clang_disposeString(type_spelling);
+        return key;
+    }
+
+    auto CodeParser::cxtype_to_type(const CXType& cxtype, IsPointer is_pointer) -> Type::Base*
+    {
+        Trace::Span span{"cxtype_to_type"};
+        auto converted_type_key = make_converted_type_key(cxtype, is_pointer);
+        if (auto it = m_converted_types.find(converted_type_key); it != m_converted_types.end())
         {
-            //if (auto it = type_patches.find(); it != type_patches.end())
-            for (const auto& type_patch : m_type_patches)
-            {
-                type = type_patch.cxtype_to_type(m_parser_output, cxtype, is_pointer);
-            }
+            if (!it->second.type) { throw DoNotParseException{it->second.reason, it->second.is_verbose}; }
+            return it->second.type;
+        }
 
+        std::unique_ptr<Type::Base> type{};
+        try
+        {
+            type = ::RC::LuaWrapperGenerator::cxtype_to_type(m_parser_output, cxtype, is_pointer);
             if (!type)
             {
-                auto cxtype_kind_spelling = clang_getTypeKindSpelling(cxtype.kind);
-                auto type_kind_spelling = std::string{clang_getCString(cxtype_kind_spelling)};
-                clang_disposeString(cxtype_kind_spelling);
-                throw DoNotParseException{std::format("type is unhandled, type_spelling: {}", type_kind_spelling)};
+                for (const auto& type_patch : m_type_patches)
+                {
+                    if (!type_patch.cxtype_to_type) { continue; }
+                    type = type_patch.cxtype_to_type(m_parser_output, cxtype, is_pointer);
+                    if (type) { break; }
+                }
+
+                if (!type)
+                {
+                    auto cxtype_kind_spelling = clang_getTypeKindSpelling(cxtype.kind);
+                    auto type_kind_spelling = std::string{clang_getCString(cxtype_kind_spelling)};
+                    clang_disposeString(cxtype_kind_spelling);
+                    throw DoNotParseException{std::format("type is unhandled, type_spelling: {}", type_kind_spelling)};
+                }
+            }
+        }
+        catch (DoNotParseException& e)
+        {
+            // Unsupported types are common, like every 'char' param, so the failure is remembered as well.
+            // Exceptions that carry data are specific to where they were thrown and aren't remembered.
+            if (!e.data)
+            {
+                m_converted_types.emplace(std::move(converted_type_key), ConvertedType{nullptr, e.reason, e.is_verbose});
             }
+            throw;
         }
 
-        return type;
+        auto* interned_type = m_parser_output.intern_type(std::move(type));
+        m_converted_types.emplace(std::move(converted_type_key), ConvertedType{interned_type});
+        return interned_type;
     }
 
-    auto CodeParser::cursor_to_type(const CXCursor& cursor) -> std::unique_ptr<Type::Base>
+    auto CodeParser::cursor_to_type(const CXCursor& cursor) -> Type::Base*
     {
         auto cursor_type = clang_getCursorResultType(cursor);
         return cxtype_to_type(cursor_type);
@@ -411,10 +446,55 @@ namespace RC::LuaWrapperGenerator
 
     CodeParser::CodeParser(std::vector<std::string> files_to_parse, const char** compiler_flags, int num_compiler_flags, std::filesystem::path output_path, std::filesystem::path code_root) : m_parser_output(std::move(output_path), m_type_patches), m_code_root(std::move(code_root))
     {
+        if (std::error_code error_code{}; !m_code_root.empty() && !std::filesystem::is_directory(m_code_root, error_code))
+        {
+            printf_s("The code root '%s' doesn't exist, every header that isn't a system header is treated as part of the project\n", m_code_root.string().c_str());
+            m_code_root.clear();
+        }
         m_files_to_parse = std::move(files_to_parse);
         m_compiler_flags = compiler_flags;
         m_num_compiler_flags = num_compiler_flags;
         m_current_index = clang_createIndex(0, 0);
+        register_builtin_spelled_types(m_parser_output);
+    }
+
+    CodeParser::CodeParser(CodeGenerator& owner_output, const CodeParser& owner) : m_parser_output(owner_output.get_output_path(), m_type_patches, &owner_output), m_code_root(owner.m_code_root)
+    {
+        m_type_patches = owner.m_type_patches;
+        register_builtin_spelled_types(m_parser_output);
+        for (const auto& type_patch : m_type_patches)
+        {
+            if (type_patch.register_spelled_types)
+            {
+                type_patch.register_spelled_types(m_parser_output);
+            }
+        }
+        m_compiler_flags = owner.m_compiler_flags;
+        m_num_compiler_flags = owner.m_num_compiler_flags;
+        m_parse_cache = owner.m_parse_cache;
+        m_precompiled_header = owner.m_precompiled_header;
+        m_per_file_precompiled_headers = owner.m_per_file_precompiled_headers;
+        m_per_file_compiler_args = owner.m_per_file_compiler_args;
+        m_allowed_path_prefixes = owner.m_allowed_path_prefixes;
+        m_denied_path_prefixes = owner.m_denied_path_prefixes;
+        m_skip_system_headers = owner.m_skip_system_headers;
+        // Workers start out with every request so that files can be visited in any order.
+        if (owner.m_has_collected_annotation_requests)
+        {
+            m_out_of_line_class_requests = owner.m_out_of_line_class_requests;
+            m_out_of_line_free_function_requests = owner.m_out_of_line_free_function_requests;
+            m_out_of_line_custom_free_function_requests = owner.m_out_of_line_custom_free_function_requests;
+            m_out_of_line_custom_member_function_requests = owner.m_out_of_line_custom_member_function_requests;
+            m_out_of_line_custom_member_function_names = owner.m_out_of_line_custom_member_function_names;
+            m_out_of_line_custom_metamethod_functions = owner.m_out_of_line_custom_metamethod_functions;
+            m_out_of_line_template_class_map = owner.m_out_of_line_template_class_map;
+            m_custom_base_classes = owner.m_custom_base_classes;
+            m_custom_base_classes_inverted = owner.m_custom_base_classes_inverted;
+            m_out_of_line_enums = owner.m_out_of_line_enums;
+            m_has_collected_annotation_requests = true;
+            m_annotation_requests_hash = owner.m_annotation_requests_hash;
+        }
+        m_current_index = clang_createIndex(0, 0);
     }
 
     CodeParser::~CodeParser()
@@ -427,10 +507,10 @@ namespace RC::LuaWrapperGenerator
         auto cursor_spelling = clang_getCursorSpelling(cursor);
         auto function_name = !function_name_override.empty() ? function_name_override : std::string{clang_getCString(cursor_spelling)};
         clang_disposeString(cursor_spelling);
-        auto function_scope = resolve_scope(cursor);
+        const auto& function_scope = resolve_scope(cursor);
         auto function_scope_and_name = function_scope + "::" + function_name;
 
-        std::vector<std::pair<std::string, std::unique_ptr<Type::Base>>> checked_parameters{};
+        std::vector<FunctionParam> checked_parameters{};
         if (clang_Cursor_getNumArguments(cursor) > 0)
         {
             struct VisitorData
@@ -469,7 +549,7 @@ namespace RC::LuaWrapperGenerator
 
                 try
                 {
-                    visitor_data.checked_parameters.emplace_back(std::make_pair(std::move(param_name), std::move(visitor_data.self.cxtype_to_type(cursor_type))));
+                    visitor_data.checked_parameters.emplace_back(FunctionParam{param_name, visitor_data.self.cxtype_to_type(cursor_type)});
                 }
                 catch (DoNotParseException& e)
                 {
@@ -484,7 +564,7 @@ namespace RC::LuaWrapperGenerator
             if (visitor_data.do_not_parse) { return nullptr; }
         }
 
-        std::unique_ptr<Type::Base> return_type{};
+        Type::Base* return_type{};
         try
         {
             return_type = cursor_to_type(cursor);
@@ -531,36 +611,6 @@ namespace RC::LuaWrapperGenerator
             return nullptr;
         }
 
-        int num_overload_param_matches{};
-        for (size_t i = 0; i < checked_parameters.size(); i++)
-        {
-            auto& [checked_param_name, checked_param_type] = checked_parameters[i];
-
-            auto& overloads = function->get_overloads();
-            for (size_t x = 0; x < overloads.size(); x++)
-            {
-                auto& overload_params = overloads[x];
-                if (overload_params.size() == checked_parameters.size())
-                {
-                    auto& param = overload_params[i];
-                    if (param.type->get_fully_qualified_type_name() == checked_param_type->get_fully_qualified_type_name())
-                    {
-                        ++num_overload_param_matches;
-                        break;
-                    }
-
-                    // Hack for hard-coded strings.
-                    if ((param.type->is_a<Type::AutoString>() || param.type->is_a<Type::WString>() || param.type->is_a<Type::String>() || param.type->is_a<Type::CWString>() || param.type->is_a<Type::CString>())
-                        &&
-                        (checked_param_type->is_a<Type::AutoString>() || checked_param_type->is_a<Type::WString>() || checked_param_type->is_a<Type::String>() || checked_param_type->is_a<Type::CWString>() || checked_param_type->is_a<Type::CString>()))
-                    {
-                        ++num_overload_param_matches;
-                        break;
-                    }
-                }
-            }
-        }
-
         auto loc = clang_getCursorLocation(cursor);
         CXFile loc_file;
         unsigned loc_line;
@@ -569,7 +619,7 @@ namespace RC::LuaWrapperGenerator
         clang_getSpellingLocation(loc, &loc_file, &loc_line, &loc_column, &loc_offset);
         auto file_name = clang_getFileName(loc_file);
 
-        if ((num_overload_param_matches != 0 && num_overload_param_matches == checked_parameters.size()) || (checked_parameters.empty() && !function->get_overloads().empty()))
+        if (function->has_matching_overload(checked_parameters))
         {
             //printf_s("Overload already exists function: %s::%s\n", function->get_fully_qualified_scope().data(), function->get_name().data());
             //printf_s("L%i in %s\n", loc_line, clang_getCString(file_name));
@@ -583,13 +633,9 @@ namespace RC::LuaWrapperGenerator
         }
         clang_disposeString(file_name);
 
-        auto& params_overload = function->get_overloads().emplace_back();
-        for (auto& [checked_param_name, checked_param_type] : checked_parameters)
-        {
-            params_overload.emplace_back(FunctionParam{std::move(checked_param_name), std::move(checked_param_type)});
-        }
+        function->get_overloads().emplace_back(std::move(checked_parameters));
 
-        function->set_return_type(std::move(return_type));
+        function->set_return_type(return_type);
 
         return function;
     }
@@ -599,7 +645,7 @@ namespace RC::LuaWrapperGenerator
         auto cursor_spelling = clang_getCursorSpelling(cursor);
         auto name = std::string{clang_getCString(cursor_spelling)};
         clang_disposeString(cursor_spelling);
-        auto scope = resolve_scope(cursor);
+        const auto& scope = resolve_scope(cursor);
 
         // TODO: Support for requesting bindings to be generated with an inline comment just like classes.
 
@@ -682,9 +728,360 @@ namespace RC::LuaWrapperGenerator
 
     auto CodeParser::add_type_patch(TypePatch&& type_patch) -> void
     {
+        if (type_patch.register_spelled_types)
+        {
+            type_patch.register_spelled_types(m_parser_output);
+        }
         m_type_patches.emplace_back(type_patch);
     }
 
+    auto CodeParser::set_num_jobs(size_t num_jobs) -> void
+    {
+        m_num_jobs = num_jobs == 0 ? std::max(std::thread::hardware_concurrency(), 1u) : num_jobs;
+        m_parser_output.set_num_jobs(m_num_jobs);
+    }
+
+    auto CodeParser::set_unity_build(bool unity_build) -> void
+    {
+        m_unity_build = unity_build;
+    }
+
+    auto CodeParser::set_precompiled_header(std::filesystem::path precompiled_header) -> void
+    {
+        m_precompiled_header = precompiled_header.string();
+    }
+
+    auto CodeParser::set_precompiled_header_sources(std::vector<std::string> headers, std::filesystem::path precompiled_header) -> void
+    {
+        m_precompiled_header_sources = std::move(headers);
+        set_precompiled_header(std::move(precompiled_header));
+    }
+
+    // Files are looked up in the compilation database by this form of their path.
+    static auto normalize_file_path(const std::string& file) -> std::string
+    {
+        return std::filesystem::absolute(file).lexically_normal().string();
+    }
+
+    // Every annotation comment contains this, files that don't can be skipped without being tokenized.
+    static constexpr std::string_view custom_attribute_tag{"CUSTOM_ATTRIBUTE["};
+
+    static auto read_source_file(const std::filesystem::path& file) -> std::string
+    {
+        std::ifstream source_file{file, std::ios::binary};
+        return std::string{std::istreambuf_iterator<char>{source_file}, std::istreambuf_iterator<char>{}};
+    }
+
+    auto CodeParser::get_per_file_compiler_args(const std::string& file) const -> const std::vector<std::string>*
+    {
+        if (!m_per_file_compiler_args) { return nullptr; }
+        auto it = m_per_file_compiler_args->find(normalize_file_path(file));
+        return it == m_per_file_compiler_args->end() ? nullptr : &it->second;
+    }
+
+    auto CodeParser::get_precompiled_header(const std::string& file) const -> const std::string*
+    {
+        if (m_precompiled_header.empty()) { return nullptr; }
+        if (!get_per_file_compiler_args(file)) { return &m_precompiled_header; }
+
+        // A file with its own flags can only use a precompiled header that was built with those flags, libclang rejects any other.
+        if (!m_per_file_precompiled_headers) { return nullptr; }
+        auto it = m_per_file_precompiled_headers->find(normalize_file_path(file));
+        return it == m_per_file_precompiled_headers->end() ? nullptr : &it->second;
+    }
+
+    auto CodeParser::get_compiler_args(const std::string& file) const -> std::vector<const char*>
+    {
+        std::vector<const char*> compiler_args{};
+        if (auto per_file_compiler_args = get_per_file_compiler_args(file))
+        {
+            for (const auto& compiler_arg : *per_file_compiler_args)
+            {
+                compiler_args.emplace_back(compiler_arg.c_str());
+            }
+        }
+        else
+        {
+            compiler_args.assign(m_compiler_flags, m_compiler_flags + m_num_compiler_flags);
+        }
+        if (auto precompiled_header = get_precompiled_header(file))
+        {
+            compiler_args.emplace_back("-include-pch");
+            compiler_args.emplace_back(precompiled_header->c_str());
+        }
+        return compiler_args;
+    }
+
+    static auto get_last_write_time(const std::string& file) -> std::filesystem::file_time_type
+    {
+        std::error_code error_code{};
+        auto last_write_time = std::filesystem::last_write_time(file, error_code);
+        return error_code ? std::filesystem::file_time_type::min() : last_write_time;
+    }
+
+    // A file that was written while it was being parsed may have been read before the write.
+    // It's given a time that never matches so that it's parsed again the next time the files are checked for changes.
+    static auto get_dependency_stamp(const std::string& file, std::filesystem::file_time_type parse_start, std::filesystem::file_time_type parse_end) -> std::filesystem::file_time_type
+    {
+        auto last_write_time = get_last_write_time(file);
+        if (last_write_time >= parse_start && last_write_time <= parse_end) { return std::filesystem::file_time_type::min(); }
+        return last_write_time;
+    }
+
+    // Every file that the translation unit includes, directly or not, except for the main file.
+    static auto get_included_files(CXTranslationUnit translation_unit) -> std::vector<std::string>
+    {
+        std::vector<std::string> included_files{};
+        clang_getInclusions(translation_unit, [](CXFile included_file, CXSourceLocation*, unsigned int include_depth, CXClientData data) {
+            if (include_depth == 0) { return; }
+
+            auto file_name = clang_getFileName(included_file);
+            static_cast<std::vector<std::string>*>(data)->emplace_back(clang_getCString(file_name));
+            clang_disposeString(file_name);
+        }, &included_files);
+        return included_files;
+    }
+
+    auto CodeParser::build_precompiled_headers() -> void
+    {
+        m_precompiled_header_dependencies.clear();
+        // Files with their own flags from the compilation database get one precompiled header per distinct set of flags.
+        // They're written next to the precompiled header for the global flags, with the hash of the flags in the name.
+        auto per_file_precompiled_headers = std::make_shared<std::unordered_map<std::string, std::string>>();
+        std::unordered_map<uint64_t, std::string> precompiled_headers_by_flags{};
+        bool uses_global_flags{};
+        for (const auto& file : m_files_to_parse)
+        {
+            auto per_file_compiler_args = get_per_file_compiler_args(file);
+            if (!per_file_compiler_args)
+            {
+                uses_global_flags = true;
+                continue;
+            }
+
+            Hasher hasher{};
+            for (const auto& compiler_arg : *per_file_compiler_args)
+            {
+                hasher.update(std::string_view{compiler_arg});
+            }
+            auto [it, inserted] = precompiled_headers_by_flags.try_emplace(hasher.get());
+            if (inserted)
+            {
+                std::filesystem::path precompiled_header{m_precompiled_header};
+                it->second = (precompiled_header.parent_path() / std::format("{}_{:016x}{}", precompiled_header.stem().string(), it->first, precompiled_header.extension().string())).string();
+
+                std::vector<const char*> compiler_args{};
+                for (const auto& compiler_arg : *per_file_compiler_args)
+                {
+                    compiler_args.emplace_back(compiler_arg.c_str());
+                }
+                build_precompiled_header(it->second, std::move(compiler_args));
+            }
+            per_file_precompiled_headers->emplace(normalize_file_path(file), it->second);
+        }
+
+        if (uses_global_flags)
+        {
+            build_precompiled_header(m_precompiled_header, {m_compiler_flags, m_compiler_flags + m_num_compiler_flags});
+        }
+        m_per_file_precompiled_headers = std::move(per_file_precompiled_headers);
+    }
+
+    auto CodeParser::build_precompiled_header(const std::string& precompiled_header, std::vector<const char*> compiler_args) -> void
+    {
+        Trace::Span span{"build_precompiled_header", precompiled_header};
+        printf_s("Building precompiled header: %s\n", precompiled_header.c_str());
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+
+            // Same approach as the unity mode, a synthetic header that includes every header is passed to libclang as an unsaved file.
+            std::string pch_source{};
+            for (const auto& header : m_precompiled_header_sources)
+            {
+                pch_source.append(std::format("#include \"{}\"\n", std::filesystem::path{header}.generic_string()));
+            }
+            auto pch_source_name = (m_code_root / "LuaWrapperGeneratorPCH.hpp").string();
+            CXUnsavedFile pch_source_file{pch_source_name.c_str(), pch_source.c_str(), static_cast<unsigned long>(pch_source.size())};
+            auto parse_start = std::filesystem::file_time_type::clock::now();
+
+            // Must be parsed with the same flags as the translation units that use it, except for the PCH itself.
+            compiler_args.emplace_back("-x");
+            compiler_args.emplace_back("c++-header");
+
+            auto translation_unit = clang_parseTranslationUnit(m_current_index,
+                                                               pch_source_name.c_str(),
+                                                               compiler_args.data(),
+                                                               static_cast<int>(compiler_args.size()),
+                                                               &pch_source_file,
+                                                               1,
+                                                               CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_Incomplete | CXTranslationUnit_ForSerialization);
+            if (!translation_unit)
+            {
+                throw std::runtime_error{std::format("Unable to parse the headers for the precompiled header '{}'", precompiled_header)};
+            }
+
+            auto parse_end = std::filesystem::file_time_type::clock::now();
+            for (auto& included_file : get_included_files(translation_unit))
+            {
+                auto last_write_time = get_dependency_stamp(included_file, parse_start, parse_end);
+                m_precompiled_header_dependencies.emplace_back(std::move(included_file), last_write_time);
+            }
+
+            auto save_result = clang_saveTranslationUnit(translation_unit, precompiled_header.c_str(), clang_defaultSaveOptions(translation_unit));
+            clang_disposeTranslationUnit(translation_unit);
+            if (save_result != CXSaveError_None)
+            {
+                throw std::runtime_error{std::format("Unable to save the precompiled header '{}', error: {}", precompiled_header, save_result)};
+            }
+        }
+        printf_s("Building precompiled header took %f seconds.\n", timer_dur);
+    }
+
+    auto CodeParser::set_cache_dir(std::filesystem::path cache_dir) -> void
+    {
+        m_parse_cache = std::make_shared<ParseCache>(std::move(cache_dir));
+    }
+
+    // Generic separators and a trailing '/' so that a plain prefix match can't match part of a directory name.
+    static auto normalize_path_prefix(const std::string& path) -> std::string
+    {
+        auto prefix = std::filesystem::absolute(path).lexically_normal().generic_string();
+        if (!prefix.ends_with('/')) { prefix.push_back('/'); }
+        return prefix;
+    }
+
+    auto CodeParser::set_path_filters(const std::vector<std::string>& allowed_paths, const std::vector<std::string>& denied_paths) -> void
+    {
+        m_allowed_path_prefixes.clear();
+        m_denied_path_prefixes.clear();
+        for (const auto& allowed_path : allowed_paths)
+        {
+            m_allowed_path_prefixes.emplace_back(normalize_path_prefix(allowed_path));
+        }
+        for (const auto& denied_path : denied_paths)
+        {
+            m_denied_path_prefixes.emplace_back(normalize_path_prefix(denied_path));
+        }
+    }
+
+    auto CodeParser::set_skip_system_headers(bool skip_system_headers) -> void
+    {
+        m_skip_system_headers = skip_system_headers;
+    }
+
+    auto CodeParser::set_shard(size_t shard_index, size_t shard_count) -> void
+    {
+        if (shard_count == 0 || shard_index >= shard_count)
+        {
+            throw std::runtime_error{std::format("Invalid shard {}/{}, the index must be less than the number of shards", shard_index, shard_count)};
+        }
+        m_shard_index = shard_index;
+        m_shard_count = shard_count;
+    }
+
+    auto CodeParser::set_compile_commands(std::vector<CompileCommand> compile_commands) -> void
+    {
+        // Without any files, the database itself decides what to parse.
+        // Only files with annotations can contribute anything so the rest are filtered out without being parsed.
+        auto discover_files = m_files_to_parse.empty();
+        std::unordered_set<std::string> files_to_parse{};
+        for (const auto& file : m_files_to_parse)
+        {
+            files_to_parse.emplace(normalize_file_path(file));
+        }
+
+        auto per_file_compiler_args = std::make_shared<std::unordered_map<std::string, std::vector<std::string>>>();
+        for (auto& compile_command : compile_commands)
+        {
+            auto file = normalize_file_path(compile_command.file);
+            if (discover_files)
+            {
+                if (!is_under_code_root(file) || per_file_compiler_args->contains(file)) { continue; }
+
+                if (read_source_file(file).find(custom_attribute_tag) == std::string::npos) { continue; }
+
+                m_files_to_parse.emplace_back(file);
+            }
+            else if (!files_to_parse.contains(file))
+            {
+                continue;
+            }
+
+            // The first entry wins if a file is compiled more than once, same as clangd.
+            per_file_compiler_args->emplace(std::move(file), std::move(compile_command.args));
+        }
+
+        printf_s("Using compiler flags from the compilation database for %zu files\n", per_file_compiler_args->size());
+        m_per_file_compiler_args = std::move(per_file_compiler_args);
+    }
+
+    auto CodeParser::schedule_files() -> void
+    {
+        auto file_timings = m_parse_cache ? m_parse_cache->load_file_timings() : std::unordered_map<std::string, double>{};
+
+        // Files without a timing from a previous run are estimated from their size.
+        // The size is converted to seconds with the average of the files that do have a timing so that both can be compared.
+        std::vector<double> costs(m_files_to_parse.size());
+        std::vector<bool> has_timing(m_files_to_parse.size());
+        double known_seconds{};
+        double known_bytes{};
+        for (size_t file_index = 0; file_index < m_files_to_parse.size(); ++file_index)
+        {
+            std::error_code error_code{};
+            auto file_size = std::filesystem::file_size(m_files_to_parse[file_index], error_code);
+            costs[file_index] = error_code ? 0.0 : static_cast<double>(file_size);
+
+            if (auto it = file_timings.find(m_files_to_parse[file_index]); it != file_timings.end())
+            {
+                known_seconds += it->second;
+                known_bytes += costs[file_index];
+                costs[file_index] = it->second;
+                has_timing[file_index] = true;
+            }
+        }
+
+        auto seconds_per_byte = known_bytes > 0.0 ? known_seconds / known_bytes : 1.0;
+        for (size_t file_index = 0; file_index < m_files_to_parse.size(); ++file_index)
+        {
+            if (!has_timing[file_index]) { costs[file_index] *= seconds_per_byte; }
+        }
+
+        // The heaviest files are started first so that they don't end up being the only files left at the end.
+        m_file_schedule.resize(m_files_to_parse.size());
+        std::iota(m_file_schedule.begin(), m_file_schedule.end(), size_t{0});
+        std::ranges::stable_sort(m_file_schedule, [&](size_t a, size_t b) { return costs[a] > costs[b]; });
+    }
+
+    auto CodeParser::select_shard_files() -> void
+    {
+        // Sorted first so that the split doesn't depend on the order of the sources or of the compilation database.
+        std::vector<std::string> sorted_files = m_files_to_parse;
+        std::ranges::sort(sorted_files);
+        auto num_files = sorted_files.size();
+
+        m_files_to_parse.clear();
+        for (size_t file_index = m_shard_index; file_index < sorted_files.size(); file_index += m_shard_count)
+        {
+            m_files_to_parse.emplace_back(std::move(sorted_files[file_index]));
+        }
+        printf_s("Shard %zu/%zu parses %zu of %zu files\n", m_shard_index, m_shard_count, m_files_to_parse.size(), num_files);
+    }
+
+    auto CodeParser::store_file_parse_durations() const -> void
+    {
+        auto file_timings = m_parse_cache->load_file_timings();
+        for (size_t file_index = 0; file_index < m_files_to_parse.size(); ++file_index)
+        {
+            // Files that were loaded from the cache keep their timing from the run that parsed them.
+            if (m_file_parse_durations[file_index] > 0.0)
+            {
+                file_timings[m_files_to_parse[file_index]] = m_file_parse_durations[file_index];
+            }
+        }
+        m_parse_cache->store_file_timings(file_timings);
+    }
+
     auto CodeParser::resolve_base(CXCursor& inner_cursor, Class& class_ref) -> void
     {
         //printf_s("Resolving bases for %s...\n", visitor_data.class_ref.name.c_str());
@@ -722,7 +1119,7 @@ namespace RC::LuaWrapperGenerator
                 return CXChildVisit_Continue;
             }
         }, &visitor_data_inner);
-        auto base_scope = resolve_scope(visitor_data_inner.true_base_cursor);
+        const auto& base_scope = resolve_scope(visitor_data_inner.true_base_cursor);
         auto base_cursor_spelling = clang_getCursorSpelling(visitor_data_inner.true_base_cursor);
         auto base_name = std::string{clang_getCString(base_cursor_spelling)};
         clang_disposeString(base_cursor_spelling);
@@ -731,7 +1128,7 @@ namespace RC::LuaWrapperGenerator
         {
             the_base = generate_lua_class(visitor_data_inner.true_base_cursor);
         }
-        class_ref.get_mutable_bases().emplace(the_base);
+        class_ref.add_base(the_base);
     }
 
     auto static resolve_base(CodeParser& this_ref, CXCursor cursor, std::string& buffer, std::vector<const Class*>& bases) -> void
@@ -772,7 +1169,7 @@ namespace RC::LuaWrapperGenerator
         {
             printf_s("");
         }
-        auto fully_qualified_scope = resolve_scope(cursor);
+        const auto& fully_qualified_scope = resolve_scope(cursor);
         auto* the_class = m_parser_output.get_container().find_mutable_class_by_name(fully_qualified_scope, cursor_name);
         if (!the_class)
         {
@@ -904,7 +1301,7 @@ namespace RC::LuaWrapperGenerator
                     return CXChildVisit_Continue;
                 }, nullptr);
             }
-            auto fully_qualified_scope = resolve_scope(cursor);
+            const auto& fully_qualified_scope = resolve_scope(cursor);
             //printf_s("Resolving: %s\n", clang_getCString(clang_getCursorSpelling(cursor)));
             buffer.append(std::format("{}, ", cursor_name));
 
@@ -1039,7 +1436,7 @@ namespace RC::LuaWrapperGenerator
         auto cursor_spelling = clang_getCursorSpelling(cursor);
         auto cursor_name = std::string{clang_getCString(cursor_spelling)};
         clang_disposeString(cursor_spelling);
-        auto fully_qualified_scope = resolve_scope(cursor);
+        const auto& fully_qualified_scope = resolve_scope(cursor);
         printf_s("Resolving: %s\n", clang_getCString(clang_getCursorSpelling(cursor)));
         buffer.append(std::format("{}, ", cursor_name));
 
@@ -1080,7 +1477,7 @@ namespace RC::LuaWrapperGenerator
         auto cursor_spelling = clang_getCursorSpelling(cursor);
         auto class_name = std::string{clang_getCString(cursor_spelling)};
         clang_disposeString(cursor_spelling);
-        auto class_scope = resolve_scope(cursor);
+        const auto& class_scope = resolve_scope(cursor);
         auto class_scope_and_name = class_scope + "::" + class_name;
 
         if (does_exact_class_exist(class_scope_and_name)) { return nullptr; }
@@ -1099,7 +1496,10 @@ namespace RC::LuaWrapperGenerator
             was_requested_out_of_line = true;
         }
 
-        CommentParser comment_parser{comment};
+        auto comment_parser = [&] {
+            Trace::Span span{"CommentParser"};
+            return CommentParser{comment};
+        }();
 
         Class* the_class{};
 
@@ -1110,7 +1510,7 @@ namespace RC::LuaWrapperGenerator
         unsigned loc_offset;
         clang_getSpellingLocation(loc, &loc_file, &loc_line, &loc_column, &loc_offset);
 
-        if (auto attribute = comment_parser.get_attribute("Lua"); attribute.exists() || was_requested_out_of_line || generate_thin_class == GenerateThinClass::Yes)
+        if (auto attribute = comment_parser.get_attribute(CommentAttributeKind::Lua); attribute.exists() || was_requested_out_of_line || generate_thin_class == GenerateThinClass::Yes)
         {
             // Expose this struct to Lua.
             if (!was_requested_out_of_line && generate_thin_class == GenerateThinClass::No)
@@ -1211,11 +1611,10 @@ namespace RC::LuaWrapperGenerator
                             auto function = visitor_data.this_ref.generate_lua_class_member_function(visitor_data.class_ref, inner_cursor, visitor_data.class_ref.constructors, IsStaticFunction::Yes);
                             if (function)
                             {
-                                std::unique_ptr<Type::Base> return_type{};
                                 try
                                 {
                                     function->set_is_constructor(true);
-                                    function->set_return_type(std::move(visitor_data.this_ref.cxtype_to_type(clang_getCursorType(outer_cursor))));
+                                    function->set_return_type(visitor_data.this_ref.cxtype_to_type(clang_getCursorType(outer_cursor)));
                                 }
                                 catch (DoNotParseException& e)
                                 {
@@ -1322,7 +1721,7 @@ namespace RC::LuaWrapperGenerator
                     auto base = m_parser_output.get_container().find_class_by_name(base_class_scope, base_class_name);
                     if (base)
                     {
-                        the_class->get_mutable_bases().emplace(base);
+                        the_class->add_base(base);
                     }
                 }
             }
@@ -1334,7 +1733,7 @@ namespace RC::LuaWrapperGenerator
                     auto deriving_class = m_parser_output.get_container().find_mutable_class_by_name(deriving_class_scope, deriving_class_name);
                     if (deriving_class)
                     {
-                        deriving_class->get_mutable_bases().emplace(the_class);
+                        deriving_class->add_base(the_class);
                     }
                 }
             }
@@ -1400,8 +1799,23 @@ namespace RC::LuaWrapperGenerator
     auto CodeParser::generate_internal(CXCursor inner_cursor, CXCursor outer_cursor) -> CXChildVisitResult
     {
         auto cursor_kind = clang_getCursorKind(inner_cursor);
+        ++m_num_visited_cursors;
+        if (cursor_kind == CXCursor_Namespace || cursor_kind == CXCursor_StructDecl || cursor_kind == CXCursor_ClassDecl || cursor_kind == CXCursor_FunctionDecl || cursor_kind == CXCursor_EnumDecl)
+        {
+            // Rejected before any USR or name is retrieved.
+            // For a namespace this skips everything declared inside it, a namespace that's reopened in an allowed file is visited again from there.
+            if (is_cursor_rejected(inner_cursor))
+            {
+                ++m_num_rejected_cursors;
+                return CXChildVisit_Continue;
+            }
+        }
+
         if (cursor_kind == CXCursor_StructDecl || cursor_kind == CXCursor_ClassDecl)
         {
+            std::string usr{};
+            if (clang_isCursorDefinition(inner_cursor) && is_declaration_processed(inner_cursor, usr)) { return CXChildVisit_Continue; }
+
             //dump_struct_or_class(inner_cursor);
             auto inner_cursor_spelling = clang_getCursorSpelling(inner_cursor);
             auto class_name = std::string{clang_getCString(inner_cursor_spelling)};
@@ -1422,6 +1836,7 @@ namespace RC::LuaWrapperGenerator
                 //printf_s("file: %s\n", clang_getCString(clang_getFileName(file)));
                 //printf_s("line: %i\n", line);
                 generate_lua_class(inner_cursor);
+                mark_declaration_as_processed(std::move(usr));
             }
             //else
             {
@@ -1466,11 +1881,14 @@ namespace RC::LuaWrapperGenerator
         }
         else if (cursor_kind == CXCursor_FunctionDecl)
         {
+            std::string usr{};
+            if (is_declaration_processed(inner_cursor, usr)) { return CXChildVisit_Continue; }
+
             //dump_static_member_function(inner_cursor);
             auto inner_cursor_spelling = clang_getCursorSpelling(inner_cursor);
             auto function_name = std::string{clang_getCString(inner_cursor_spelling)};
             clang_disposeString(inner_cursor_spelling);
-            auto function_scope = resolve_scope(inner_cursor);
+            const auto& function_scope = resolve_scope(inner_cursor);
             auto function_name_and_scope = function_scope + "::" + function_name;
 
             if (auto metamethod_it = m_out_of_line_custom_metamethod_functions.find(function_name_and_scope); metamethod_it != m_out_of_line_custom_metamethod_functions.end())
@@ -1483,6 +1901,7 @@ namespace RC::LuaWrapperGenerator
                 }
                 if (!function)
                 {
+                    // Not marked as processed, the class might exist the next time this function is seen.
                     return CXChildVisit_Continue;
                 }
             }
@@ -1496,6 +1915,7 @@ namespace RC::LuaWrapperGenerator
             {
                 generate_lua_free_function(inner_cursor);
             }
+            mark_declaration_as_processed(std::move(usr));
         }
         else if (cursor_kind == CXCursor_FunctionTemplate)
         {
@@ -1517,10 +1937,14 @@ namespace RC::LuaWrapperGenerator
         }
         else if (cursor_kind == CXCursor_EnumDecl)
         {
+            std::string usr{};
+            if (is_declaration_processed(inner_cursor, usr)) { return CXChildVisit_Continue; }
+            mark_declaration_as_processed(std::move(usr));
+
             auto inner_cursor_spelling = clang_getCursorSpelling(inner_cursor);
             auto enum_name = std::string{clang_getCString(inner_cursor_spelling)};
             clang_disposeString(inner_cursor_spelling);
-            auto enum_scope = resolve_scope(inner_cursor);
+            const auto& enum_scope = resolve_scope(inner_cursor);
             if (auto it = m_out_of_line_enums.find(enum_scope + "::" + enum_name); it != m_out_of_line_enums.end())
             {
                 auto [the_enum_it, was_inserted] = m_parser_output.get_container().enums.emplace(enum_scope + "::" + enum_name, Enum{
@@ -1556,6 +1980,26 @@ namespace RC::LuaWrapperGenerator
         return CXChildVisit_Continue;
     }
 
+    auto CodeParser::is_declaration_processed(const CXCursor& cursor, std::string& usr_out) -> bool
+    {
+        auto cursor_usr = clang_getCursorUSR(cursor);
+        usr_out = clang_getCString(cursor_usr);
+        clang_disposeString(cursor_usr);
+
+        if (!usr_out.empty() && m_processed_declarations.contains(usr_out))
+        {
+            ++m_num_skipped_declarations;
+            return true;
+        }
+        return false;
+    }
+
+    auto CodeParser::mark_declaration_as_processed(std::string&& usr) -> void
+    {
+        if (usr.empty()) { return; }
+        m_processed_declarations.emplace(std::move(usr));
+    }
+
     auto CodeParser::generator_internal_clang_wrapper(CXCursor inner_cursor, CXCursor outer_cursor, CXClientData self) -> CXChildVisitResult
     {
         return static_cast<CodeParser*>(self)->generate_internal(inner_cursor, outer_cursor);
@@ -1583,240 +2027,1588 @@ namespace RC::LuaWrapperGenerator
         return foundError;
     }
 
-    auto CodeParser::parse() -> const CodeGenerator&
-    {
-        double total_timer_dur{};
-        {
-            ScopedTimer total_timer(&total_timer_dur);
-            for (const auto& file : m_files_to_parse)
-            {
-                printf_s("Parsing file: %s\n", file.c_str());
-                double timer_dur{};
-                {
-                    ScopedTimer timer(&timer_dur);
+    // 'CXTranslationUnit_PrecompiledPreamble' isn't used because translation units are never reparsed so the preamble would be built and thrown away.
+    // Use a precompiled header to avoid parsing the shared headers for every file.
+    static constexpr unsigned int translation_unit_parse_options = CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_DetailedPreprocessingRecord | CXTranslationUnit_KeepGoing;
 
-                    auto translation_unit = clang_parseTranslationUnit(m_current_index, file.c_str(), m_compiler_flags, m_num_compiler_flags, nullptr, 0, CXTranslationUnit_SkipFunctionBodies | CXTranslationUnit_DetailedPreprocessingRecord | CXTranslationUnit_KeepGoing | CXTranslationUnit_PrecompiledPreamble);
-                    //if (printDiagnostics(translation_unit))
-                    //{
-                    //    continue;
-                    //}
+    auto static parse_scope_and_class(std::string_view fully_qualified_scope_and_name) -> std::pair<std::string, std::string>
+    {
+        std::string fully_qualified_scope{};
+        std::string class_name{};
 
-                    auto cursor = clang_getTranslationUnitCursor(translation_unit);
-                    Type::generate_static_class_types(m_parser_output.get_container());
+        auto scope_start = fully_qualified_scope_and_name.find_last_of(':');
+        if (scope_start != fully_qualified_scope_and_name.npos && scope_start + 1 <= fully_qualified_scope_and_name.size())
+        {
+            auto scope_end = fully_qualified_scope_and_name.rfind(':', scope_start);
+            fully_qualified_scope = fully_qualified_scope_and_name.substr(0, scope_end - 1);
+            class_name = fully_qualified_scope_and_name.substr(scope_start + 1);
+        }
+        else
+        {
+            fully_qualified_scope = "::";
+        }
+
+        return {fully_qualified_scope, class_name};
+    }
+
+    auto CodeParser::process_annotation_comment(std::string_view comment) -> void
+    {
+        Trace::Span span{"process_annotation_comment"};
+        const auto comment_parser = [&] {
+            Trace::Span comment_parser_span{"CommentParser"};
+            return CommentParser{comment};
+        }();
+        auto first_lua_type_attribute = comment_parser.get_attribute(CommentAttributeKind::LuaStateTypes);
+        if (!first_lua_type_attribute.exists()) { return; }
+
+        // A request is made for the lua state in its own 'CUSTOM_ATTRIBUTE[...]' block, or the first one in the comment if its block doesn't have one.
+        auto get_lua_state_type = [&](uint32_t block) {
+            for (const auto& attribute : comment_parser.get_attributes())
+            {
+                if (attribute.kind == CommentAttributeKind::LuaStateTypes && attribute.block == block)
+                {
+                    return std::string{CommentAttribute{&attribute}.get_param(0)};
+                }
+            }
+            return std::string{first_lua_type_attribute.get_param(0)};
+        };
+
+        for (const auto& attribute_container : comment_parser.get_attributes())
+        {
+            CommentAttribute attribute{&attribute_container};
+            switch (attribute_container.kind)
+            {
+                case CommentAttributeKind::LuaLate:
+                {
+                    if (attribute.num_params() < 2) { break; }
+                    auto lua_state_type = get_lua_state_type(attribute_container.block);
+                    auto type = attribute.get_param(0);
+                    if (type == "Class")
+                    {
+                        // CUSTOM_ATTRIBUTE[LuaLate(Class, ::RC::Unreal::UObjectBase)]
+                        // or
+                        // CUSTOM_ATTRIBUTE[LuaLate(Class, ::RC::Unreal::UObjectBase, ::)]
+
+                        auto scoped_class = std::string{attribute.get_param(1)};
+                        auto scope = attribute.has_param(2) ? std::string{attribute.get_param(2)} : parse_scope_and_class(scoped_class).first;
+                        //printf_s("Bindings requested out-of-line for class '%s' in lua state '%s'\n", scoped_class.c_str(), lua_state_type.c_str());
+                        m_out_of_line_class_requests.emplace(scoped_class, CustomClass{lua_state_type, scope});
+                    }
+                    else if (type == "FreeFunction")
+                    {
+                        // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject)]
+                        // or
+                        // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject, ::)]
+                        // or
+                        // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject, ::, UnscopedAlias)]
+
+                        auto scoped_function = std::string{attribute.get_param(1)};
+                        auto [function_scope, function_name] = parse_scope_and_class(scoped_function);
+                        auto scope_override = attribute.has_param(2) ? attribute.get_param(2) : std::string_view{};
+                        auto scope = !scope_override.empty() && scope_override != "_" ? std::string{scope_override} : function_scope;
+                        auto unscoped_alias = attribute.has_param(3) ? attribute.get_param(3) : std::string_view{};
+                        //printf_s("Bindings requested out-of-line for free-function '%s' in lua state '%s'\n", scoped_function.c_str(), lua_state_type.c_str());
+                        auto& function_data = m_out_of_line_free_function_requests.emplace(scoped_function, CustomFreeFunction{lua_state_type, scope}).first->second;
+
+                        function_data.names.emplace_back(unscoped_alias.empty() ? function_name : std::string{unscoped_alias});
+                    }
+                    else if (type == "CustomFreeFunction")
+                    {
+                        // CUSTOM_ATTRIBUTE[LuaLate(CustomFreeFunction, ::RC::WriteInt8, ::RC::function_wrapper_WriteInt8)]
+                        // or
+                        // CUSTOM_ATTRIBUTE[LuaLate(CustomFreeFunction, ::RC::WriteInt8, ::RC::function_wrapper_WriteInt8, ::)]
+
+                        auto scoped_function = attribute.get_param(1);
+                        auto [function_scope, function_name] = parse_scope_and_class(scoped_function);
+                        auto wrapper_scope_and_name = std::string{attribute.get_param(2)};
+                        auto scope = attribute.has_param(3) ? std::string{attribute.get_param(3)} : function_scope;
+                        //printf_s("Bindings requested out-of-line for free-function '%s' in lua state '%s'\n", scoped_function.c_str(), lua_state_type.c_str());
+                        auto& custom_function_entry = m_out_of_line_custom_free_function_requests[wrapper_scope_and_name];
+                        if (scope.empty()) { scope = "::"; }
+                        if (custom_function_entry.names.empty())
+                        {
+                            custom_function_entry.lua_state_type = lua_state_type;
+                            custom_function_entry.scope = scope;
+                            custom_function_entry.wrapper_name = wrapper_scope_and_name;
+                        }
+                        custom_function_entry.names.emplace_back(function_name);
+                    }
+                    else if (type == "Enum")
+                    {
+                        // CUSTOM_ATTRIBUTE[LuaLate(Enum, ::RC::LoopAction)]
+
+                        auto scoped_enum = std::string{attribute.get_param(1)};
+                        auto [enum_scope, enum_name] = parse_scope_and_class(scoped_enum);
+                        auto scope = attribute.has_param(2) ? std::string{attribute.get_param(2)} : enum_scope;
+                        m_out_of_line_enums.emplace(std::move(scoped_enum), std::pair{std::move(scope), std::move(enum_name)});
+                    }
+                    break;
+                }
+                case CommentAttributeKind::LuaAddMetamethod:
+                {
+                    // CUSTOM_ATTRIBUTE[LuaAddMetamethod(::RC::Unreal::UObjectBase, __index, ::RC::UObjectBase_metamethod_wrapper_Index)]
+
+                    if (attribute.num_params() < 3) { break; }
+                    auto in_scoped_class = attribute.get_param(0);
+                    auto metamethod_name = std::string{attribute.get_param(1)};
+                    auto wrapper_scope_and_name = std::string{attribute.get_param(2)};
+                    auto [fully_qualified_scope, in_class] = parse_scope_and_class(in_scoped_class);
+
+                    m_out_of_line_custom_metamethod_functions[wrapper_scope_and_name] = {in_class, metamethod_name, wrapper_scope_and_name, fully_qualified_scope};
+                    break;
+                }
+                case CommentAttributeKind::LuaMapTemplateClass:
+                {
+                    // CUSTOM_ATTRIBUTE[LuaMapTemplateClass(::RC::Unreal::TArray, ::RC::UnrealRuntimeTypes::Array)]
+
+                    if (attribute.num_params() < 2) { break; }
+                    auto original_templated_class = std::string{attribute.get_param(0)};
+                    auto non_templated_class = std::string{attribute.get_param(1)};
+
+                    m_out_of_line_template_class_map.emplace(original_templated_class, non_templated_class);
+                    break;
+                }
+                case CommentAttributeKind::LuaAddBaseToClass:
+                {
+                    // CUSTOM_ATTRIBUTE[LuaAddBaseToClass(::RC::Unreal::FObjectProperty, ::RC::Unreal::FObjectPropertyBase)]
+
+                    if (attribute.num_params() < 2) { break; }
+                    auto the_class = std::string{attribute.get_param(0)};
+                    auto the_base_class = std::string{attribute.get_param(1)};
+                    auto [fully_qualified_scope, in_class] = parse_scope_and_class(the_class);
+                    auto [fully_qualified_base_scope, in_base_class] = parse_scope_and_class(the_base_class);
+
+                    m_custom_base_classes[the_class].emplace_back(fully_qualified_base_scope, in_base_class);
+                    m_custom_base_classes_inverted[the_base_class].emplace_back(fully_qualified_scope, in_class);
+                    break;
+                }
+                case CommentAttributeKind::LuaMemberFunctionRedirector:
+                case CommentAttributeKind::LuaStaticMemberFunctionRedirector:
+                {
+                    // CUSTOM_ATTRIBUTE[LuaMemberFunctionRedirector(::RC::Unreal::UObjectBase, MyTestFunc, ::RC::UObjectBase_member_function_wrapper_MyTestFunc)]
+
+                    if (attribute.num_params() < 3) { break; }
+                    auto in_scoped_class = attribute.get_param(0);
+                    auto function_name = std::string{attribute.get_param(1)};
+                    auto wrapper_scope_and_name = std::string{attribute.get_param(2)};
+                    auto [fully_qualified_scope, in_class] = parse_scope_and_class(in_scoped_class);
+
+                    m_out_of_line_custom_member_function_requests[wrapper_scope_and_name] = {.in_class = in_class,
+                                                                                             .function_name = function_name,
+                                                                                             .wrapper_scope_and_name = wrapper_scope_and_name,
+                                                                                             .fully_qualified_scope = fully_qualified_scope,
+                                                                                             .is_static = attribute_container.kind == CommentAttributeKind::LuaStaticMemberFunctionRedirector};
+                    m_out_of_line_custom_member_function_names.emplace(std::format("{}::{}", in_scoped_class, function_name));
+
+                    //printf_s("Bindings requested out-of-line for custom member function '%s' in class '%s', mapped to '%s'\n", function_name.c_str(), in_scoped_class.c_str(), wrapper_scope_and_name.c_str());
+                    break;
+                }
+                default:
+                    break;
+            }
+        }
+    }
+
+    // Returns the offsets of the start and end of the comment that contains 'offset', or npos if 'offset' isn't in a comment.
+    // This only looks at the raw bytes so it can be fooled by comment markers inside string literals.
+    auto static find_enclosing_comment(std::string_view source, size_t offset) -> std::pair<size_t, size_t>
+    {
+        auto line_start = source.rfind('\n', offset);
+        line_start = line_start == source.npos ? 0 : line_start + 1;
+        if (auto line_comment = source.find("//", line_start); line_comment < offset)
+        {
+            auto line_end = source.find('\n', offset);
+            return {line_comment, line_end == source.npos ? source.size() : line_end};
+        }
+
+        auto block_comment_start = source.rfind("/*", offset);
+        if (block_comment_start == source.npos) { return {source.npos, source.npos}; }
+        if (auto previous_block_comment_end = source.rfind("*/", offset); previous_block_comment_end != source.npos && previous_block_comment_end > block_comment_start)
+        {
+            return {source.npos, source.npos};
+        }
+
+        auto block_comment_end = source.find("*/", offset);
+        return {block_comment_start, block_comment_end == source.npos ? source.size() : block_comment_end + 2};
+    }
+
+    auto CodeParser::is_under_code_root(std::string_view file) const -> bool
+    {
+        if (m_code_root.empty()) { return true; }
+
+        auto code_root = m_code_root.lexically_normal();
+        if (!code_root.has_filename()) { code_root = code_root.parent_path(); }
+        auto path = std::filesystem::path{file}.lexically_normal();
+        auto [code_root_it, _] = std::mismatch(code_root.begin(), code_root.end(), path.begin(), path.end());
+        return code_root_it == code_root.end();
+    }
+
+    auto CodeParser::is_cursor_rejected(const CXCursor& cursor) -> bool
+    {
+        if (!m_skip_system_headers && m_denied_path_prefixes.empty()) { return false; }
+
+        auto location = clang_getCursorLocation(cursor);
+        CXFile file{};
+        clang_getExpansionLocation(location, &file, nullptr, nullptr, nullptr);
+        if (!file) { return false; }
+
+        auto [it, inserted] = m_rejected_files.try_emplace(file, false);
+        if (!inserted) { return it->second; }
+
+        auto file_name_cxstring = clang_getFileName(file);
+        auto file_name = normalize_path_prefix(clang_getCString(file_name_cxstring));
+        clang_disposeString(file_name_cxstring);
+
+        auto is_under = [&](const std::vector<std::string>& prefixes) {
+            return std::ranges::any_of(prefixes, [&](const std::string& prefix) { return file_name.starts_with(prefix); });
+        };
+        if (is_under(m_allowed_path_prefixes)) { return false; }
+        it->second = (m_skip_system_headers && clang_Location_isInSystemHeader(location)) || is_under(m_denied_path_prefixes);
+        return it->second;
+    }
+
+    // Where the headers of a translation unit are looked up, in the order that they're searched.
+    struct IncludeDirectories
+    {
+        // Relative include directories and forced includes are relative to this.
+        std::filesystem::path working_directory{};
+        std::vector<std::filesystem::path> quote{};
+        std::vector<std::filesystem::path> user{};
+        std::vector<std::filesystem::path> system{};
+        // Headers that are included before the first line of the main file, with '-include' or '/FI'.
+        std::vector<std::string> forced_includes{};
+    };
+
+    static auto get_include_directories(const std::vector<const char*>& compiler_args) -> IncludeDirectories
+    {
+        enum class FlagKind { Quote, User, System, ForcedInclude, Ignored };
+        // '-include-pch' must come before '-include' since they're matched by prefix.
+        static constexpr std::pair<std::string_view, FlagKind> include_flags[]{
+                {"-iquote", FlagKind::Quote},
+                {"-isystem", FlagKind::System},
+                {"-idirafter", FlagKind::System},
+                {"-imsvc", FlagKind::System},
+                {"/imsvc", FlagKind::System},
+                {"-external:I", FlagKind::System},
+                {"/external:I", FlagKind::System},
+                {"-include-pch", FlagKind::Ignored},
+                {"-include", FlagKind::ForcedInclude},
+                {"-FI", FlagKind::ForcedInclude},
+                {"/FI", FlagKind::ForcedInclude},
+                {"-I", FlagKind::User},
+                {"/I", FlagKind::User},
+        };
+        static constexpr std::string_view working_directory_flag{"-working-directory="};
+
+        IncludeDirectories include_directories{std::filesystem::current_path()};
+        for (std::string_view compiler_arg : compiler_args)
+        {
+            if (compiler_arg.starts_with(working_directory_flag))
+            {
+                include_directories.working_directory = compiler_arg.substr(working_directory_flag.size());
+            }
+        }
+        auto to_directory = [&](std::string_view directory) {
+            std::filesystem::path path{directory};
+            return (path.is_relative() ? include_directories.working_directory / path : path).lexically_normal();
+        };
+
+        for (size_t arg_index = 0; arg_index < compiler_args.size(); ++arg_index)
+        {
+            std::string_view compiler_arg{compiler_args[arg_index]};
+            auto include_flag = std::ranges::find_if(include_flags, [&](const auto& flag) { return compiler_arg.starts_with(flag.first); });
+            if (include_flag == std::end(include_flags)) { continue; }
+
+            // The value is either part of the flag, like '-Iinclude', or the next argument, like '-I include'.
+            auto value = compiler_arg.substr(include_flag->first.size());
+            if (value.empty())
+            {
+                if (++arg_index == compiler_args.size()) { break; }
+                value = compiler_args[arg_index];
+            }
+
+            switch (include_flag->second)
+            {
+                case FlagKind::Quote: include_directories.quote.emplace_back(to_directory(value)); break;
+                case FlagKind::User: include_directories.user.emplace_back(to_directory(value)); break;
+                case FlagKind::System: include_directories.system.emplace_back(to_directory(value)); break;
+                case FlagKind::ForcedInclude: include_directories.forced_includes.emplace_back(value); break;
+                case FlagKind::Ignored: break;
+            }
+        }
+        return include_directories;
+    }
+
+    struct IncludeDirective
+    {
+        std::string_view header{};
+        bool is_angled{};
+    };
+
+    // Finds every '#include "header"' and '#include <header>' in 'source' without running the preprocessor.
+    // Conditional compilation isn't evaluated so a header that's only included in some configurations is still found.
+    // Includes of a macro can't be resolved this way and are skipped.
+    static auto find_include_directives(std::string_view source, std::vector<IncludeDirective>& include_directives) -> void
+    {
+        static constexpr std::string_view include_keyword{"include"};
+        static constexpr std::string_view whitespace{" \t"};
+
+        size_t line_start{};
+        while (line_start < source.size())
+        {
+            auto line_end = source.find('\n', line_start);
+            if (line_end == source.npos) { line_end = source.size(); }
+            auto line = source.substr(line_start, line_end - line_start);
+            line_start = line_end + 1;
+
+            auto offset = line.find_first_not_of(whitespace);
+            if (offset == line.npos || line[offset] != '#') { continue; }
+            offset = line.find_first_not_of(whitespace, offset + 1);
+            if (offset == line.npos || line.substr(offset, include_keyword.size()) != include_keyword) { continue; }
+            // This also rules out '#include_next'.
+            offset = line.find_first_not_of(whitespace, offset + include_keyword.size());
+            if (offset == line.npos || (line[offset] != '"' && line[offset] != '<')) { continue; }
+
+            auto is_angled = line[offset] == '<';
+            auto header_end = line.find(is_angled ? '>' : '"', offset + 1);
+            if (header_end == line.npos) { continue; }
+            include_directives.emplace_back(IncludeDirective{line.substr(offset + 1, header_end - offset - 1), is_angled});
+        }
+    }
+
+    struct ResolvedInclude
+    {
+        // Empty if the header couldn't be found.
+        std::filesystem::path header{};
+        // Found through '-isystem' or a similar flag.
+        bool is_system{};
+    };
+
+    // Looks the header up the same way as clang does, except for the directories that clang adds by itself which only contain system headers.
+    static auto resolve_include(const IncludeDirectories& include_directories, const std::filesystem::path& includer_directory, const IncludeDirective& include_directive) -> ResolvedInclude
+    {
+        auto find_in = [&](const std::filesystem::path& directory) -> std::optional<std::filesystem::path> {
+            std::error_code error_code{};
+            auto header = (directory / include_directive.header).lexically_normal();
+            if (std::filesystem::is_regular_file(header, error_code)) { return header; }
+            return std::nullopt;
+        };
+
+        if (!include_directive.is_angled)
+        {
+            if (auto header = find_in(includer_directory)) { return {std::move(*header)}; }
+            for (const auto& directory : include_directories.quote)
+            {
+                if (auto header = find_in(directory)) { return {std::move(*header)}; }
+            }
+        }
+        for (const auto& directory : include_directories.user)
+        {
+            if (auto header = find_in(directory)) { return {std::move(*header)}; }
+        }
+        for (const auto& directory : include_directories.system)
+        {
+            if (auto header = find_in(directory)) { return {std::move(*header), true}; }
+        }
+        return {};
+    }
+
+    auto CodeParser::read_project_files() const -> std::map<std::string, std::string>
+    {
+        std::map<std::string, std::string> project_files{};
+
+        // Most files share the same include directories so they're only worked out once per set of flags.
+        // A header is followed once per set of include directories since what it includes can depend on them.
+        std::unordered_map<uint64_t, IncludeDirectories> include_directories_by_flags{};
+        std::unordered_set<std::string> visited_files{};
+        // The same header is included from many files, the result of looking it up is reused for every file in the same directory.
+        std::unordered_map<std::string, ResolvedInclude> resolved_includes{};
+        struct PendingFile
+        {
+            std::filesystem::path file{};
+            uint64_t flags_hash{};
+        };
+        std::vector<PendingFile> pending_files{};
+
+        auto add_main_file = [&](const std::string& file, const std::vector<const char*>& compiler_args) {
+            Hasher hasher{};
+            for (const auto& compiler_arg : compiler_args)
+            {
+                hasher.update(std::string_view{compiler_arg});
+            }
+            auto flags_hash = hasher.get();
+            auto [it, inserted] = include_directories_by_flags.try_emplace(flags_hash);
+            if (inserted) { it->second = get_include_directories(compiler_args); }
+
+            pending_files.emplace_back(PendingFile{normalize_file_path(file), flags_hash});
+            for (const auto& forced_include : it->second.forced_includes)
+            {
+                if (auto resolved_include = resolve_include(it->second, it->second.working_directory, {forced_include}); !resolved_include.header.empty())
+                {
+                    pending_files.emplace_back(PendingFile{std::move(resolved_include.header), flags_hash});
+                }
+            }
+        };
+        for (const auto& file : m_files_to_parse)
+        {
+            add_main_file(file, get_compiler_args(file));
+        }
+        // The headers of the precompiled header are part of every translation unit.
+        for (const auto& header : m_precompiled_header_sources)
+        {
+            add_main_file(header, {m_compiler_flags, m_compiler_flags + m_num_compiler_flags});
+        }
+
+        std::vector<IncludeDirective> include_directives{};
+        while (!pending_files.empty())
+        {
+            auto pending_file = std::move(pending_files.back());
+            pending_files.pop_back();
+            auto file = pending_file.file.string();
+            if (!visited_files.emplace(std::format("{:016x}{}", pending_file.flags_hash, file)).second) { continue; }
+
+            auto [project_file, inserted] = project_files.try_emplace(file);
+            if (inserted) { project_file->second = read_source_file(pending_file.file); }
+
+            const auto& include_directories = include_directories_by_flags[pending_file.flags_hash];
+            auto includer_directory = pending_file.file.parent_path();
+            include_directives.clear();
+            find_include_directives(project_file->second, include_directives);
+            for (const auto& include_directive : include_directives)
+            {
+                auto resolved_include_key = std::format("{:016x}{}{}", pending_file.flags_hash, include_directive.is_angled ? std::string{"<"} : includer_directory.string() + '"', include_directive.header);
+                auto [resolved_include, is_new] = resolved_includes.try_emplace(std::move(resolved_include_key));
+                if (is_new) { resolved_include->second = resolve_include(include_directories, includer_directory, include_directive); }
+                const auto& [header, is_system] = resolved_include->second;
+                if (header.empty()) { continue; }
+
+                // With a code root, the project is everything under it.
+                // Without one, the project is every header that isn't found through a system include directory.
+                if (!m_code_root.empty() ? !is_under_code_root(header.string()) : is_system) { continue; }
+                pending_files.emplace_back(PendingFile{header, pending_file.flags_hash});
+            }
+        }
+
+        return project_files;
+    }
+
+    auto CodeParser::collect_annotation_requests() -> void
+    {
+        Trace::Span span{"collect_annotation_requests"};
+
+        double timer_dur{};
+        size_t num_files{};
+        size_t num_comments{};
+        {
+            ScopedTimer timer(&timer_dur);
+
+            // Sorted by path so that conflicting requests are resolved the same way on every run.
+            auto project_files = read_project_files();
+            num_files = project_files.size();
+
+            // The raw bytes are used instead of tokenizing since there's no translation unit yet.
+            // A tag inside a string literal that looks like it's in a comment would be picked up, but that's not something the project does.
+            Hasher hasher{};
+            for (const auto& [file, source] : project_files)
+            {
+                m_project_files.emplace(file);
+                for (auto tag_offset = source.find(custom_attribute_tag); tag_offset != source.npos; tag_offset = source.find(custom_attribute_tag, tag_offset))
+                {
+                    auto [comment_start, comment_end] = find_enclosing_comment(source, tag_offset);
+                    if (comment_start == source.npos)
+                    {
+                        tag_offset += custom_attribute_tag.size();
+                        continue;
+                    }
+
+                    auto comment = std::string_view{source}.substr(comment_start, comment_end - comment_start);
+                    if (comment.ends_with('\r')) { comment.remove_suffix(1); }
+                    hasher.update(comment);
+                    ++num_comments;
+                    process_annotation_comment(comment);
+
+                    tag_offset = comment_end;
+                }
+            }
+
+            m_annotation_requests_hash = hasher.get();
+            m_has_collected_annotation_requests = true;
+        }
+        printf_s("Collecting annotations from %zu project files took %f seconds, %zu comments found.\n", num_files, timer_dur, num_comments);
+    }
+
+    auto CodeParser::process_translation_unit(CXTranslationUnit translation_unit) -> void
+    {
+        // Every request is collected before the first translation unit is parsed, so the output of a file doesn't depend on which files were parsed before it or by which worker.
+        if (!m_has_collected_annotation_requests)
+        {
+            throw std::runtime_error{"Annotation requests must be collected before a translation unit is visited"};
+        }
+
+        resolved_scopes.clear();
+        // Whether a class is only forward declared depends on what the translation unit includes, so a type converted in another one can't be reused.
+        m_converted_types.clear();
+        auto cursor = clang_getTranslationUnitCursor(translation_unit);
+        m_rejected_files.clear();
+        {
+            Trace::Span span{"clang_visitChildren"};
+            clang_visitChildren(cursor, &CodeParser::generator_internal_clang_wrapper, this);
+        }
+
+        for (auto& [member_function_wrapper_name, member_function] : m_custom_member_functions_to_generate)
+        {
+            auto* the_class = m_parser_output.get_container().find_mutable_class_by_name(member_function.data.fully_qualified_scope, member_function.data.in_class);
+            auto& function = member_function.function_container.begin()->second;
+            function.set_parent_name(the_class->name);
+            function.set_parent_scope(the_class->fully_qualified_scope);
+            function.set_containing_class(the_class);
+            function.set_is_static(member_function.data.is_static);
+            if (member_function.data.is_static)
+            {
+                the_class->static_functions.emplace(function.get_name(), std::move(function));
+            }
+            else
+            {
+                the_class->container.functions.emplace(function.get_name(), std::move(function));
+            }
+        }
+
+        m_custom_member_functions_to_generate.clear();
+    }
+
+    auto CodeParser::parse_file(const std::string& file) -> double
+    {
+        printf_s("Parsing file: %s\n", file.c_str());
+        Trace::Span span{"parse_file", file};
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+
+            auto compiler_args = get_compiler_args(file);
+            CXTranslationUnit translation_unit{};
+            {
+                Trace::Span parse_span{"clang_parseTranslationUnit"};
+                translation_unit = clang_parseTranslationUnit(m_current_index, file.c_str(), compiler_args.data(), static_cast<int>(compiler_args.size()), nullptr, 0, translation_unit_parse_options);
+            }
+            //if (printDiagnostics(translation_unit))
+            //{
+            //    continue;
+            //}
+
+            process_translation_unit(translation_unit);
+
+            if (m_parse_cache)
+            {
+                collect_include_closure(translation_unit, file);
+            }
+
+            clang_disposeTranslationUnit(translation_unit);
+        }
+        printf_s("Parsing file took %f seconds, %zu declarations were skipped because they were already processed.\n", timer_dur, m_num_skipped_declarations);
+        printf_s("Visited %zu cursors, %zu were rejected by their location.\n", m_num_visited_cursors, m_num_rejected_cursors);
+        m_num_skipped_declarations = 0;
+        m_num_visited_cursors = 0;
+        m_num_rejected_cursors = 0;
+        return timer_dur;
+    }
+
+    // Returns the main files that are responsible for errors caused by combining them into one translation unit.
+    // Only errors that are typical for unity builds are considered, like two files defining the same static function.
+    // The errors are printed since they're otherwise silently hidden by 'CXTranslationUnit_KeepGoing'.
+    auto static find_unity_collisions(CXTranslationUnit translation_unit) -> std::unordered_set<std::string>
+    {
+        static constexpr std::string_view collision_messages[]{
+                "redefinition of",
+                "conflicting types",
+                "conflicting declaration",
+                "is ambiguous",
+                "different kind of symbol",
+        };
+
+        // Included file -> the main file that included it, directly or indirectly.
+        std::unordered_map<std::string, std::string> main_file_by_included_file{};
+        clang_getInclusions(translation_unit, [](CXFile included_file, CXSourceLocation* inclusion_stack, unsigned int include_depth, CXClientData data) {
+            if (include_depth == 0) { return; }
+
+            auto included_file_name = clang_getFileName(included_file);
+            std::string main_file_name = clang_getCString(included_file_name);
+            clang_disposeString(included_file_name);
+
+            auto key = main_file_name;
+            if (include_depth > 1)
+            {
+                // The last entry is the #include in the synthetic file, the one before that is in the main file.
+                CXFile main_file{};
+                clang_getSpellingLocation(inclusion_stack[include_depth - 2], &main_file, nullptr, nullptr, nullptr);
+                auto main_file_name_string = clang_getFileName(main_file);
+                main_file_name = clang_getCString(main_file_name_string);
+                clang_disposeString(main_file_name_string);
+            }
+
+            static_cast<std::unordered_map<std::string, std::string>*>(data)->emplace(std::move(key), std::move(main_file_name));
+        }, &main_file_by_included_file);
+
+        std::unordered_set<std::string> colliding_files{};
+        auto num_diagnostics = clang_getNumDiagnostics(translation_unit);
+        for (unsigned int i = 0; i < num_diagnostics; ++i)
+        {
+            auto diagnostic = clang_getDiagnostic(translation_unit, i);
+            if (clang_getDiagnosticSeverity(diagnostic) >= CXDiagnostic_Error)
+            {
+                auto diagnostic_spelling = clang_getDiagnosticSpelling(diagnostic);
+                std::string_view message{clang_getCString(diagnostic_spelling)};
+                auto is_collision = std::ranges::any_of(collision_messages, [&](std::string_view collision_message) { return message.find(collision_message) != message.npos; });
+                clang_disposeString(diagnostic_spelling);
+
+                if (is_collision)
+                {
+                    auto formatted_diagnostic = clang_formatDiagnostic(diagnostic, clang_defaultDiagnosticDisplayOptions());
+                    printf_s("Unity collision: %s\n", clang_getCString(formatted_diagnostic));
+                    clang_disposeString(formatted_diagnostic);
+
+                    CXFile file{};
+                    clang_getSpellingLocation(clang_getDiagnosticLocation(diagnostic), &file, nullptr, nullptr, nullptr);
+                    auto file_name_string = clang_getFileName(file);
+                    std::string file_name = clang_getCString(file_name_string) ? clang_getCString(file_name_string) : "";
+                    clang_disposeString(file_name_string);
+
+                    auto main_file = main_file_by_included_file.find(file_name);
+                    colliding_files.emplace(main_file != main_file_by_included_file.end() ? main_file->second : file_name);
+                }
+            }
+            clang_disposeDiagnostic(diagnostic);
+        }
+
+        return colliding_files;
+    }
+
+    auto CodeParser::parse_unity() -> void
+    {
+        // The synthetic file doesn't exist on disk, it's passed to libclang as an unsaved file.
+        auto unity_file_name = (m_code_root / "LuaWrapperGeneratorUnity.cpp").string();
+        // The files are included with forward slashes which is also how libclang reports them back.
+        auto as_include_path = [](const std::string& file) { return std::filesystem::path{file}.generic_string(); };
+
+        std::vector<std::string> files_to_unify = m_files_to_parse;
+        // There's only one translation unit so it can only have one set of flags, the flags of the first file are used for all of them.
+        auto compiler_args = get_compiler_args(m_files_to_parse.front());
+        CXTranslationUnit translation_unit{};
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+
+            // Files that collide are removed one round at a time until the remaining files can be parsed together.
+            while (files_to_unify.size() > 1)
+            {
+                std::string unity_source{};
+                for (const auto& file : files_to_unify)
+                {
+                    unity_source.append(std::format("#include \"{}\"\n", as_include_path(file)));
+                }
+
+                CXUnsavedFile unity_file{unity_file_name.c_str(), unity_source.c_str(), static_cast<unsigned long>(unity_source.size())};
+                printf_s("Parsing %zu files as one translation unit\n", files_to_unify.size());
+                {
+                    Trace::Span parse_span{"clang_parseTranslationUnit", std::format("{} files as one translation unit", files_to_unify.size())};
+                    translation_unit = clang_parseTranslationUnit(m_current_index, unity_file_name.c_str(), compiler_args.data(), static_cast<int>(compiler_args.size()), &unity_file, 1, translation_unit_parse_options);
+                }
+                if (!translation_unit) { break; }
+
+                auto colliding_files = find_unity_collisions(translation_unit);
+                if (colliding_files.empty()) { break; }
+
+                clang_disposeTranslationUnit(translation_unit);
+                translation_unit = nullptr;
+
+                auto num_files_before = files_to_unify.size();
+                std::erase_if(files_to_unify, [&](const std::string& file) { return colliding_files.contains(as_include_path(file)); });
+                // The collisions couldn't be traced back to any of the files, give up on unity mode entirely.
+                if (files_to_unify.size() == num_files_before) { break; }
+            }
+
+            if (translation_unit)
+            {
+                process_translation_unit(translation_unit);
+                clang_disposeTranslationUnit(translation_unit);
+            }
+            else
+            {
+                files_to_unify.clear();
+            }
+        }
+        printf_s("Unity parse of %zu files took %f seconds, %zu declarations were skipped because they were already processed.\n", files_to_unify.size(), timer_dur, m_num_skipped_declarations);
+        printf_s("Visited %zu cursors, %zu were rejected by their location.\n", m_num_visited_cursors, m_num_rejected_cursors);
+        m_num_skipped_declarations = 0;
+        m_num_visited_cursors = 0;
+        m_num_rejected_cursors = 0;
+
+        for (const auto& file : m_files_to_parse)
+        {
+            if (std::ranges::find(files_to_unify, file) != files_to_unify.end()) { continue; }
+            printf_s("File can't be part of the unity translation unit: %s\n", file.c_str());
+            parse_file(file);
+        }
+
+        apply_custom_base_classes();
+    }
+
+    auto CodeParser::merge_worker_output(CodeParser& worker) -> void
+    {
+        m_parser_output.merge_partial_output(worker.m_parser_output);
+
+        // The workers were given a copy of every request so there's nothing new to merge.
+        // Only parsers that merge output they didn't parse themselves, like 'merge_shards', take the custom bases from that output.
+        if (m_has_collected_annotation_requests) { return; }
+
+        for (auto& [class_scope_and_name, bases] : worker.m_custom_base_classes)
+        {
+            auto& merged_bases = m_custom_base_classes[class_scope_and_name];
+            merged_bases.insert(merged_bases.end(), bases.begin(), bases.end());
+        }
+    }
+
+    auto CodeParser::apply_custom_base_classes() -> void
+    {
+        // A worker can only apply custom bases to classes that it generated itself.
+        // Now that everything has been merged, apply them again so that bases generated by other workers are included.
+        auto& container = m_parser_output.get_container();
+        for (const auto& [class_scope_and_name, bases] : m_custom_base_classes)
+        {
+            auto it = container.classes.find(class_scope_and_name);
+            if (it == container.classes.end())
+            {
+                it = container.thin_classes.find(class_scope_and_name);
+                if (it == container.thin_classes.end()) { continue; }
+            }
+
+            for (const auto& [base_class_scope, base_class_name] : bases)
+            {
+                if (auto base = container.find_class_by_name(base_class_scope, base_class_name); base && base != &it->second)
+                {
+                    it->second.add_base(base);
+                }
+            }
+        }
+    }
+
+    auto CodeParser::for_each_file(size_t num_workers, const std::function<void(size_t worker_index, size_t file_index)>& callable) -> void
+    {
+        if (num_workers <= 1)
+        {
+            for (size_t file_index = 0; file_index < m_files_to_parse.size(); ++file_index)
+            {
+                callable(0, file_index);
+            }
+            return;
+        }
+
+        // Files are handed out one at a time so that a worker that gets a few cheap files can pick up more work.
+        std::atomic<size_t> next_file{};
+        std::mutex exception_mutex{};
+        std::exception_ptr worker_exception{};
+        std::vector<std::thread> threads{};
+        for (size_t worker_index = 0; worker_index < num_workers; ++worker_index)
+        {
+            threads.emplace_back([&, worker_index] {
+                Trace::set_thread_name(std::format("Worker {}", worker_index));
+                try
+                {
+                    for (auto schedule_index = next_file++; schedule_index < m_files_to_parse.size(); schedule_index = next_file++)
+                    {
+                        callable(worker_index, m_file_schedule.empty() ? schedule_index : m_file_schedule[schedule_index]);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock{exception_mutex};
+                    if (!worker_exception) { worker_exception = std::current_exception(); }
+                    // Make the other workers stop after their current file.
+                    next_file = m_files_to_parse.size();
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        if (worker_exception) { std::rethrow_exception(worker_exception); }
+    }
+
+    auto CodeParser::parse_files_in_parallel() -> void
+    {
+        auto num_workers = std::max(size_t{1}, std::min(m_num_jobs, m_files_to_parse.size()));
+        printf_s("Parsing %zu files with %zu workers\n", m_files_to_parse.size(), num_workers);
+
+        // Declarations are only skipped if they were already processed in the same file, every file's output is complete on its own.
+        std::vector<std::unique_ptr<CodeParser>> file_outputs(m_files_to_parse.size());
+        for_each_file(num_workers, [&](size_t, size_t file_index) {
+            file_outputs[file_index].reset(new CodeParser{m_parser_output, *this});
+            m_file_parse_durations[file_index] = file_outputs[file_index]->parse_file(m_files_to_parse[file_index]);
+        });
+
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+            Trace::Span span{"merge_worker_output"};
+            // Merged in file order, not in the order the files were finished in.
+            for (auto& file_output : file_outputs)
+            {
+                merge_worker_output(*file_output);
+            }
+            apply_custom_base_classes();
+            m_parser_output.rebuild_function_proto_container();
+        }
+        printf_s("Merging worker output took %f seconds.\n", timer_dur);
+    }
+
+    auto CodeParser::collect_include_closure(CXTranslationUnit translation_unit, const std::string& file) -> void
+    {
+        Trace::Span span{"collect_include_closure"};
+        // The main file is hashed separately.
+        m_include_closure = get_included_files(translation_unit);
+
+        // The contents of the precompiled header affect the output just like a header would.
+        if (auto precompiled_header = get_precompiled_header(file))
+        {
+            m_include_closure.emplace_back(*precompiled_header);
+        }
+
+        std::ranges::sort(m_include_closure);
+        auto duplicates = std::ranges::unique(m_include_closure);
+        m_include_closure.erase(duplicates.begin(), duplicates.end());
+    }
+
+    auto CodeParser::get_compiler_flags_hash(const std::string& file) const -> uint64_t
+    {
+        Hasher hasher{};
+        // Fragments contain type patch indexes so a different set of type patches must not reuse them.
+        hasher.update(static_cast<uint64_t>(binding_ir_version));
+        hasher.update(static_cast<uint64_t>(m_type_patches.size()));
+        // Cache entries don't store any requests, every file is parsed with the requests that were collected up front.
+        // Since an annotation in any file can change the output of every other file, an entry can only be used with the same requests.
+        hasher.update(m_annotation_requests_hash);
+        hasher.update(std::string_view{"fragment without requests"});
+        hasher.update(static_cast<uint64_t>(m_skip_system_headers));
+        for (const auto& prefix : m_allowed_path_prefixes)
+        {
+            hasher.update(std::string_view{"+"});
+            hasher.update(std::string_view{prefix});
+        }
+        for (const auto& prefix : m_denied_path_prefixes)
+        {
+            hasher.update(std::string_view{"-"});
+            hasher.update(std::string_view{prefix});
+        }
+        for (const auto& compiler_arg : get_compiler_args(file))
+        {
+            hasher.update(std::string_view{compiler_arg});
+        }
+        return hasher.get();
+    }
+
+    static auto write_custom_free_function(IRWriter& writer, const CustomFreeFunction& custom_free_function) -> void
+    {
+        writer.write_string(custom_free_function.lua_state_type);
+        writer.write_string(custom_free_function.scope);
+        writer.write_string(custom_free_function.wrapper_name);
+        writer.write_u32(static_cast<uint32_t>(custom_free_function.names.size()));
+        for (const auto& name : custom_free_function.names)
+        {
+            writer.write_string(name);
+        }
+    }
+
+    static auto read_custom_free_function(IRReader& reader) -> CustomFreeFunction
+    {
+        CustomFreeFunction custom_free_function{};
+        custom_free_function.lua_state_type = reader.read_string();
+        custom_free_function.scope = reader.read_string();
+        custom_free_function.wrapper_name = reader.read_string();
+        auto num_names = reader.read_u32();
+        for (uint32_t i = 0; i < num_names; ++i)
+        {
+            custom_free_function.names.emplace_back(reader.read_string());
+        }
+        return custom_free_function;
+    }
 
-                    auto token_range = clang_getCursorExtent(cursor);
-                    CXToken* tokens{};
-                    unsigned int num_tokens{};
-                    clang_tokenize(translation_unit, token_range, &tokens, &num_tokens);
-                    for (unsigned int i = 0; i < num_tokens; ++i)
-                    {
-                        const auto& token = tokens[i];
-                        const auto token_kind = clang_getTokenKind(token);
+    static auto write_custom_member_function(IRWriter& writer, const CustomMemberFunction& custom_member_function) -> void
+    {
+        writer.write_string(custom_member_function.in_class);
+        writer.write_string(custom_member_function.function_name);
+        writer.write_string(custom_member_function.wrapper_scope_and_name);
+        writer.write_string(custom_member_function.fully_qualified_scope);
+        writer.write_bool(custom_member_function.is_static);
+    }
 
-                        if (token_kind != CXTokenKind::CXToken_Comment) { continue; }
+    static auto read_custom_member_function(IRReader& reader) -> CustomMemberFunction
+    {
+        CustomMemberFunction custom_member_function{};
+        custom_member_function.in_class = reader.read_string();
+        custom_member_function.function_name = reader.read_string();
+        custom_member_function.wrapper_scope_and_name = reader.read_string();
+        custom_member_function.fully_qualified_scope = reader.read_string();
+        custom_member_function.is_static = reader.read_bool();
+        return custom_member_function;
+    }
 
-                        auto token_spelling = clang_getTokenSpelling(translation_unit, token);
-                        auto token_contents = std::string{clang_getCString(token_spelling)};
-                        clang_disposeString(token_spelling);
-                        //printf_s("Token kind: %i\n", token_kind);
-                        //printf_s("Token spelling: %s\n", token_contents);
+    // Writes any map of 'std::string' -> T, 'write_value' writes a single T.
+    static auto write_request_map(IRWriter& writer, const auto& map, auto write_value) -> void
+    {
+        writer.write_u32(static_cast<uint32_t>(map.size()));
+        for (const auto& [key, value] : map)
+        {
+            writer.write_string(key);
+            write_value(writer, value);
+        }
+    }
 
-                        auto parse_scope_and_class = [](std::string_view fully_qualified_scope_and_name) -> std::pair<std::string, std::string> {
-                            std::string fully_qualified_scope{};
-                            std::string class_name{};
+    static auto read_request_map(IRReader& reader, auto& map, auto read_value) -> void
+    {
+        auto num_entries = reader.read_u32();
+        for (uint32_t i = 0; i < num_entries; ++i)
+        {
+            auto key = reader.read_string();
+            map.emplace(std::move(key), read_value(reader));
+        }
+    }
 
-                            auto scope_start = fully_qualified_scope_and_name.find_last_of(':');
-                            if (scope_start != fully_qualified_scope_and_name.npos && scope_start + 1 <= fully_qualified_scope_and_name.size())
-                            {
-                                auto scope_end = fully_qualified_scope_and_name.rfind(':', scope_start);
-                                fully_qualified_scope = fully_qualified_scope_and_name.substr(0, scope_end - 1);
-                                class_name = fully_qualified_scope_and_name.substr(scope_start + 1);
-                            }
-                            else
-                            {
-                                fully_qualified_scope = "::";
-                            }
+    static auto write_scope_and_name_pairs(IRWriter& writer, const std::vector<std::pair<std::string, std::string>>& pairs) -> void
+    {
+        writer.write_u32(static_cast<uint32_t>(pairs.size()));
+        for (const auto& [scope, name] : pairs)
+        {
+            writer.write_string(scope);
+            writer.write_string(name);
+        }
+    }
 
-                            return {fully_qualified_scope, class_name};
-                        };
+    static auto read_scope_and_name_pairs(IRReader& reader) -> std::vector<std::pair<std::string, std::string>>
+    {
+        std::vector<std::pair<std::string, std::string>> pairs{};
+        auto num_pairs = reader.read_u32();
+        for (uint32_t i = 0; i < num_pairs; ++i)
+        {
+            auto scope = reader.read_string();
+            pairs.emplace_back(std::move(scope), reader.read_string());
+        }
+        return pairs;
+    }
 
-                        CommentParser comment_parser{token_contents};
-                        if (auto lua_type_attribute = comment_parser.get_attribute("LuaStateTypes"); lua_type_attribute.exists())
-                        {
-                            auto lua_state_type = lua_type_attribute.get_param(0);
-                            if (auto attribute = comment_parser.get_attribute("LuaLate"); attribute.exists() && attribute.num_params() >= 2)
-                            {
-                                auto type = attribute.get_param(0);
-                                if (type == "Class")
-                                {
-                                    // CUSTOM_ATTRIBUTE[LuaLate(Class, ::RC::Unreal::UObjectBase)]
-                                    // or
-                                    // CUSTOM_ATTRIBUTE[LuaLate(Class, ::RC::Unreal::UObjectBase, ::)]
-
-                                    auto scoped_class = attribute.get_param(1);
-                                    auto scope = attribute.has_param(2) ? attribute.get_param(2) : parse_scope_and_class(scoped_class).first;
-                                    //printf_s("Bindings requested out-of-line for class '%s' in lua state '%s'\n", scoped_class.c_str(), lua_state_type.c_str());
-                                    m_out_of_line_class_requests.emplace(scoped_class, CustomClass{lua_state_type, scope});
-                                }
-                                else if (type == "FreeFunction")
-                                {
-                                    // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject)]
-                                    // or
-                                    // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject, ::)]
-                                    // or
-                                    // CUSTOM_ATTRIBUTE[LuaLate(FreeFunction, ::RC::Unreal::UObjectGlobals::FindObject, ::, UnscopedAlias)]
-
-                                    auto scoped_function = attribute.get_param(1);
-                                    auto [function_scope, function_name] = parse_scope_and_class(scoped_function);
-                                    auto scope_override = attribute.has_param(2) ? attribute.get_param(2) : std::string{};
-                                    auto scope = !scope_override.empty() && scope_override != "_" ? scope_override : function_scope;
-                                    auto unscoped_alias = attribute.has_param(3) ? attribute.get_param(3) : std::string{};
-                                    //printf_s("Bindings requested out-of-line for free-function '%s' in lua state '%s'\n", scoped_function.c_str(), lua_state_type.c_str());
-                                    auto& function_data = m_out_of_line_free_function_requests.emplace(scoped_function, CustomFreeFunction{lua_state_type, scope}).first->second;
-
-                                    function_data.names.emplace_back(unscoped_alias.empty() ? function_name : unscoped_alias);
-                                }
-                                else if (type == "CustomFreeFunction")
-                                {
-                                    // CUSTOM_ATTRIBUTE[LuaLate(CustomFreeFunction, ::RC::WriteInt8, ::RC::function_wrapper_WriteInt8)]
-                                    // or
-                                    // CUSTOM_ATTRIBUTE[LuaLate(CustomFreeFunction, ::RC::WriteInt8, ::RC::function_wrapper_WriteInt8, ::)]
-
-                                    auto scoped_function = attribute.get_param(1);
-                                    auto [function_scope, function_name] = parse_scope_and_class(scoped_function);
-                                    auto wrapper_scope_and_name = attribute.get_param(2);
-                                    auto scope = attribute.has_param(3) ? attribute.get_param(3) : function_scope;
-                                    //printf_s("Bindings requested out-of-line for free-function '%s' in lua state '%s'\n", scoped_function.c_str(), lua_state_type.c_str());
-                                    auto& custom_function_entry = m_out_of_line_custom_free_function_requests[wrapper_scope_and_name];
-                                    if (scope.empty()) { scope = "::"; }
-                                    if (custom_function_entry.names.empty())
-                                    {
-                                        custom_function_entry.lua_state_type = lua_state_type;
-                                        custom_function_entry.scope = scope;
-                                        custom_function_entry.wrapper_name = wrapper_scope_and_name;
-                                    }
-                                    custom_function_entry.names.emplace_back(function_name);
-                                }
-                                else if (type == "Enum")
-                                {
-                                    // CUSTOM_ATTRIBUTE[LuaLate(Enum, ::RC::LoopAction)]
+    auto CodeParser::write_annotation_requests(IRWriter& writer) const -> void
+    {
+        write_request_map(writer, m_out_of_line_class_requests, write_custom_free_function);
+        write_request_map(writer, m_out_of_line_free_function_requests, write_custom_free_function);
+        write_request_map(writer, m_out_of_line_custom_free_function_requests, write_custom_free_function);
+        write_request_map(writer, m_out_of_line_custom_member_function_requests, write_custom_member_function);
+        write_request_map(writer, m_out_of_line_custom_metamethod_functions, write_custom_member_function);
+        writer.write_u32(static_cast<uint32_t>(m_out_of_line_custom_member_function_names.size()));
+        for (const auto& name : m_out_of_line_custom_member_function_names)
+        {
+            writer.write_string(name);
+        }
+        write_request_map(writer, m_out_of_line_template_class_map, [](IRWriter& writer, const std::string& value) {
+            writer.write_string(value);
+        });
+        write_request_map(writer, m_custom_base_classes, write_scope_and_name_pairs);
+        write_request_map(writer, m_custom_base_classes_inverted, write_scope_and_name_pairs);
+        write_request_map(writer, m_out_of_line_enums, [](IRWriter& writer, const std::pair<std::string, std::string>& value) {
+            writer.write_string(value.first);
+            writer.write_string(value.second);
+        });
+    }
 
-                                    auto scoped_enum = attribute.get_param(1);
-                                    auto [enum_scope, enum_name] = parse_scope_and_class(scoped_enum);
-                                    auto scope = attribute.has_param(2) ? attribute.get_param(2) : enum_scope;
-                                    m_out_of_line_enums.emplace(std::move(scoped_enum), std::pair{std::move(scope), std::move(enum_name)});
-                                }
-                            }
-                            else if (auto attribute = comment_parser.get_attribute("LuaAddMetamethod"); attribute.exists() && attribute.num_params() >= 3)
-                            {
-                                // CUSTOM_ATTRIBUTE[LuaAddMetamethod(::RC::Unreal::UObjectBase, __index, ::RC::UObjectBase_metamethod_wrapper_Index)]
+    auto CodeParser::read_annotation_requests(IRReader& reader) -> void
+    {
+        read_request_map(reader, m_out_of_line_class_requests, read_custom_free_function);
+        read_request_map(reader, m_out_of_line_free_function_requests, read_custom_free_function);
+        read_request_map(reader, m_out_of_line_custom_free_function_requests, read_custom_free_function);
+        read_request_map(reader, m_out_of_line_custom_member_function_requests, read_custom_member_function);
+        read_request_map(reader, m_out_of_line_custom_metamethod_functions, read_custom_member_function);
+        auto num_names = reader.read_u32();
+        for (uint32_t i = 0; i < num_names; ++i)
+        {
+            m_out_of_line_custom_member_function_names.emplace(reader.read_string());
+        }
+        read_request_map(reader, m_out_of_line_template_class_map, [](IRReader& reader) {
+            return reader.read_string();
+        });
+        read_request_map(reader, m_custom_base_classes, read_scope_and_name_pairs);
+        read_request_map(reader, m_custom_base_classes_inverted, read_scope_and_name_pairs);
+        read_request_map(reader, m_out_of_line_enums, [](IRReader& reader) {
+            auto scope = reader.read_string();
+            return std::pair{std::move(scope), reader.read_string()};
+        });
+    }
+
+    auto CodeParser::write_fragment(WithAnnotationRequests with_annotation_requests) const -> std::string
+    {
+        IRWriter writer{m_type_patches};
+        writer.write_container(m_parser_output.get_container());
+        if (with_annotation_requests == WithAnnotationRequests::Yes)
+        {
+            write_annotation_requests(writer);
+        }
+        return writer.finish();
+    }
 
-                                auto in_scoped_class = attribute.get_param(0);
-                                auto metamethod_name = attribute.get_param(1);
-                                auto wrapper_scope_and_name = attribute.get_param(2);
-                                auto [fully_qualified_scope, in_class] = parse_scope_and_class(in_scoped_class);
+    auto CodeParser::read_fragment(std::string_view fragment, WithAnnotationRequests with_annotation_requests) -> void
+    {
+        IRReader reader{fragment, &m_parser_output};
+        reader.read_container();
+        if (with_annotation_requests == WithAnnotationRequests::Yes)
+        {
+            read_annotation_requests(reader);
+        }
+        if (!reader.is_at_end())
+        {
+            throw std::runtime_error{"Unexpected data at the end of the fragment"};
+        }
+    }
 
-                                m_out_of_line_custom_metamethod_functions[wrapper_scope_and_name] = {in_class, metamethod_name, wrapper_scope_and_name, fully_qualified_scope};
-                            }
-                            else if (auto attribute = comment_parser.get_attribute("LuaMapTemplateClass"); attribute.exists() && attribute.num_params() >= 2)
-                            {
-                                // CUSTOM_ATTRIBUTE[LuaMapTemplateClass(::RC::Unreal::TArray, ::RC::UnrealRuntimeTypes::Array)]
+    auto CodeParser::parse_file_or_load_from_cache(const std::string& file, double& parse_duration) -> std::unique_ptr<CodeParser>
+    {
+        auto flags_hash = get_compiler_flags_hash(file);
 
-                                auto original_templated_class = attribute.get_param(0);
-                                auto non_templated_class = attribute.get_param(1);
+        // Every file gets its own worker so that the fragment that's stored only contains the output of that file.
+        // The worker starts out with every request, so a file gives the same output whether it's parsed or loaded from the cache.
+        std::unique_ptr<CodeParser> worker{new CodeParser{m_parser_output, *this}};
 
-                                m_out_of_line_template_class_map.emplace(original_templated_class, non_templated_class);
-                            }
-                            else if (auto attribute = comment_parser.get_attribute("LuaAddBaseToClass"); attribute.exists() && attribute.num_params() >= 2)
-                            {
-                                // CUSTOM_ATTRIBUTE[LuaAddBaseToClass(::RC::Unreal::FObjectProperty, ::RC::Unreal::FObjectPropertyBase)]
+        std::optional<Trace::Span> load_span{std::in_place, "load_from_parse_cache", file};
+        if (auto fragment = m_parse_cache->load(file, flags_hash))
+        {
+            try
+            {
+                worker->read_fragment(*fragment, WithAnnotationRequests::No);
+                printf_s("Loaded file from parse cache: %s\n", file.c_str());
+                parse_duration = 0.0;
+                return worker;
+            }
+            catch (std::runtime_error& e)
+            {
+                printf_s("Ignoring parse cache entry for '%s': %s\n", file.c_str(), e.what());
+                worker.reset(new CodeParser{m_parser_output, *this});
+            }
+        }
 
-                                auto the_class = attribute.get_param(0);
-                                auto the_base_class = attribute.get_param(1);
-                                auto [fully_qualified_scope, in_class] = parse_scope_and_class(the_class);
-                                auto [fully_qualified_base_scope, in_base_class] = parse_scope_and_class(the_base_class);
+        load_span.reset();
 
-                                m_custom_base_classes[the_class].emplace_back(fully_qualified_base_scope, in_base_class);
-                                m_custom_base_classes_inverted[the_base_class].emplace_back(fully_qualified_scope, in_class);
-                            }
-                            else
-                            {
-                                enum class RedirectorType
-                                {
-                                    LuaMemberFunctionRedirector,
-                                    LuaStaticMemberFunctionRedirector,
-                                } redirector_type;
-                                // LuaMemberFunctionRedirector or LuaStaticMemberFunctionRedirector
-                                CommentAttribute redirector_attribute{};
-                                redirector_attribute = comment_parser.get_attribute("LuaMemberFunctionRedirector");
-                                if (!redirector_attribute.exists())
-                                {
-                                    redirector_attribute = comment_parser.get_attribute("LuaStaticMemberFunctionRedirector");
-                                    redirector_type = RedirectorType::LuaStaticMemberFunctionRedirector;
-                                }
+        parse_duration = worker->parse_file(file);
+        Trace::Span store_span{"store_in_parse_cache", file};
+        m_parse_cache->store(file, flags_hash, worker->m_include_closure, worker->write_fragment(WithAnnotationRequests::No));
+        return worker;
+    }
 
-                                if (redirector_attribute.exists() && redirector_attribute.num_params() >= 3)
-                                {
-                                    // CUSTOM_ATTRIBUTE[LuaMemberFunctionRedirector(::RC::Unreal::UObjectBase, MyTestFunc, ::RC::UObjectBase_member_function_wrapper_MyTestFunc)]
+    auto CodeParser::parse_files_with_cache() -> void
+    {
+        auto num_workers = std::min(m_num_jobs, m_files_to_parse.size());
+        printf_s("Parsing %zu files with %zu workers, parse cache: %s\n", m_files_to_parse.size(), num_workers, m_parse_cache->get_cache_dir().string().c_str());
+
+        std::vector<std::unique_ptr<CodeParser>> file_outputs(m_files_to_parse.size());
+        std::atomic<size_t> num_loaded_files{};
+        for_each_file(num_workers, [&](size_t, size_t file_index) {
+            file_outputs[file_index] = parse_file_or_load_from_cache(m_files_to_parse[file_index], m_file_parse_durations[file_index]);
+            if (m_file_parse_durations[file_index] == 0.0) { ++num_loaded_files; }
+        });
+
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+            Trace::Span span{"merge_worker_output"};
+            // Merged in file order so that the output doesn't depend on which files came from the cache.
+            for (auto& file_output : file_outputs)
+            {
+                merge_worker_output(*file_output);
+            }
+            apply_custom_base_classes();
+            m_parser_output.rebuild_function_proto_container();
+        }
+        printf_s("Loaded %zu of %zu files from the parse cache, merging took %f seconds.\n", num_loaded_files.load(), m_files_to_parse.size(), timer_dur);
+
+        store_file_parse_durations();
+    }
 
-                                    auto in_scoped_class = redirector_attribute.get_param(0);
-                                    auto function_name = redirector_attribute.get_param(1);
-                                    auto wrapper_scope_and_name = redirector_attribute.get_param(2);
-                                    auto [fully_qualified_scope, in_class] = parse_scope_and_class(in_scoped_class);
+    auto CodeParser::prepare_for_parsing() -> void
+    {
+        // The static classes are shared by all workers so they must be created before any worker starts.
+        Type::generate_static_class_types(m_parser_output.get_container());
 
-                                    if (redirector_type == RedirectorType::LuaStaticMemberFunctionRedirector)
-                                    {
-                                        m_out_of_line_custom_member_function_requests[wrapper_scope_and_name] = {.in_class = in_class,
-                                                                                                                 .function_name = function_name,
-                                                                                                                 .wrapper_scope_and_name = wrapper_scope_and_name,
-                                                                                                                 .fully_qualified_scope = fully_qualified_scope,
-                                                                                                                 .is_static = true};
-                                    }
-                                    else
-                                    {
-                                        m_out_of_line_custom_member_function_requests[wrapper_scope_and_name] = {.in_class = in_class,
-                                                                                                                 .function_name = function_name,
-                                                                                                                 .wrapper_scope_and_name = wrapper_scope_and_name,
-                                                                                                                 .fully_qualified_scope = fully_qualified_scope,
-                                                                                                                 .is_static = false};
-                                    }
-                                    m_out_of_line_custom_member_function_names.emplace(in_scoped_class + "::" + function_name);
+        if (!m_precompiled_header_sources.empty())
+        {
+            build_precompiled_headers();
+        }
+        else if (!m_precompiled_header.empty() && m_per_file_compiler_args && !m_per_file_compiler_args->empty())
+        {
+            printf_s("The precompiled header is only used for files that aren't in the compilation database, it can't be rebuilt with their flags without 'pch_headers'\n");
+        }
 
-                                    //printf_s("Bindings requested out-of-line for custom member function '%s' in class '%s', mapped to '%s'\n", function_name.c_str(), in_scoped_class.c_str(), wrapper_scope_and_name.c_str());
-                                }
-                            }
+        collect_annotation_requests();
+    }
+
+    auto CodeParser::parse() -> const CodeGenerator&
+    {
+        Trace::Span span{"parse"};
+        prepare_for_parsing();
+
+        if (m_shard_count > 1)
+        {
+            select_shard_files();
+        }
+
+        m_file_parse_durations.assign(m_files_to_parse.size(), 0.0);
+        if (!m_unity_build && m_num_jobs > 1 && m_files_to_parse.size() > 1)
+        {
+            schedule_files();
+        }
+
+        double total_timer_dur{};
+        {
+            ScopedTimer total_timer(&total_timer_dur);
+            if (m_files_to_parse.empty())
+            {
+                printf_s("No files to parse\n");
+            }
+            else if (m_unity_build)
+            {
+                parse_unity();
+            }
+            else if (m_parse_cache)
+            {
+                parse_files_with_cache();
+            }
+            else
+            {
+                parse_files_in_parallel();
+            }
+        }
+        printf_s("Parsing all files units took %f seconds, %zu unique scopes, names and paths, %zu unique types.\n", total_timer_dur, Symbol::get_num_symbols(), m_parser_output.get_num_types());
+
+        return m_parser_output;
+    }
+
+    // Shard files start with this line so that the shards of a run can be validated and merged in order no matter how they were collected.
+    static constexpr std::string_view shard_file_header{"LuaWrapperGeneratorShard"};
+
+    auto CodeParser::write_shard(const std::filesystem::path& shard_file) const -> void
+    {
+        Trace::Span span{"write_shard", shard_file.string()};
+        auto contents = std::format("{} {} {}\n", shard_file_header, m_shard_index, m_shard_count);
+        contents.append(write_fragment(WithAnnotationRequests::Yes));
+
+        if (shard_file.has_parent_path())
+        {
+            std::filesystem::create_directories(shard_file.parent_path());
+        }
+        std::ofstream file{shard_file, std::ios::binary | std::ios::trunc};
+        if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size())))
+        {
+            throw std::runtime_error{std::format("Unable to write shard file '{}'", shard_file.string())};
+        }
+        printf_s("Wrote shard %zu/%zu to %s\n", m_shard_index, m_shard_count, shard_file.string().c_str());
+    }
+
+    auto CodeParser::merge_shards(const std::vector<std::filesystem::path>& shard_files) -> const CodeGenerator&
+    {
+        Trace::Span span{"merge_shards"};
+        if (shard_files.empty()) { throw std::runtime_error{"No shard files to merge"}; }
+        Type::generate_static_class_types(m_parser_output.get_container());
+
+        struct Shard
+        {
+            size_t index{};
+            std::string contents{};
+            size_t fragment_offset{};
+        };
+        std::vector<Shard> shards{};
+        size_t shard_count{};
+        for (const auto& shard_file : shard_files)
+        {
+            auto contents = read_source_file(shard_file);
+            auto header_end = contents.find('\n');
+            std::istringstream header{header_end == contents.npos ? std::string{} : contents.substr(0, header_end)};
+            std::string header_tag{};
+            size_t index{};
+            size_t count{};
+            if (!(header >> header_tag >> index >> count) || header_tag != shard_file_header)
+            {
+                throw std::runtime_error{std::format("'{}' is not a shard file", shard_file.string())};
+            }
+            if (shard_count != 0 && count != shard_count)
+            {
+                throw std::runtime_error{std::format("'{}' belongs to a run with {} shards, expected {}", shard_file.string(), count, shard_count)};
+            }
+            shard_count = count;
+            shards.emplace_back(Shard{index, std::move(contents), header_end + 1});
+        }
+
+        // Merged in shard order so that the output doesn't depend on the order that the shards finished in.
+        std::ranges::sort(shards, {}, &Shard::index);
+        for (size_t shard_index = 0; shard_index < shard_count; ++shard_index)
+        {
+            if (shard_index >= shards.size() || shards[shard_index].index != shard_index)
+            {
+                throw std::runtime_error{std::format("Shard {}/{} is missing or was supplied more than once", shard_index, shard_count)};
+            }
+        }
+        if (shards.size() != shard_count)
+        {
+            throw std::runtime_error{std::format("Expected {} shard files, got {}", shard_count, shards.size())};
+        }
+
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+            std::vector<std::unique_ptr<CodeParser>> shard_outputs{};
+            for (const auto& shard : shards)
+            {
+                auto& shard_output = shard_outputs.emplace_back(new CodeParser{m_parser_output, *this});
+                shard_output->read_fragment(std::string_view{shard.contents}.substr(shard.fragment_offset), WithAnnotationRequests::Yes);
+                merge_worker_output(*shard_output);
+            }
+            apply_custom_base_classes();
+            m_parser_output.rebuild_function_proto_container();
+        }
+        printf_s("Merging %zu shards took %f seconds, %zu unique scopes, names and paths.\n", shards.size(), timer_dur, Symbol::get_num_symbols());
+
+        return m_parser_output;
+    }
+
+    auto CodeParser::clear_annotation_requests() -> void
+    {
+        m_out_of_line_class_requests.clear();
+        m_out_of_line_free_function_requests.clear();
+        m_out_of_line_custom_free_function_requests.clear();
+        m_out_of_line_custom_member_function_requests.clear();
+        m_out_of_line_custom_member_function_names.clear();
+        m_out_of_line_custom_metamethod_functions.clear();
+        m_out_of_line_template_class_map.clear();
+        m_custom_base_classes.clear();
+        m_custom_base_classes_inverted.clear();
+        m_out_of_line_enums.clear();
+        // A declaration that was processed with the old requests may have to generate something else with the new ones.
+        m_processed_declarations.clear();
+        m_project_files.clear();
+        m_annotation_requests_hash = 0;
+        m_has_collected_annotation_requests = false;
+    }
+
+    // How often the watched files are checked for changes.
+    static constexpr std::chrono::milliseconds watch_poll_interval{200};
+    // The preamble, the headers at the top of a file, is precompiled on the first reparse and reused after that.
+    // Most saves only touch the project's own headers so only the part of the translation unit after the preamble is parsed again.
+    static constexpr unsigned int watch_parse_options = translation_unit_parse_options | CXTranslationUnit_PrecompiledPreamble;
+
+    struct WatchedTranslationUnit
+    {
+        std::string file{};
+        CXTranslationUnit translation_unit{};
+        // When the translation unit was last parsed, a dependency that was written after this may not be part of it.
+        std::filesystem::file_time_type parse_start{};
+        // The main file and every file it includes, with the time each was last written when the translation unit was parsed.
+        std::vector<std::pair<std::string, std::filesystem::file_time_type>> dependencies{};
+        // The output of only this translation unit, the full output is merged from these after every change.
+        std::string fragment{};
+    };
+
+    auto CodeParser::watch(const std::function<void(const CodeGenerator&)>& on_output) -> void
+    {
+        prepare_for_parsing();
+        if (m_files_to_parse.empty()) { throw std::runtime_error{"No files to watch"}; }
+
+        // A precompiled header that wasn't built by this run is loaded to find out which headers it was built from.
+        // The precompiled header itself comes first so that it can be told apart from its headers.
+        auto collect_prebuilt_precompiled_header_dependencies = [&] {
+            m_precompiled_header_dependencies.clear();
+            m_precompiled_header_dependencies.emplace_back(m_precompiled_header, get_last_write_time(m_precompiled_header));
+            auto translation_unit = clang_createTranslationUnit(m_current_index, m_precompiled_header.c_str());
+            if (!translation_unit) { return; }
+            for (auto& included_file : get_included_files(translation_unit))
+            {
+                auto last_write_time = get_last_write_time(included_file);
+                m_precompiled_header_dependencies.emplace_back(std::move(included_file), last_write_time);
+            }
+            clang_disposeTranslationUnit(translation_unit);
+        };
+        if (m_precompiled_header_sources.empty() && !m_precompiled_header.empty())
+        {
+            collect_prebuilt_precompiled_header_dependencies();
+        }
+        // Called when one of the files in 'm_precompiled_header_dependencies' was changed.
+        // libclang refuses a precompiled header that's older than its headers, so it has to be built again or stop being used.
+        auto update_precompiled_headers = [&] {
+            if (!m_precompiled_header_sources.empty())
+            {
+                auto previous_dependencies = m_precompiled_header_dependencies;
+                try
+                {
+                    build_precompiled_headers();
+                }
+                catch (std::runtime_error& e)
+                {
+                    // Built again on the next change to one of its headers.
+                    printf_s("Error: %s\n", e.what());
+                    m_precompiled_header_dependencies = std::move(previous_dependencies);
+                    for (auto& [file, last_write_time] : m_precompiled_header_dependencies)
+                    {
+                        last_write_time = get_last_write_time(file);
+                    }
+                }
+            }
+            else if (get_last_write_time(m_precompiled_header) != m_precompiled_header_dependencies.front().second)
+            {
+                // It was built again by whatever built it in the first place.
+                collect_prebuilt_precompiled_header_dependencies();
+            }
+            else
+            {
+                printf_s("The precompiled header '%s' is out of date and can't be built again without 'pch_headers', parsing without it\n", m_precompiled_header.c_str());
+                m_precompiled_header.clear();
+                m_precompiled_header_dependencies.clear();
+            }
+        };
+
+        std::vector<WatchedTranslationUnit> translation_units(m_files_to_parse.size());
+        auto parse_translation_unit = [&](CXIndex index, WatchedTranslationUnit& translation_unit) {
+            Trace::Span span{"clang_parseTranslationUnit", translation_unit.file};
+            auto compiler_args = get_compiler_args(translation_unit.file);
+            translation_unit.parse_start = std::filesystem::file_time_type::clock::now();
+            translation_unit.translation_unit = clang_parseTranslationUnit(index, translation_unit.file.c_str(), compiler_args.data(), static_cast<int>(compiler_args.size()), nullptr, 0, watch_parse_options);
+            if (!translation_unit.translation_unit)
+            {
+                throw std::runtime_error{std::format("Unable to parse '{}'", translation_unit.file)};
+            }
+        };
+        // The previous output of a file that can't be parsed is kept until the next change to one of its files.
+        auto skip_until_next_change = [&](WatchedTranslationUnit& translation_unit, const std::runtime_error& e) {
+            printf_s("Error: %s\n", e.what());
+            for (auto& [file, last_write_time] : translation_unit.dependencies)
+            {
+                last_write_time = get_last_write_time(file);
+            }
+        };
+        // Visits the translation unit with a fresh worker so that nothing from the previous visit is left over.
+        auto visit_translation_unit = [&](WatchedTranslationUnit& translation_unit) {
+            Trace::Span span{"visit_translation_unit", translation_unit.file};
+            std::unique_ptr<CodeParser> worker{new CodeParser{m_parser_output, *this}};
+            worker->process_translation_unit(translation_unit.translation_unit);
+            worker->collect_include_closure(translation_unit.translation_unit, translation_unit.file);
+            translation_unit.fragment = worker->write_fragment(WithAnnotationRequests::No);
+
+            // The stamps are taken after the parse, a file that was written since the parse started is stamped as changed.
+            auto visit_end = std::filesystem::file_time_type::clock::now();
+            translation_unit.dependencies.clear();
+            translation_unit.dependencies.emplace_back(translation_unit.file, get_dependency_stamp(translation_unit.file, translation_unit.parse_start, visit_end));
+            for (const auto& included_file : worker->m_include_closure)
+            {
+                translation_unit.dependencies.emplace_back(included_file, get_dependency_stamp(included_file, translation_unit.parse_start, visit_end));
+            }
+        };
+        auto rebuild_output = [&] {
+            Trace::Span span{"rebuild_output"};
+            m_parser_output.clear();
+            // The types that were converted by this parser belonged to the output that was just cleared.
+            m_converted_types.clear();
+
+            std::vector<std::unique_ptr<CodeParser>> translation_unit_outputs{};
+            for (const auto& translation_unit : translation_units)
+            {
+                auto& translation_unit_output = translation_unit_outputs.emplace_back(new CodeParser{m_parser_output, *this});
+                translation_unit_output->read_fragment(translation_unit.fragment, WithAnnotationRequests::No);
+                merge_worker_output(*translation_unit_output);
+            }
+            apply_custom_base_classes();
+            m_parser_output.rebuild_function_proto_container();
+            try
+            {
+                on_output(m_parser_output);
+            }
+            catch (std::runtime_error& e)
+            {
+                // The output is generated again on the next change.
+                printf_s("Error: %s\n", e.what());
+            }
+        };
+        // Watch mode only ends when the process is killed so 'Trace::stop' is never reached, the trace is written after every update instead.
+        auto flush_trace = [] {
+            try
+            {
+                Trace::flush();
+            }
+            catch (std::runtime_error& e)
+            {
+                printf_s("Error: %s\n", e.what());
+            }
+        };
+
+        auto num_workers = std::max(size_t{1}, std::min(m_num_jobs, m_files_to_parse.size()));
+        // Translation units are only valid for as long as the index they were created with.
+        // Each worker thread parses into its own index, files that are reparsed from scratch later use the index of this parser.
+        std::vector<CXIndex> indexes{};
+        for (size_t worker_index = 0; worker_index < num_workers; ++worker_index)
+        {
+            indexes.emplace_back(clang_createIndex(0, 0));
+        }
+
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+            for_each_file(num_workers, [&](size_t worker_index, size_t file_index) {
+                auto& translation_unit = translation_units[file_index];
+                translation_unit.file = m_files_to_parse[file_index];
+                parse_translation_unit(indexes[worker_index], translation_unit);
+                visit_translation_unit(translation_unit);
+            });
+            rebuild_output();
+        }
+        printf_s("Initial parse of %zu files took %f seconds, watching for changes.\n", translation_units.size(), timer_dur);
+        flush_trace();
+
+        auto is_precompiled_header_dependency_changed = [](const std::pair<std::string, std::filesystem::file_time_type>& dependency) {
+            return get_last_write_time(dependency.first) != dependency.second;
+        };
+        while (true)
+        {
+            std::this_thread::sleep_for(watch_poll_interval);
+
+            // Every translation unit was parsed with the old precompiled header so they're all parsed again from scratch.
+            if (std::ranges::any_of(m_precompiled_header_dependencies, is_precompiled_header_dependency_changed))
+            {
+                timer_dur = 0.0;
+                {
+                    ScopedTimer timer(&timer_dur);
+                    Trace::Span span{"watch_update_precompiled_header"};
+
+                    update_precompiled_headers();
+                    clear_annotation_requests();
+                    collect_annotation_requests();
+
+                    for (auto& translation_unit : translation_units)
+                    {
+                        if (translation_unit.translation_unit) { clang_disposeTranslationUnit(translation_unit.translation_unit); }
+                        translation_unit.translation_unit = nullptr;
+                    }
+                    for_each_file(num_workers, [&](size_t worker_index, size_t file_index) {
+                        auto& translation_unit = translation_units[file_index];
+                        try
+                        {
+                            parse_translation_unit(indexes[worker_index], translation_unit);
                         }
+                        catch (std::runtime_error& e)
+                        {
+                            skip_until_next_change(translation_unit, e);
+                            return;
+                        }
+                        visit_translation_unit(translation_unit);
+                    });
+                    rebuild_output();
+                }
+                printf_s("Parsed all %zu files again after a change to the precompiled header in %f seconds.\n", translation_units.size(), timer_dur);
+                flush_trace();
+                continue;
+            }
+
+            // Most headers are shared by many translation units so each file is only checked once per poll.
+            std::unordered_map<std::string, std::filesystem::file_time_type> last_write_times{};
+            std::unordered_set<std::string> changed_files{};
+            std::vector<WatchedTranslationUnit*> changed_translation_units{};
+            for (auto& translation_unit : translation_units)
+            {
+                bool has_changed{};
+                for (const auto& [file, last_write_time] : translation_unit.dependencies)
+                {
+                    auto [it, inserted] = last_write_times.try_emplace(file);
+                    if (inserted) { it->second = get_last_write_time(file); }
+                    if (it->second != last_write_time)
+                    {
+                        changed_files.emplace(file);
+                        has_changed = true;
                     }
-                    clang_disposeTokens(translation_unit, tokens, num_tokens);
+                }
+                if (has_changed) { changed_translation_units.emplace_back(&translation_unit); }
+            }
+            if (changed_translation_units.empty()) { continue; }
 
-                    clang_visitChildren(cursor, &CodeParser::generator_internal_clang_wrapper, this);
+            timer_dur = 0.0;
+            {
+                ScopedTimer timer(&timer_dur);
+                Trace::Span span{"watch_update"};
+
+                // The requests only have to be collected again if a project file was changed.
+                // A changed '#include' can add or remove a project header, so any change to a project file collects them again.
+                bool have_requests_changed{};
+                auto is_project_file = [&](const std::string& file) {
+                    return m_project_files.contains(normalize_file_path(file));
+                };
+                if (std::ranges::any_of(changed_files, is_project_file))
+                {
+                    auto previous_annotation_requests_hash = m_annotation_requests_hash;
+                    clear_annotation_requests();
+                    collect_annotation_requests();
+                    have_requests_changed = m_annotation_requests_hash != previous_annotation_requests_hash;
+                }
 
-                    for (auto& [member_function_wrapper_name, member_function] : m_custom_member_functions_to_generate)
+                for (auto* translation_unit : changed_translation_units)
+                {
+                    printf_s("Reparsing file: %s\n", translation_unit->file.c_str());
+                    Trace::Span reparse_span{"clang_reparseTranslationUnit", translation_unit->file};
+                    try
                     {
-                        auto* the_class = m_parser_output.get_container().find_mutable_class_by_name(member_function.data.fully_qualified_scope, member_function.data.in_class);
-                        auto& function = member_function.function_container.begin()->second;
-                        function.set_parent_name(the_class->name);
-                        function.set_parent_scope(the_class->fully_qualified_scope);
-                        function.set_containing_class(the_class);
-                        function.set_is_static(member_function.data.is_static);
-                        if (member_function.data.is_static)
+                        if (!translation_unit->translation_unit)
                         {
-                            the_class->static_functions.emplace(function.get_name(), std::move(function));
+                            parse_translation_unit(m_current_index, *translation_unit);
                         }
                         else
                         {
-                            the_class->container.functions.emplace(function.get_name(), std::move(function));
+                            translation_unit->parse_start = std::filesystem::file_time_type::clock::now();
+                            if (clang_reparseTranslationUnit(translation_unit->translation_unit, 0, nullptr, clang_defaultReparseOptions(translation_unit->translation_unit)) != 0)
+                            {
+                                // The translation unit can't be used after a failed reparse, it has to be parsed from scratch.
+                                clang_disposeTranslationUnit(translation_unit->translation_unit);
+                                translation_unit->translation_unit = nullptr;
+                                parse_translation_unit(m_current_index, *translation_unit);
+                            }
                         }
                     }
+                    catch (std::runtime_error& e)
+                    {
+                        skip_until_next_change(*translation_unit, e);
+                    }
+                }
 
-                    clang_disposeTranslationUnit(translation_unit);
+                // New requests can change what any translation unit generates so they're all visited again, but only the changed ones were reparsed.
+                if (have_requests_changed)
+                {
+                    for_each_file(num_workers, [&](size_t, size_t file_index) {
+                        if (translation_units[file_index].translation_unit) { visit_translation_unit(translation_units[file_index]); }
+                    });
+                }
+                else
+                {
+                    for (auto* translation_unit : changed_translation_units)
+                    {
+                        if (translation_unit->translation_unit) { visit_translation_unit(*translation_unit); }
+                    }
                 }
-                m_custom_member_functions_to_generate.clear();
-                printf_s("Parsing file took %f seconds.\n", timer_dur);
+                rebuild_output();
             }
+            printf_s("Updated the output for %zu changed files in %f seconds.\n", changed_files.size(), timer_dur);
+            flush_trace();
+        }
+    }
+
+    auto CodeParser::load_ir(const std::filesystem::path& ir_file) -> const CodeGenerator&
+    {
+        Type::generate_static_class_types(m_parser_output.get_container());
+
+        double timer_dur{};
+        {
+            ScopedTimer timer(&timer_dur);
+            m_parser_output.read_ir_file(ir_file);
         }
-        printf_s("Parsing all files units took %f seconds.\n", total_timer_dur);
+        printf_s("Loading binding IR from %s took %f seconds, %zu unique types.\n", ir_file.string().c_str(), timer_dur, m_parser_output.get_num_types());
 
         return m_parser_output;
     }
-}
\ No newline at end of file
+}
@@ -1,10 +1,44 @@
 #include <stdexcept>
+#include <utility>
 
 #include <LuaWrapperGenerator/CommentParser.hpp>
 
 namespace RC::LuaWrapperGenerator
 {
-    auto CommentAttribute::get_param(size_t param) -> const std::string&
+    auto to_comment_attribute_kind(std::string_view attribute_name) -> CommentAttributeKind
+    {
+        static constexpr std::pair<std::string_view, CommentAttributeKind> known_attributes[]{
+                {"Lua", CommentAttributeKind::Lua},
+                {"LuaStateTypes", CommentAttributeKind::LuaStateTypes},
+                {"LuaLate", CommentAttributeKind::LuaLate},
+                {"LuaAddMetamethod", CommentAttributeKind::LuaAddMetamethod},
+                {"LuaMapTemplateClass", CommentAttributeKind::LuaMapTemplateClass},
+                {"LuaAddBaseToClass", CommentAttributeKind::LuaAddBaseToClass},
+                {"LuaMemberFunctionRedirector", CommentAttributeKind::LuaMemberFunctionRedirector},
+                {"LuaStaticMemberFunctionRedirector", CommentAttributeKind::LuaStaticMemberFunctionRedirector},
+        };
+
+        for (const auto& [name, kind] : known_attributes)
+        {
+            if (name == attribute_name) { return kind; }
+        }
+        return CommentAttributeKind::Unknown;
+    }
+
+    auto CommentAttributeParams::push_back(std::string_view param) -> void
+    {
+        if (m_num_params < num_inline_params)
+        {
+            m_inline_params[m_num_params] = param;
+        }
+        else
+        {
+            m_overflow_params.emplace_back(param);
+        }
+        ++m_num_params;
+    }
+
+    auto CommentAttribute::get_param(size_t param) const -> std::string_view
     {
         if (param >= get().params.size())
         {
@@ -14,7 +48,16 @@ namespace RC::LuaWrapperGenerator
         return get().params[param];
     }
 
-    CommentParser::CommentParser(const std::string& comment) : m_comment(comment)
+    static auto trim_whitespace(std::string_view str) -> std::string_view
+    {
+        static constexpr std::string_view whitespace{" \t\r\n"};
+        auto start = str.find_first_not_of(whitespace);
+        if (start == str.npos) { return {}; }
+        auto end = str.find_last_not_of(whitespace);
+        return str.substr(start, end - start + 1);
+    }
+
+    CommentParser::CommentParser(std::string_view comment) : m_comment(comment)
     {
         parse();
     }
@@ -22,93 +65,98 @@ namespace RC::LuaWrapperGenerator
     auto CommentParser::parse() -> void
     {
         static constexpr std::string_view CustomAttributeTag{"CUSTOM_ATTRIBUTE["};
+
+        // The blocks are all copied before any of them are parsed so that 'm_blocks' doesn't reallocate underneath the views.
+        std::vector<std::pair<size_t, size_t>> block_ranges{};
         auto attr_tag_start = m_comment.find(CustomAttributeTag);
-        auto attr_tag_end = m_comment.find(']');
-        if (attr_tag_start == m_comment.npos || attr_tag_end == m_comment.npos)
+        while (attr_tag_start != m_comment.npos)
         {
-            // Comment doesn't have a valid format
-            return;
-        }
-
-        auto attr_start = attr_tag_start + CustomAttributeTag.size();
-        auto attr_end = attr_tag_end;
-
-        auto attr = m_comment.substr(attr_start, attr_end - attr_start);
-        auto attr_name_start = attr.find('(');
-        // If we have no ')' then we assume that the entire rest of the comment belongs to one attribute.
-        size_t attr_name_last_end{};
+            auto attr_start = attr_tag_start + CustomAttributeTag.size();
+            auto attr_tag_end = m_comment.find(']', attr_start);
+            if (attr_tag_end == m_comment.npos)
+            {
+                // Comment doesn't have a valid format
+                break;
+            }
 
-        //size_t num_attributes_parsed = static_cast<size_t>(attr_name_end != attr.npos) + 1;
+            auto block_start = m_blocks.size();
+            for (auto c : m_comment.substr(attr_start, attr_tag_end - attr_start))
+            {
+                // Spaces aren't part of any name or param, 'LuaLate(Class, ::RC::Unreal::UObjectBase)' has the param '::RC::Unreal::UObjectBase'.
+                if (c != ' ') { m_blocks.push_back(c); }
+            }
+            block_ranges.emplace_back(block_start, m_blocks.size() - block_start);
+            attr_tag_start = m_comment.find(CustomAttributeTag, attr_tag_end + 1);
+        }
 
-        do
+        std::string_view blocks{m_blocks};
+        for (uint32_t block = 0; block < block_ranges.size(); ++block)
         {
-            auto attribute_name = attr_name_start != attr.npos ? attr.substr(attr_name_last_end, attr_name_start - attr_name_last_end) : attr;
-            auto& attribute = m_attributes.emplace(attribute_name, attribute_name).first->second;
+            const auto& [block_start, block_size] = block_ranges[block];
+            parse_attribute_block(blocks.substr(block_start, block_size), block);
+        }
+    }
 
-            auto attr_params_start = attr_name_start;
-            if (attr_params_start != attr.npos && attr_params_start + 1 < attr.size())
+    // Parses the contents of one 'CUSTOM_ATTRIBUTE[...]' block, for example 'LuaStateTypes(Main), LuaLate(Class, ::RC::Unreal::UObjectBase)'.
+    auto CommentParser::parse_attribute_block(std::string_view attributes, uint32_t block) -> void
+    {
+        size_t offset{};
+        while (offset < attributes.size())
+        {
+            auto attr_name_end = attributes.find_first_of("(,", offset);
+            auto attribute_name = trim_whitespace(attributes.substr(offset, attr_name_end - offset));
+            if (attr_name_end == attributes.npos)
             {
-                ++attr_params_start;
-                std::string param{};
-                for (auto i = attr_params_start; i < attr.size(); ++i)
-                {
-                    if (attr[i] == ',' || attr[i] == ')')
-                    {
-                        attribute.params.emplace_back(param);
-                        param.clear();
-
-                        if (attr[i] == ')')
-                        {
-                            break;
-                        }
-                        else
-                        {
-                            continue;
-                        }
-                    }
-
-                    if (attr[i] == ' ') { continue; }
-
-                    param.push_back(attr[i]);
-                }
+                if (!attribute_name.empty()) { add_attribute(attribute_name, block); }
+                return;
+            }
+            if (attributes[attr_name_end] == ',')
+            {
+                if (!attribute_name.empty()) { add_attribute(attribute_name, block); }
+                offset = attr_name_end + 1;
+                continue;
             }
 
-            attr_name_last_end = attr.find(')', attr_name_last_end);
-            attr_name_start = attr.find('(', attr_name_last_end);
-            if (attr_name_start == attr.npos)
+            auto& attribute = add_attribute(attribute_name, block);
+            auto param_start = attr_name_end + 1;
+            auto i = param_start;
+            for (; i < attributes.size(); ++i)
             {
-                break;
+                if (attributes[i] != ',' && attributes[i] != ')') { continue; }
+
+                attribute.params.push_back(trim_whitespace(attributes.substr(param_start, i - param_start)));
+                param_start = i + 1;
+                if (attributes[i] == ')') { break; }
             }
-            else
+            if (i == attributes.size())
             {
-                for (; attr_name_last_end < attr.size() && (attr[attr_name_last_end] == ')' || attr[attr_name_last_end] == ',' || attr[attr_name_last_end] == ' '); ++attr_name_last_end) {}
+                // If we have no ')' then we assume that the entire rest of the block belongs to the last param.
+                if (auto param = trim_whitespace(attributes.substr(param_start)); !param.empty()) { attribute.params.push_back(param); }
+                return;
             }
+
+            offset = attributes.find_first_not_of(", \t", i + 1);
         }
-        while (true);
-
-        //printf_s("attr_tag_start: %i\n", attr_tag_start);
-        //printf_s("attr_tag_end: %i\n", attr_tag_end);
-        //printf_s("attr_start: %i\n", attr_start);
-        //printf_s("attr_end: %i\n", attr_end);
-        //printf_s("attr: %s\n", attr.c_str());
-        //printf_s("attr_name: %s\n", m_attribute_name.c_str());
-        //printf_s("params: %i (", m_params.size());
-        //for (const auto& param : m_params)
-        //{
-        //    printf_s("%s, ", param.data());
-        //}
-        //printf_s(")\n");
     }
 
-    auto CommentParser::get_attribute(const std::string& attribute_name) const -> const CommentAttribute
+    auto CommentParser::add_attribute(std::string_view attribute_name, uint32_t block) -> CommentAttributeContainer&
     {
-        if (auto it = m_attributes.find(attribute_name); it != m_attributes.end())
-        {
-            return {&it->second};
-        }
-        else
+        auto& attribute = m_attributes.emplace_back(CommentAttributeContainer{attribute_name, to_comment_attribute_kind(attribute_name), {}, block});
+        // The first attribute of a kind is the one that's used if a comment has the same attribute more than once.
+        if (attribute.kind != CommentAttributeKind::Unknown)
         {
-            return {nullptr};
+            if (auto& index = m_attribute_by_kind[static_cast<size_t>(attribute.kind)]; index == 0)
+            {
+                index = static_cast<uint32_t>(m_attributes.size());
+            }
         }
+        return attribute;
+    }
+
+    auto CommentParser::get_attribute(CommentAttributeKind kind) const -> CommentAttribute
+    {
+        if (kind == CommentAttributeKind::Unknown) { return {nullptr}; }
+        auto index = m_attribute_by_kind[static_cast<size_t>(kind)];
+        return {index == 0 ? nullptr : &m_attributes[index - 1]};
     }
-}
\ No newline at end of file
+}
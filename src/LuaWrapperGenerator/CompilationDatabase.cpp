@@ -0,0 +1,103 @@
+#include <stdexcept>
+#include <format>
+#include <array>
+#include <algorithm>
+
+#include <clang-c/CXCompilationDatabase.h>
+
+#include <LuaWrapperGenerator/CompilationDatabase.hpp>
+
+namespace RC::LuaWrapperGenerator
+{
+    static auto to_string(CXString cxstring) -> std::string
+    {
+        auto cstring = clang_getCString(cxstring);
+        std::string string{cstring ? cstring : ""};
+        clang_disposeString(cxstring);
+        return string;
+    }
+
+    // Flags that are followed by a separate argument and only affect the output of the compiler.
+    static constexpr std::array output_flags_with_value{
+            std::string_view{"-o"},
+            std::string_view{"-MF"},
+            std::string_view{"-MT"},
+            std::string_view{"-MQ"},
+    };
+
+    static constexpr std::array output_flags{
+            std::string_view{"-c"},
+            std::string_view{"/c"},
+            std::string_view{"-MD"},
+            std::string_view{"-MMD"},
+            std::string_view{"/FS"},
+    };
+
+    // MSVC style flags where the value is part of the flag, like '/FoObject.obj'.
+    static constexpr std::array output_flag_prefixes{
+            std::string_view{"/Fo"},
+            std::string_view{"/Fd"},
+            std::string_view{"-Fo"},
+            std::string_view{"-Fd"},
+    };
+
+    auto load_compile_commands(const std::filesystem::path& build_dir) -> std::vector<CompileCommand>
+    {
+        auto directory = build_dir.filename() == "compile_commands.json" ? build_dir.parent_path() : build_dir;
+
+        CXCompilationDatabase_Error error{};
+        auto database = clang_CompilationDatabase_fromDirectory(directory.string().c_str(), &error);
+        if (error != CXCompilationDatabase_NoError || !database)
+        {
+            throw std::runtime_error{std::format("Unable to load compile_commands.json from '{}'", directory.string())};
+        }
+
+        std::vector<CompileCommand> compile_commands{};
+        auto commands = clang_CompilationDatabase_getAllCompileCommands(database);
+        auto num_commands = clang_CompileCommands_getSize(commands);
+        for (unsigned int command_index = 0; command_index < num_commands; ++command_index)
+        {
+            auto command = clang_CompileCommands_getCommand(commands, command_index);
+            auto working_directory = std::filesystem::path{to_string(clang_CompileCommand_getDirectory(command))};
+            auto file_as_written = to_string(clang_CompileCommand_getFilename(command));
+            auto file = std::filesystem::path{file_as_written};
+            if (file.is_relative()) { file = working_directory / file; }
+            file = file.lexically_normal();
+
+            auto& compile_command = compile_commands.emplace_back(CompileCommand{file.string()});
+            auto num_args = clang_CompileCommand_getNumArgs(command);
+            for (unsigned int arg_index = 0; arg_index < num_args; ++arg_index)
+            {
+                auto arg = to_string(clang_CompileCommand_getArg(command, arg_index));
+                if (arg_index == 0)
+                {
+                    // The compiler itself, libclang needs to know if the rest of the flags are in the MSVC style.
+                    auto compiler = std::filesystem::path{arg}.stem().string();
+                    if (compiler == "cl" || compiler == "clang-cl")
+                    {
+                        compile_command.args.emplace_back("--driver-mode=cl");
+                    }
+                    continue;
+                }
+
+                if (arg == file_as_written || arg == compile_command.file) { continue; }
+                if (std::ranges::find(output_flags, arg) != output_flags.end()) { continue; }
+                if (std::ranges::find(output_flags_with_value, arg) != output_flags_with_value.end())
+                {
+                    ++arg_index;
+                    continue;
+                }
+                if (std::ranges::any_of(output_flag_prefixes, [&](std::string_view prefix) { return arg.starts_with(prefix); })) { continue; }
+
+                compile_command.args.emplace_back(std::move(arg));
+            }
+
+            // Relative include paths are relative to the directory the compiler was invoked from.
+            compile_command.args.emplace_back(std::format("-working-directory={}", working_directory.string()));
+        }
+        clang_CompileCommands_dispose(commands);
+        clang_CompilationDatabase_dispose(database);
+
+        return compile_commands;
+    }
+}
@@ -0,0 +1,110 @@
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+#include <LuaWrapperGenerator/OutputManifest.hpp>
+#include <LuaWrapperGenerator/Hash.hpp>
+#include <LuaWrapperGenerator/Trace.hpp>
+#include <File/File.hpp>
+
+namespace RC::LuaWrapperGenerator
+{
+    OutputManifest::OutputManifest(std::filesystem::path output_path) : m_output_path(std::move(output_path))
+    {
+        std::ifstream manifest_file{get_manifest_path()};
+        if (!manifest_file) { return; }
+
+        // One file per line: hash of the contents in hex, size, modification time, then the relative path which may itself contain spaces.
+        // A line that can't be read ends the manifest, the files after it are just written again.
+        Entry entry{};
+        std::string relative_path{};
+        while (manifest_file >> std::hex >> entry.contents_hash >> std::dec >> entry.file_size >> entry.last_write_time && std::getline(manifest_file >> std::ws, relative_path))
+        {
+            m_previous_entries[relative_path] = entry;
+        }
+    }
+
+    auto OutputManifest::in_memory() -> OutputManifest
+    {
+        OutputManifest output_manifest{};
+        output_manifest.m_is_in_memory = true;
+        return output_manifest;
+    }
+
+    auto OutputManifest::get_manifest_path() const -> std::filesystem::path
+    {
+        return m_output_path / "generated_files.txt";
+    }
+
+    auto OutputManifest::make_entry(const std::filesystem::path& file_path, uint64_t contents_hash) const -> std::optional<Entry>
+    {
+        std::error_code error_code{};
+        auto file_size = std::filesystem::file_size(file_path, error_code);
+        if (error_code) { return std::nullopt; }
+        auto last_write_time = std::filesystem::last_write_time(file_path, error_code);
+        if (error_code) { return std::nullopt; }
+
+        return Entry{contents_hash, file_size, static_cast<int64_t>(last_write_time.time_since_epoch().count())};
+    }
+
+    auto OutputManifest::write_file(const std::filesystem::path& relative_path, std::string_view contents) -> bool
+    {
+        auto file_path = m_output_path / relative_path;
+        auto key = relative_path.generic_string();
+        auto contents_hash = Hasher{}.update(contents).get();
+
+        if (m_is_in_memory)
+        {
+            m_entries[key] = Entry{contents_hash};
+            ++m_num_written;
+            return true;
+        }
+
+        if (auto previous_entry = m_previous_entries.find(key); previous_entry != m_previous_entries.end())
+        {
+            if (auto entry = make_entry(file_path, contents_hash); entry && *entry == previous_entry->second)
+            {
+                m_entries[key] = *entry;
+                ++m_num_skipped;
+                return false;
+            }
+        }
+
+        {
+            Trace::Span span{"write_file", key};
+            auto file = File::open(file_path, File::OpenFor::Writing, File::OverwriteExistingFile::Yes, File::CreateIfNonExistent::Yes);
+            file.write_string_to_file(File::StringType{contents.begin(), contents.end()});
+            file.close();
+        }
+
+        // If the file can't be looked at then it's left out of the manifest and written again on the next run.
+        if (auto entry = make_entry(file_path, contents_hash))
+        {
+            m_entries[key] = *entry;
+        }
+        ++m_num_written;
+        return true;
+    }
+
+    auto OutputManifest::save() const -> void
+    {
+        if (m_is_in_memory) { return; }
+
+        // A manifest that couldn't be written only means that the next run writes every file again so a failed write is ignored.
+        std::ofstream manifest_file{get_manifest_path(), std::ios::trunc};
+        for (const auto& [relative_path, entry] : m_entries)
+        {
+            manifest_file << std::hex << entry.contents_hash << std::dec << ' ' << entry.file_size << ' ' << entry.last_write_time << ' ' << relative_path << '\n';
+        }
+    }
+
+    auto OutputManifest::get_contents_hashes() const -> std::map<std::string, uint64_t>
+    {
+        std::map<std::string, uint64_t> contents_hashes{};
+        for (const auto& [relative_path, entry] : m_entries)
+        {
+            contents_hashes.emplace(relative_path, entry.contents_hash);
+        }
+        return contents_hashes;
+    }
+}
@@ -0,0 +1,170 @@
+#include <fstream>
+#include <format>
+#include <stdexcept>
+#include <sstream>
+
+#include <LuaWrapperGenerator/ParseCache.hpp>
+#include <LuaWrapperGenerator/BindingIR.hpp>
+#include <LuaWrapperGenerator/Hash.hpp>
+#include <File/Macros.hpp>
+
+namespace RC::LuaWrapperGenerator
+{
+    static auto read_file(const std::filesystem::path& file_path) -> std::optional<std::string>
+    {
+        std::ifstream file{file_path, std::ios::binary | std::ios::ate};
+        if (!file) { return std::nullopt; }
+
+        std::string contents{};
+        contents.resize(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        if (!file.read(contents.data(), static_cast<std::streamsize>(contents.size()))) { return std::nullopt; }
+
+        return contents;
+    }
+
+    ParseCache::ParseCache(std::filesystem::path cache_dir) : m_cache_dir(std::move(cache_dir))
+    {
+        std::filesystem::create_directories(m_cache_dir);
+    }
+
+    auto ParseCache::get_entry_path(const std::string& file) const -> std::filesystem::path
+    {
+        return m_cache_dir / std::format("{:016x}.tu", hash_string(file));
+    }
+
+    auto ParseCache::hash_file(const std::string& file) const -> std::optional<uint64_t>
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_file_hashes_mutex};
+            if (auto it = m_file_hashes.find(file); it != m_file_hashes.end()) { return it->second; }
+        }
+
+        std::optional<uint64_t> file_hash{};
+        if (auto contents = read_file(file))
+        {
+            file_hash = Hasher{}.update(*contents).get();
+        }
+
+        std::lock_guard<std::mutex> lock{m_file_hashes_mutex};
+        m_file_hashes.emplace(file, file_hash);
+        return file_hash;
+    }
+
+    auto ParseCache::hash_include_closure(const std::string& file, uint64_t flags_hash, const std::vector<std::string>& include_closure) const -> std::optional<uint64_t>
+    {
+        Hasher hasher{};
+        hasher.update(flags_hash);
+
+        auto main_file_hash = hash_file(file);
+        if (!main_file_hash) { return std::nullopt; }
+        hasher.update(*main_file_hash);
+
+        for (const auto& included_file : include_closure)
+        {
+            auto included_file_hash = hash_file(included_file);
+            if (!included_file_hash) { return std::nullopt; }
+            hasher.update(included_file);
+            hasher.update(*included_file_hash);
+        }
+
+        return hasher.get();
+    }
+
+    auto ParseCache::load(const std::string& file, uint64_t flags_hash) const -> std::optional<std::string>
+    {
+        auto entry = read_file(get_entry_path(file));
+        if (!entry) { return std::nullopt; }
+
+        try
+        {
+            IRReader reader{*entry};
+            if (reader.read_string() != file) { return std::nullopt; }
+            if (reader.read_u64() != flags_hash) { return std::nullopt; }
+            auto stored_hash = reader.read_u64();
+
+            std::vector<std::string> include_closure{};
+            auto num_included_files = reader.read_u32();
+            include_closure.reserve(num_included_files);
+            for (uint32_t i = 0; i < num_included_files; ++i)
+            {
+                include_closure.emplace_back(reader.read_string());
+            }
+
+            if (hash_include_closure(file, flags_hash, include_closure) != stored_hash) { return std::nullopt; }
+
+            return std::string{reader.read_blob()};
+        }
+        catch (std::runtime_error& e)
+        {
+            printf_s("Ignoring parse cache entry for '%s': %s\n", file.c_str(), e.what());
+            return std::nullopt;
+        }
+    }
+
+    auto ParseCache::store(const std::string& file, uint64_t flags_hash, const std::vector<std::string>& include_closure, std::string_view fragment) const -> void
+    {
+        auto closure_hash = hash_include_closure(file, flags_hash, include_closure);
+        // A file that can't be read can't be validated on the next run either.
+        if (!closure_hash) { return; }
+
+        IRWriter writer{};
+        writer.write_string(file);
+        writer.write_u64(flags_hash);
+        writer.write_u64(*closure_hash);
+        writer.write_u32(static_cast<uint32_t>(include_closure.size()));
+        for (const auto& included_file : include_closure)
+        {
+            writer.write_string(included_file);
+        }
+        writer.write_blob(fragment);
+        auto entry = writer.finish();
+
+        // Written to a temporary file first so that an interrupted run can't leave a truncated entry behind.
+        auto entry_path = get_entry_path(file);
+        auto temporary_path = entry_path;
+        temporary_path += ".tmp";
+        {
+            std::ofstream entry_file{temporary_path, std::ios::binary | std::ios::trunc};
+            if (!entry_file.write(entry.data(), static_cast<std::streamsize>(entry.size())))
+            {
+                printf_s("Unable to write parse cache entry for '%s'\n", file.c_str());
+                return;
+            }
+        }
+
+        std::error_code error_code{};
+        std::filesystem::rename(temporary_path, entry_path, error_code);
+        if (error_code)
+        {
+            printf_s("Unable to write parse cache entry for '%s': %s\n", file.c_str(), error_code.message().c_str());
+        }
+    }
+
+    auto ParseCache::load_file_timings() const -> std::unordered_map<std::string, double>
+    {
+        std::unordered_map<std::string, double> file_timings{};
+        auto contents = read_file(m_cache_dir / "timings.txt");
+        if (!contents) { return file_timings; }
+
+        // One file per line: seconds, a space, then the full path which may itself contain spaces.
+        std::istringstream stream{*contents};
+        double seconds{};
+        std::string file{};
+        while (stream >> seconds && std::getline(stream >> std::ws, file))
+        {
+            file_timings[file] = seconds;
+        }
+        return file_timings;
+    }
+
+    auto ParseCache::store_file_timings(const std::unordered_map<std::string, double>& file_timings) const -> void
+    {
+        // The timings are only a scheduling hint so a failed write is ignored.
+        std::ofstream timings_file{m_cache_dir / "timings.txt", std::ios::trunc};
+        for (const auto& [file, seconds] : file_timings)
+        {
+            timings_file << seconds << ' ' << file << '\n';
+        }
+    }
+}
@@ -94,7 +94,7 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
                     //printf_s("    array_element_type: %s\n", array_element_type->generate_cxx_name().c_str());
 
                     //printf_s("Do some custom stuff for TArray, maybe involving FScriptArray.\n");
-                    type = std::make_unique<TArray>(code_generator.get_container(), std::move(array_element_type));
+                    type = std::make_unique<TArray>(code_generator.get_lookup_container(), std::move(array_element_type));
 
                     CXCursor array_element_cursor{};
                     if (array_element_cxtype.kind == CXTypeKind::CXType_Pointer)
@@ -141,7 +141,7 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
         std::string buffer{};
         buffer.append("inline std::unordered_map<std::string, void (*)(lua_State*, void*, uint32_t)> lua_type_name_to_lua_object_from_heap {\n");
         buffer.append("    // Custom types.\n");
-        for (const auto&[_, the_class] : container.classes)
+        for (const auto&[_, the_class] : sorted_by_key(container.classes))
         {
             buffer.append(std::format("    {{\"{}::{}\", &lua_Userdata_to_lua_from_heap<\"{}_{}Metatable\", {}::{}>}},\n", the_class.fully_qualified_scope, the_class.name, scope_as_function_name(the_class.fully_qualified_scope), the_class.name, the_class.fully_qualified_scope, the_class.name));
         }
@@ -162,7 +162,7 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
 
         buffer.append("inline std::unordered_map<std::string, void (*)(lua_State*, void*, uint32_t)> lua_ue_type_name_to_lua_object_from_heap {\n");
         buffer.append("    // Custom types.\n");
-        for (const auto&[_, the_class] : container.classes)
+        for (const auto&[_, the_class] : sorted_by_key(container.classes))
         {
             std::string class_name{the_class.name};
             if (class_name.starts_with('F') || class_name.starts_with('U'))
@@ -291,6 +291,20 @@ namespace RC::LuaWrapperGenerator::TypePatches::Unreal
         return buffer;
     }
 
+    auto serialize_type(const Type::Base* type, IRWriter& writer) -> bool
+    {
+        if (!type->is_a<TArray>()) { return false; }
+        auto as_array = static_cast<const TArray*>(type);
+
+        writer.write_type(as_array->get_element_type());
+        return true;
+    }
+
+    auto deserialize_type(CodeGenerator& code_generator, IRReader& reader) -> std::unique_ptr<Type::Base>
+    {
+        return std::make_unique<TArray>(code_generator.get_lookup_container(), reader.read_type());
+    }
+
     auto TArray::generate_cxx_name() const -> std::string
     {
         // TODO: Figure out this type name.
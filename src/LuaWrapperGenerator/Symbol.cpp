@@ -0,0 +1,66 @@
+#include <unordered_set>
+#include <shared_mutex>
+#include <mutex>
+
+#include <LuaWrapperGenerator/Symbol.hpp>
+
+namespace RC::LuaWrapperGenerator
+{
+    struct SymbolHash
+    {
+        using is_transparent = void;
+        auto operator()(std::string_view string) const -> size_t { return std::hash<std::string_view>{}(string); }
+    };
+
+    class SymbolTable
+    {
+    private:
+        // Node based so that the address of a string never changes once it's been inserted.
+        std::unordered_set<std::string, SymbolHash, std::equal_to<>> m_strings{};
+        mutable std::shared_mutex m_mutex{};
+
+    public:
+        auto intern(std::string_view string) -> const std::string*
+        {
+            {
+                std::shared_lock lock{m_mutex};
+                if (auto it = m_strings.find(string); it != m_strings.end()) { return &*it; }
+            }
+
+            std::unique_lock lock{m_mutex};
+            return &*m_strings.emplace(string).first;
+        }
+
+        auto size() const -> size_t
+        {
+            std::shared_lock lock{m_mutex};
+            return m_strings.size();
+        }
+    };
+
+    // Intentionally leaked so that symbols in other static objects stay valid during shutdown.
+    static auto get_symbol_table() -> SymbolTable&
+    {
+        static auto* symbol_table = new SymbolTable{};
+        return *symbol_table;
+    }
+
+    static auto get_empty_string() -> const std::string*
+    {
+        static const auto* empty_string = get_symbol_table().intern({});
+        return empty_string;
+    }
+
+    Symbol::Symbol() : m_string(get_empty_string())
+    {
+    }
+
+    Symbol::Symbol(std::string_view string) : m_string(get_symbol_table().intern(string))
+    {
+    }
+
+    auto Symbol::get_num_symbols() -> size_t
+    {
+        return get_symbol_table().size();
+    }
+}
@@ -0,0 +1,235 @@
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <format>
+
+#include <LuaWrapperGenerator/Trace.hpp>
+
+namespace RC::LuaWrapperGenerator::Trace
+{
+    struct Event
+    {
+        const char* name{};
+        std::string detail{};
+        // Microseconds since 'start'.
+        int64_t start{};
+        int64_t duration{};
+    };
+
+    // Each thread only appends to its own buffer so recording a span doesn't take a lock.
+    // Buffers are owned by the trace so that they outlive the worker threads that filled them.
+    // A buffer is dropped by the first write after its thread has exited.
+    struct ThreadBuffer
+    {
+        uint32_t thread_id{};
+        std::string thread_name{};
+        std::vector<Event> events{};
+        std::atomic<bool> is_finished{};
+    };
+
+    // Marks the buffer as finished when its thread exits.
+    struct ThreadBufferOwner
+    {
+        std::shared_ptr<ThreadBuffer> buffer{};
+
+        ~ThreadBufferOwner()
+        {
+            if (buffer) { buffer->is_finished.store(true, std::memory_order_release); }
+        }
+    };
+
+    struct TraceState
+    {
+        std::atomic<bool> enabled{};
+        std::filesystem::path output_file{};
+        std::chrono::steady_clock::time_point start_time{};
+        std::mutex buffers_mutex{};
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers{};
+        uint32_t next_thread_id{1};
+        // Threads with the same name share a thread id, so the workers that watch mode starts for every update show up as the same threads.
+        std::unordered_map<std::string, uint32_t> thread_ids_by_name{};
+        std::unordered_set<uint32_t> named_thread_ids{};
+        // Every write appends the events recorded since the previous write and then rewrites the end of the file.
+        std::ofstream trace_file{};
+        std::streamoff end_of_events{};
+        bool has_written_event{};
+    };
+
+    static auto get_state() -> TraceState&
+    {
+        static TraceState state{};
+        return state;
+    }
+
+    static auto get_thread_buffer() -> ThreadBuffer&
+    {
+        thread_local ThreadBufferOwner owner{};
+        if (!owner.buffer)
+        {
+            auto& state = get_state();
+            std::lock_guard lock{state.buffers_mutex};
+            owner.buffer = std::make_shared<ThreadBuffer>();
+            owner.buffer->thread_id = state.next_thread_id++;
+            state.buffers.emplace_back(owner.buffer);
+        }
+        return *owner.buffer;
+    }
+
+    static auto now() -> int64_t
+    {
+        auto elapsed = std::chrono::steady_clock::now() - get_state().start_time;
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+    }
+
+    static auto append_json_string(std::string& out, std::string_view str) -> void
+    {
+        out.push_back('"');
+        for (auto c : str)
+        {
+            switch (c)
+            {
+                case '"': out.append("\\\""); break;
+                case '\\': out.append("\\\\"); break;
+                case '\n': out.append("\\n"); break;
+                case '\r': out.append("\\r"); break;
+                case '\t': out.append("\\t"); break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20)
+                    {
+                        out.append(std::format("\\u{:04x}", static_cast<unsigned int>(c)));
+                    }
+                    else
+                    {
+                        out.push_back(c);
+                    }
+            }
+        }
+        out.push_back('"');
+    }
+
+    auto start(std::filesystem::path output_file) -> void
+    {
+        auto& state = get_state();
+        state.output_file = std::move(output_file);
+        state.start_time = std::chrono::steady_clock::now();
+        state.enabled.store(true, std::memory_order_relaxed);
+        set_thread_name("Main");
+    }
+
+    static auto write_trace_file(TraceState& state) -> void
+    {
+        std::string contents{};
+        auto begin_event = [&] {
+            if (state.has_written_event) { contents.append(",\n"); }
+            state.has_written_event = true;
+        };
+
+        std::lock_guard lock{state.buffers_mutex};
+        for (const auto& buffer : state.buffers)
+        {
+            if (!buffer->thread_name.empty() && state.named_thread_ids.emplace(buffer->thread_id).second)
+            {
+                begin_event();
+                contents.append(std::format(R"({{"ph":"M","name":"thread_name","pid":1,"tid":{},"args":{{"name":)", buffer->thread_id));
+                append_json_string(contents, buffer->thread_name);
+                contents.append("}}");
+            }
+            for (const auto& event : buffer->events)
+            {
+                begin_event();
+                contents.append(std::format(R"({{"ph":"X","pid":1,"tid":{},"ts":{},"dur":{},"name":)", buffer->thread_id, event.start, event.duration));
+                append_json_string(contents, event.name);
+                if (!event.detail.empty())
+                {
+                    contents.append(R"(,"args":{"detail":)");
+                    append_json_string(contents, event.detail);
+                    contents.push_back('}');
+                }
+                contents.push_back('}');
+            }
+            buffer->events.clear();
+        }
+        std::erase_if(state.buffers, [](const auto& buffer) { return buffer->is_finished.load(std::memory_order_acquire); });
+
+        if (!state.trace_file.is_open())
+        {
+            state.trace_file.open(state.output_file, std::ios::binary | std::ios::trunc);
+            if (!state.trace_file)
+            {
+                throw std::runtime_error{std::format("Unable to open trace file '{}' for writing", state.output_file.string())};
+            }
+            state.trace_file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        }
+        else
+        {
+            state.trace_file.seekp(state.end_of_events);
+        }
+        state.trace_file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        state.end_of_events = state.trace_file.tellp();
+        state.trace_file << "\n]}\n";
+        state.trace_file.flush();
+        if (!state.trace_file)
+        {
+            throw std::runtime_error{std::format("Unable to write trace file '{}'", state.output_file.string())};
+        }
+    }
+
+    auto stop() -> void
+    {
+        auto& state = get_state();
+        if (!state.enabled.exchange(false, std::memory_order_relaxed)) { return; }
+
+        write_trace_file(state);
+        state.trace_file.close();
+    }
+
+    auto flush() -> void
+    {
+        auto& state = get_state();
+        if (!state.enabled.load(std::memory_order_relaxed)) { return; }
+        write_trace_file(state);
+    }
+
+    auto is_enabled() -> bool
+    {
+        return get_state().enabled.load(std::memory_order_relaxed);
+    }
+
+    auto set_thread_name(std::string name) -> void
+    {
+        if (!is_enabled()) { return; }
+        auto& buffer = get_thread_buffer();
+
+        auto& state = get_state();
+        std::lock_guard lock{state.buffers_mutex};
+        auto [it, was_inserted] = state.thread_ids_by_name.try_emplace(name, buffer.thread_id);
+        buffer.thread_id = it->second;
+        buffer.thread_name = std::move(name);
+    }
+
+    Span::Span(const char* name) : m_name(name)
+    {
+        if (is_enabled()) { m_start = now(); }
+    }
+
+    Span::Span(const char* name, std::string_view detail) : m_name(name)
+    {
+        if (is_enabled())
+        {
+            m_detail = detail;
+            m_start = now();
+        }
+    }
+
+    Span::~Span()
+    {
+        if (m_start < 0 || !is_enabled()) { return; }
+        get_thread_buffer().events.emplace_back(Event{m_name, std::move(m_detail), m_start, now() - m_start});
+    }
+}
@@ -1,21 +1,149 @@
 #include <iostream>
 #include <vector>
 #include <format>
+#include <charconv>
 
 #include <ArgsParser/ArgsParser.hpp>
 #include <Timer/ScopedTimer.hpp>
 #include <Helpers/String.hpp>
 #include <LuaWrapperGenerator/CodeParser.hpp>
 #include <LuaWrapperGenerator/CodeGenerator.hpp>
+#include <LuaWrapperGenerator/Trace.hpp>
 
 #include <LuaWrapperGenerator/Patches/Unreal.hpp>
 
 using namespace RC;
 using namespace RC::LuaWrapperGenerator;
 
-auto parse_cxx(const std::filesystem::path& output_path, std::vector<std::string>& files2, std::vector<const char*>& compiler_flags2) -> void
+auto add_type_patches(LuaWrapperGenerator::CodeParser& code_parser) -> void
+{
+    code_parser.add_type_patch(TypePatch{
+        .generate_state_file_pre = &TypePatches::Unreal::generate_state_file_pre,
+        .generate_state_file_post = &TypePatches::Unreal::generate_state_file_post,
+        .cxtype_to_type = &TypePatches::Unreal::cxtype_to_type,
+        .cxtype_to_type_post = &TypePatches::Unreal::cxtype_to_type_post,
+        .generate_lua_setup_state_function_post = &TypePatches::Unreal::generate_lua_setup_state_function_post,
+        .generate_per_class_static_functions = &TypePatches::Unreal::generate_per_class_static_functions,
+        .serialize_type = &TypePatches::Unreal::serialize_type,
+        .deserialize_type = &TypePatches::Unreal::deserialize_type,
+    });
+}
+
+auto generate_code(const LuaWrapperGenerator::CodeGenerator& parser_output) -> void
+{
+    printf_s("Generating code\n");
+    double timer_dur{};
+    // Loaded again on every run so that watch mode also notices files that were changed or deleted between runs.
+    LuaWrapperGenerator::OutputManifest output_manifest{parser_output.get_output_path()};
+    {
+        ScopedTimer timer(&timer_dur);
+        LuaWrapperGenerator::Trace::Span span{"generate_code"};
+        parser_output.generate_lua_setup_file(output_manifest);
+        parser_output.generate_state_file(output_manifest);
+        output_manifest.save();
+    }
+    printf_s("Code generation took %f seconds.\n", timer_dur);
+    printf_s("Wrote %zu files, skipped %zu unchanged files.\n", output_manifest.get_num_written(), output_manifest.get_num_skipped());
+}
+
+// Everything that's read from the command line, see 'read_options' for what each one does.
+struct Options
+{
+    std::filesystem::path output_path{};
+    std::vector<std::string> sources{};
+    std::vector<std::string> compiler_flags{};
+    size_t num_jobs{1};
+    std::filesystem::path cache_dir{};
+    bool unity_build{};
+    std::filesystem::path precompiled_header{};
+    std::vector<std::string> precompiled_header_sources{};
+    std::filesystem::path code_root{};
+    std::filesystem::path compile_commands{};
+    std::vector<std::string> allowed_paths{};
+    std::vector<std::string> denied_paths{};
+    bool skip_system_headers{};
+    std::filesystem::path trace_file{};
+    size_t shard_index{};
+    // Zero if this isn't a sharded run.
+    size_t shard_count{};
+    std::filesystem::path shard_output{};
+    std::vector<std::string> shard_files_to_merge{};
+    std::filesystem::path emit_ir{};
+    std::filesystem::path from_ir{};
+    bool watch{};
+    bool verify_jobs{};
+};
+
+auto create_code_parser(const Options& options, const std::vector<std::string>& files, std::vector<const char*>& compiler_flags) -> std::unique_ptr<LuaWrapperGenerator::CodeParser>
+{
+    auto code_parser = std::make_unique<LuaWrapperGenerator::CodeParser>(files, compiler_flags.data(), static_cast<int>(compiler_flags.size()), options.output_path, options.code_root);
+    add_type_patches(*code_parser);
+    code_parser->set_num_jobs(options.num_jobs);
+    code_parser->set_unity_build(options.unity_build);
+    if (!options.precompiled_header_sources.empty())
+    {
+        code_parser->set_precompiled_header_sources(options.precompiled_header_sources, options.precompiled_header.empty() ? options.output_path / "LuaWrapperGenerator.pch" : options.precompiled_header);
+    }
+    else if (!options.precompiled_header.empty())
+    {
+        code_parser->set_precompiled_header(options.precompiled_header);
+    }
+    if (!options.cache_dir.empty())
+    {
+        code_parser->set_cache_dir(options.cache_dir);
+    }
+    if (!options.compile_commands.empty())
+    {
+        code_parser->set_compile_commands(load_compile_commands(options.compile_commands));
+    }
+    code_parser->set_path_filters(options.allowed_paths, options.denied_paths);
+    code_parser->set_skip_system_headers(options.skip_system_headers);
+    if (options.shard_count != 0)
+    {
+        code_parser->set_shard(options.shard_index, options.shard_count);
+    }
+    return code_parser;
+}
+
+// The generated files are compared by hash, nothing is written.
+auto generate_code_in_memory(const LuaWrapperGenerator::CodeGenerator& parser_output) -> std::map<std::string, uint64_t>
+{
+    auto output_manifest = LuaWrapperGenerator::OutputManifest::in_memory();
+    parser_output.generate_lua_setup_file(output_manifest);
+    parser_output.generate_state_file(output_manifest);
+    return output_manifest.get_contents_hashes();
+}
+
+// Parses every file again with one job and throws if that generates anything different.
+// The output must not depend on the number of jobs since build caches rely on identical input generating identical files.
+auto verify_jobs(const Options& options, const std::vector<std::string>& files, std::vector<const char*>& compiler_flags, const LuaWrapperGenerator::CodeGenerator& parser_output) -> void
+{
+    printf_s("Parsing again with one job to verify the output\n");
+    auto single_job_options = options;
+    single_job_options.num_jobs = 1;
+    // Entries in the cache were made by the run that's being verified.
+    single_job_options.cache_dir.clear();
+    auto single_job_code_parser = create_code_parser(single_job_options, files, compiler_flags);
+
+    auto generated_files = generate_code_in_memory(parser_output);
+    auto single_job_generated_files = generate_code_in_memory(single_job_code_parser->parse());
+    for (const auto& [relative_path, contents_hash] : generated_files)
+    {
+        auto it = single_job_generated_files.find(relative_path);
+        if (it == single_job_generated_files.end() || it->second != contents_hash)
+        {
+            throw std::runtime_error{std::format("'{}' is different when generated with one job", relative_path)};
+        }
+    }
+    if (generated_files.size() != single_job_generated_files.size())
+    {
+        throw std::runtime_error{"Generating with one job gives a different set of files"};
+    }
+    printf_s("The output with %zu jobs is identical to the output with one job\n", options.num_jobs);
+}
+
+auto parse_cxx(const Options& options) -> void
 {
-    static const std::filesystem::path project_code_root{"D:\\VisualStudio\\source\\repos\\RC\\ue4ss_rewritten"};
     static const std::filesystem::path code_output_path{"D:\\VisualStudio\\source\\repos\\RC\\LuaWrapperGenerator_Testing\\LuaBindings"};
     //static constexpr File::StringViewType file{STR("D:\\VisualStudio\\source\\repos\\RC\\LuaWrapperGenerator_Testing\\src\\LuaWrapperGenerator_Testing\\FileToParse.cpp")};
     //static constexpr File::StringViewType file{STR("D:\\VisualStudio\\source\\repos\\RC\\LuaWrapperGenerator_Testing\\include\\LuaWrapperGenerator_Testing\\MyStruct.hpp")};
@@ -80,6 +208,18 @@ auto parse_cxx(const std::filesystem::path& output_path, std::vector<std::string
             "-Dxinput1_3_EXPORTS",
     };
 
+    // Anything supplied on the command line replaces the hardcoded defaults.
+    // A compilation database without any sources means that the files are taken from the database, so the defaults must not be used either.
+    if (!options.sources.empty() || !options.compile_commands.empty()) { files = options.sources; }
+    if (!options.compiler_flags.empty())
+    {
+        compiler_flags.clear();
+        for (const auto& compiler_flag : options.compiler_flags)
+        {
+            compiler_flags.emplace_back(compiler_flag.c_str());
+        }
+    }
+
     for (const auto& file : files)
     {
         printf_s("src: %s\n", file.c_str());
@@ -90,24 +230,132 @@ auto parse_cxx(const std::filesystem::path& output_path, std::vector<std::string
         printf_s("flag: %s\n", compiler_flag);
     }
 
-    LuaWrapperGenerator::CodeParser code_parser{files, compiler_flags.data(), static_cast<int>(compiler_flags.size()), output_path, project_code_root};
-    code_parser.add_type_patch(TypePatch{
-        .generate_state_file_pre = &TypePatches::Unreal::generate_state_file_pre,
-        .generate_state_file_post = &TypePatches::Unreal::generate_state_file_post,
-        .cxtype_to_type = &TypePatches::Unreal::cxtype_to_type,
-        .cxtype_to_type_post = &TypePatches::Unreal::cxtype_to_type_post,
-        .generate_lua_setup_state_function_post = &TypePatches::Unreal::generate_lua_setup_state_function_post,
-        .generate_per_class_static_functions = &TypePatches::Unreal::generate_per_class_static_functions,
-    });
+    auto code_parser_ptr = create_code_parser(options, files, compiler_flags);
+    auto& code_parser = *code_parser_ptr;
+    if (options.watch)
+    {
+        code_parser.watch([](const LuaWrapperGenerator::CodeGenerator& parser_output) {
+            generate_code(parser_output);
+        });
+        return;
+    }
+
     const auto& parser_output = code_parser.parse();
-    printf_s("Generating code\n");
-    double timer_dur{};
+
+    if (!options.emit_ir.empty())
     {
-        ScopedTimer timer(&timer_dur);
-        parser_output.generate_lua_setup_file();
-        parser_output.generate_state_file();
+        parser_output.write_ir_file(options.emit_ir);
+        printf_s("Wrote binding IR to %s\n", options.emit_ir.string().c_str());
     }
-    printf_s("Code generation took %f seconds.\n", timer_dur);
+
+    // A shard only writes its part of the output, the code is generated by the merge step once every shard is done.
+    if (options.shard_count != 0)
+    {
+        code_parser.write_shard(options.shard_output.empty() ? options.output_path / std::format("shard_{}_of_{}.bin", options.shard_index, options.shard_count) : options.shard_output);
+        return;
+    }
+
+    generate_code(parser_output);
+
+    if (options.verify_jobs && options.num_jobs != 1)
+    {
+        verify_jobs(options, files, compiler_flags, parser_output);
+    }
+}
+
+auto generate_from_ir(const Options& options) -> void
+{
+    // Nothing is parsed so the files, the compiler flags and the code root aren't used.
+    LuaWrapperGenerator::CodeParser code_parser{{}, nullptr, 0, options.output_path, {}};
+    add_type_patches(code_parser);
+    code_parser.set_num_jobs(options.num_jobs);
+    generate_code(code_parser.load_ir(options.from_ir));
+}
+
+auto merge_shards(const Options& options) -> void
+{
+    // Nothing is parsed so the files, the compiler flags and the code root aren't used.
+    LuaWrapperGenerator::CodeParser code_parser{{}, nullptr, 0, options.output_path, {}};
+    add_type_patches(code_parser);
+    code_parser.set_num_jobs(options.num_jobs);
+    const auto& parser_output = code_parser.merge_shards({options.shard_files_to_merge.begin(), options.shard_files_to_merge.end()});
+    generate_code(parser_output);
+}
+
+// std::stoull throws std::invalid_argument and std::out_of_range which aren't caught by main, and accepts trailing garbage like '4x'.
+auto parse_size_arg(std::string_view arg_name, std::string_view value) -> size_t
+{
+    size_t result{};
+    auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), result);
+    if (error != std::errc{} || end != value.data() + value.size())
+    {
+        throw std::runtime_error{std::format("Invalid {} '{}', expected a non-negative whole number", arg_name, value)};
+    }
+    return result;
+}
+
+auto read_options(ArgsParser& args_parser) -> Options
+{
+    Options options{};
+    options.output_path = args_parser.get_arg("output");
+    options.sources = args_parser.get_arg_as_vector("sources");
+    options.compiler_flags = args_parser.get_arg_as_vector("compiler_flags");
+    // Number of translation units to parse in parallel, 0 means one per hardware thread.
+    auto jobs = args_parser.get_arg("jobs");
+    options.num_jobs = jobs.empty() ? 1 : parse_size_arg("jobs", jobs);
+    // Directory where the output of each translation unit is stored so that it doesn't have to be parsed again on the next run.
+    // The time it took to parse each file is also stored there so that the slowest files are started first on the next run.
+    // Without it, files are only ordered by their size.
+    options.cache_dir = args_parser.get_arg("cache_dir");
+    // Parse all sources as one translation unit, 'true' or '1' to enable.
+    auto unity = args_parser.get_arg("unity");
+    options.unity_build = unity == "true" || unity == "1";
+    // A precompiled header to parse every file with.
+    // If 'pch_headers' is supplied, the precompiled header is built from those headers and written to 'pch'.
+    options.precompiled_header = args_parser.get_arg("pch");
+    options.precompiled_header_sources = args_parser.get_arg_as_vector("pch_headers");
+    // Headers under this directory that are included by the sources are scanned for annotations.
+    // Without it, every included header that isn't found through a system include directory is scanned.
+    options.code_root = args_parser.get_arg("code_root");
+    // Path to compile_commands.json, or the build directory that contains it.
+    // Each file is parsed with its own flags from it, if there are no sources then every annotated file in it is parsed.
+    options.compile_commands = args_parser.get_arg("compile_commands");
+    // Declarations in files under 'deny_paths' are skipped, 'allow_paths' overrides both 'deny_paths' and 'skip_system_headers'.
+    options.allowed_paths = args_parser.get_arg_as_vector("allow_paths");
+    options.denied_paths = args_parser.get_arg_as_vector("deny_paths");
+    // Declarations in system headers are only skipped if this is 'true' or '1'.
+    // Headers that are included with -isystem count as system headers so this is off by default.
+    auto skip_system_headers_arg = args_parser.get_arg("skip_system_headers");
+    options.skip_system_headers = skip_system_headers_arg == "true" || skip_system_headers_arg == "1";
+    // Writes a timeline of the run to this file in the Chrome trace event format, it can be opened in Perfetto.
+    options.trace_file = args_parser.get_arg("trace");
+
+    // 'index/count', for example '2/8', only parses the files that belong to that shard and writes them to 'shard_output'.
+    // The shards can be run as separate processes or on separate machines, their output is combined with 'merge'.
+    auto shard = args_parser.get_arg("shard");
+    if (!shard.empty())
+    {
+        auto separator = shard.find('/');
+        if (separator == shard.npos) { throw std::runtime_error{std::format("Invalid shard '{}', expected 'index/count'", shard)}; }
+        options.shard_index = parse_size_arg("shard index", std::string_view{shard}.substr(0, separator));
+        options.shard_count = parse_size_arg("shard count", std::string_view{shard}.substr(separator + 1));
+        if (options.shard_count == 0) { throw std::runtime_error{std::format("Invalid shard '{}', the number of shards can't be zero", shard)}; }
+    }
+    options.shard_output = args_parser.get_arg("shard_output");
+    // Shard files to combine instead of parsing anything, the code is generated from the combined output.
+    options.shard_files_to_merge = args_parser.get_arg_as_vector("merge");
+    // Saves the parser output to this file, code can then be regenerated from it with 'from_ir' without parsing again.
+    options.emit_ir = args_parser.get_arg("emit_ir");
+    options.from_ir = args_parser.get_arg("from_ir");
+    // Keeps running after the first run and regenerates the output whenever one of the parsed files or their headers is saved, 'true' or '1' to enable.
+    auto watch_arg = args_parser.get_arg("watch");
+    options.watch = watch_arg == "true" || watch_arg == "1";
+    // Parses every file again with one job after generating and fails if the output is different, 'true' or '1' to enable.
+    // Doesn't apply to shards or watch mode.
+    auto verify_jobs_arg = args_parser.get_arg("verify_jobs");
+    options.verify_jobs = verify_jobs_arg == "true" || verify_jobs_arg == "1";
+
+    return options;
 }
 
 auto main(int argc, char* argv[]) -> int
@@ -118,23 +366,57 @@ auto main(int argc, char* argv[]) -> int
             "output",
             "sources",
             "compiler_flags",
+            "jobs",
+            "cache_dir",
+            "unity",
+            "pch",
+            "pch_headers",
+            "code_root",
+            "compile_commands",
+            "allow_paths",
+            "deny_paths",
+            "skip_system_headers",
+            "trace",
+            "shard",
+            "shard_output",
+            "merge",
+            "emit_ir",
+            "from_ir",
+            "watch",
+            "verify_jobs",
         }};
-        auto output_path = args_parser.get_arg("output");
-        auto sources = args_parser.get_arg_as_vector("sources");
-        auto compiler_flags = args_parser.get_arg_as_vector("compiler_flags");
-        
-        std::vector<const char*> compiler_flags_raw{};
-
-        for (const auto& compiler_flag : compiler_flags)
+        auto options = read_options(args_parser);
+        if (!options.trace_file.empty())
         {
-            compiler_flags_raw.emplace_back(compiler_flag.c_str());
+            LuaWrapperGenerator::Trace::start(options.trace_file);
         }
 
-        //if (output_path.empty()) { throw std::runtime_error{"The output path cannot be empty"}; }
-        printf_s("Output Path: %s\n", output_path.c_str());
+        //if (options.output_path.empty()) { throw std::runtime_error{"The output path cannot be empty"}; }
+        printf_s("Output Path: %s\n", options.output_path.string().c_str());
         printf_s("Generating Lua bindings...\n");
 
-        parse_cxx(output_path, sources, compiler_flags_raw);
+        if (!options.from_ir.empty())
+        {
+            generate_from_ir(options);
+        }
+        else if (!options.shard_files_to_merge.empty())
+        {
+            merge_shards(options);
+        }
+        else
+        {
+            parse_cxx(options);
+        }
+    }
+    catch (std::runtime_error& e)
+    {
+        printf_s("Error: %s\n", e.what());
+    }
+
+    try
+    {
+        // Also written after an error so that the run up to the error can be inspected.
+        LuaWrapperGenerator::Trace::stop();
     }
     catch (std::runtime_error& e)
     {